@@ -0,0 +1,253 @@
+/*********************************************************************
+*
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2008, Willow Garage, Inc.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*
+*********************************************************************/
+//
+// Benchmarks of the NavFn phases and of whole plans over a corpus of start/goal
+// pairs on the willow costmap. Runs headless, without a ROS master; use the
+// usual google benchmark flags, e.g. --benchmark_out=run.json, and compare two
+// runs with benchmark's compare.py.
+//
+
+#include <navfn/navfn.h>
+#include <navfn/pgm_map.h>
+#include <benchmark/benchmark.h>
+#include "perf_counters.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+namespace {
+
+  struct Problem {
+    int start[2], goal[2];
+  };
+
+  int sx, sy;
+  std::vector<COSTTYPE> planner_costs; // willow in the planner's convention, as read
+  std::vector<COSTTYPE> ros_costs;     // the same map in the ROS convention, 253 becoming unknown
+  std::vector<Problem> corpus;
+
+  bool loadData(const std::string& dir)
+  {
+    navfn::PgmMap pgm;
+    if( !pgm.open( dir + "/test/willow_costmap.pgm" ))
+      return false;
+    sx = pgm.width();
+    sy = pgm.height();
+    planner_costs.assign( pgm.data(), pgm.data() + sx*sy );
+
+    ros_costs.resize( planner_costs.size() );
+    for( size_t i = 0; i < planner_costs.size(); i++ )
+    {
+      int c = planner_costs[ i ];
+      ros_costs[ i ] = c >= COST_OBS ? COST_OBS : c == COST_OBS-1 ? COST_UNKNOWN_ROS : ( c - COST_NEUTRAL ) / COST_FACTOR;
+    }
+
+    FILE *f = fopen( (dir + "/bench/willow_corpus.txt").c_str(), "r" );
+    if( f == NULL )
+      return false;
+    char line[256];
+    while( fgets( line, sizeof(line), f ))
+    {
+      Problem p;
+      if( line[0] != '#' && sscanf( line, "%d %d %d %d", &p.start[0], &p.start[1], &p.goal[0], &p.goal[1] ) == 4 )
+        corpus.push_back( p );
+    }
+    fclose( f );
+    return !corpus.empty();
+  }
+
+  // a planner loaded with willow, goal and start flipped the way NavfnROS sets them
+  void preparePlanner(navfn::NavFn& nav, const Problem& p)
+  {
+    nav.priInc = 2*COST_NEUTRAL;
+    memcpy( nav.costarr, &planner_costs[0], planner_costs.size() );
+    nav.setStart( const_cast<int*>( p.goal ));
+    nav.setGoal( const_cast<int*>( p.start ));
+  }
+
+  int propagationCycles(const navfn::NavFn& nav)
+  {
+    return std::max( nav.nx*nav.ny/20, nav.nx+nav.ny );
+  }
+
+  void setCounters(benchmark::State& state, const navfn::NavFn& nav)
+  {
+    state.counters["cells"] = nav.propCells;
+    state.counters["cells_per_second"] = benchmark::Counter( nav.propCells, benchmark::Counter::kIsIterationInvariantRate );
+  }
+
+  void BM_setCostmap(benchmark::State& state)
+  {
+    navfn::NavFn nav( sx, sy );
+    PerfCounters perf;
+    perf.start();
+    for( auto _ : state )
+      nav.setCostmap( &ros_costs[0], true, true );
+    perf.stop();
+    state.SetBytesProcessed( state.iterations() * ros_costs.size() );
+    perf.report( state, "", (double)state.iterations() * nav.ns, "cell" );
+  }
+
+  void BM_setupNavFn(benchmark::State& state)
+  {
+    navfn::NavFn nav( sx, sy );
+    preparePlanner( nav, corpus[ 0 ] );
+    PerfCounters perf;
+    perf.start();
+    for( auto _ : state )
+      nav.setupNavFn( true );
+    perf.stop();
+    state.SetItemsProcessed( state.iterations() * nav.ns );
+    perf.report( state, "", (double)state.iterations() * nav.ns, "cell" );
+  }
+
+  // the counters only run around the propagation, like the timer
+  void propagate(benchmark::State& state, bool astar)
+  {
+    navfn::NavFn nav( sx, sy );
+    preparePlanner( nav, corpus[ state.range(0) ] );
+    PerfCounters perf;
+    for( auto _ : state )
+    {
+      state.PauseTiming();
+      nav.setupNavFn( true );
+      perf.start();
+      state.ResumeTiming();
+      if( astar )
+        nav.propNavFnAstar( propagationCycles( nav ));
+      else
+        nav.propNavFnDijkstra( propagationCycles( nav ), true );
+      state.PauseTiming();
+      perf.stop();
+      state.ResumeTiming();
+    }
+    setCounters( state, nav );
+    perf.report( state, "", (double)state.iterations() * nav.propCells, "cell" );
+  }
+
+  void BM_propNavFnDijkstra(benchmark::State& state)
+  {
+    propagate( state, false );
+  }
+
+  void BM_propNavFnAstar(benchmark::State& state)
+  {
+    propagate( state, true );
+  }
+
+  void BM_calcPath(benchmark::State& state)
+  {
+    navfn::NavFn nav( sx, sy );
+    preparePlanner( nav, corpus[ state.range(0) ] );
+    nav.setupNavFn( true );
+    nav.propNavFnDijkstra( propagationCycles( nav ), true );
+    int len = 0;
+    PerfCounters perf;
+    perf.start();
+    for( auto _ : state )
+      benchmark::DoNotOptimize( len = nav.calcPath( nav.nx*4 ));
+    perf.stop();
+    if( len == 0 )
+      state.SkipWithError( "no path" );
+    state.counters["path_len"] = len;
+    perf.report( state, "", (double)state.iterations() * len, "point" );
+  }
+
+  // what NavfnROS does for a plan: translate the costmap, propagate and follow the gradient,
+  // with the counters of each phase reported apart
+  void BM_plan(benchmark::State& state)
+  {
+    const Problem& p = corpus[ state.range(0) ];
+    navfn::NavFn nav( sx, sy );
+    nav.priInc = 2*COST_NEUTRAL;
+    PerfCounters translate, setup, propagate, path;
+    int len = 0;
+    for( auto _ : state )
+    {
+      translate.start();
+      nav.setCostmap( &ros_costs[0], true, true );
+      translate.stop();
+      nav.setStart( const_cast<int*>( p.goal ));
+      nav.setGoal( const_cast<int*>( p.start ));
+      setup.start();
+      nav.setupNavFn( true );
+      setup.stop();
+      propagate.start();
+      nav.propNavFnDijkstra( propagationCycles( nav ), true );
+      propagate.stop();
+      path.start();
+      len = nav.calcPath( nav.nx*4 );
+      path.stop();
+    }
+    if( len == 0 )
+      state.SkipWithError( "no path" );
+    setCounters( state, nav );
+    // translation and setup go over the whole map whatever the problem, so they are per plan only
+    translate.report( state, "translate." );
+    setup.report( state, "setup." );
+    propagate.report( state, "propagate.", (double)state.iterations() * nav.propCells, "cell" );
+    path.report( state, "path.", (double)state.iterations() * len, "point" );
+  }
+
+}
+
+int main(int argc, char **argv)
+{
+  if( !loadData( NAVFN_BENCH_DATA_DIR ))
+  {
+    fprintf( stderr, "Could not load the willow costmap and corpus from %s\n", NAVFN_BENCH_DATA_DIR );
+    return 1;
+  }
+  if( !PerfCounters().available() )
+    fprintf( stderr, "Hardware counters are not available (see kernel.perf_event_paranoid), reporting times only\n" );
+
+  int last = corpus.size() - 1;
+  benchmark::RegisterBenchmark( "setCostmap", BM_setCostmap )->Unit( benchmark::kMicrosecond );
+  benchmark::RegisterBenchmark( "setupNavFn", BM_setupNavFn )->Unit( benchmark::kMicrosecond );
+  benchmark::RegisterBenchmark( "propNavFnDijkstra", BM_propNavFnDijkstra )->DenseRange( 0, last )->Unit( benchmark::kMicrosecond );
+  benchmark::RegisterBenchmark( "propNavFnAstar", BM_propNavFnAstar )->DenseRange( 0, last )->Unit( benchmark::kMicrosecond );
+  benchmark::RegisterBenchmark( "calcPath", BM_calcPath )->DenseRange( 0, last )->Unit( benchmark::kMicrosecond );
+  benchmark::RegisterBenchmark( "plan", BM_plan )->DenseRange( 0, last )->Unit( benchmark::kMicrosecond );
+
+  benchmark::Initialize( &argc, argv );
+  if( benchmark::ReportUnrecognizedArguments( argc, argv ))
+    return 1;
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
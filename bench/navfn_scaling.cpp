@@ -0,0 +1,185 @@
+/*********************************************************************
+*
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2008, Willow Garage, Inc.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*
+*********************************************************************/
+//
+// How NavFn scales with the map size and clutter: plans on generated maps from
+// 1000x1000 to 20000x20000 cells, for each layout and propagation engine.
+// Reports the latency of a whole plan, the cells expanded per second, the
+// memory held by the planner and the peak resident set of the process, and
+// the hardware counters of the propagation per expanded cell where available.
+// The largest maps need several GB; cap them with --max_size=<cells>.
+//
+
+#include <navfn/navfn.h>
+#include <navfn/map_generator.h>
+#include <benchmark/benchmark.h>
+#include "perf_counters.h"
+#include <sys/resource.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+namespace {
+
+  enum Engine { DIJKSTRA, ASTAR };
+
+  const int sizes[] = { 1000, 2000, 5000, 10000, 20000 };
+  const int problems_per_map = 8;
+
+  // the last generated map, maps are generated once for all the benchmarks running on them
+  struct GeneratedMap {
+    GeneratedMap() : size(0), layout(-1) {}
+    int size, layout;
+    std::vector<unsigned char> costs;
+    std::vector<int> problems;
+  } current;
+
+  const GeneratedMap& mapFor(int size, int layout)
+  {
+    if( current.size != size || current.layout != layout )
+    {
+      navfn::MapGenerator::Options opts;
+      opts.layout = (navfn::MapGenerator::Layout)layout;
+      opts.width = opts.height = size;
+      opts.density = opts.layout == navfn::MapGenerator::MAZE ? 0.8 : 0.15;
+      navfn::MapGenerator gen( 1 );
+      current.costs.clear();
+      gen.generate( opts, current.costs );
+      gen.sampleProblems( current.costs, size, size, problems_per_map, size / 4.0, current.problems );
+      current.size = size;
+      current.layout = layout;
+    }
+    return current;
+  }
+
+  // what setNavArr allocates, plus the priority buffers
+  double plannerBytes(const navfn::NavFn& nav)
+  {
+    return (double)nav.ns * ( sizeof(COSTTYPE) + sizeof(bool) + 3*sizeof(float) ) + 3.0 * PRIORITYBUFSIZE * sizeof(int);
+  }
+
+  double peakRssBytes()
+  {
+    struct rusage usage;
+    getrusage( RUSAGE_SELF, &usage );
+    return usage.ru_maxrss * 1024.0;
+  }
+
+  void BM_scaling(benchmark::State& state, Engine engine)
+  {
+    int size = state.range(0), layout = state.range(1);
+    const GeneratedMap& map = mapFor( size, layout );
+    int nproblems = map.problems.size() / 4;
+    if( nproblems == 0 )
+    {
+      state.SkipWithError( "no connected start and goal on this map" );
+      return;
+    }
+
+    navfn::NavFn nav( size, size );
+    nav.priInc = 2*COST_NEUTRAL;
+    PerfCounters perf;
+    double cells = 0.0;
+    int found = 0, plans = 0, max_buffer = 0;
+    for( auto _ : state )
+    {
+      const int *p = &map.problems[ 4 * ( plans % nproblems ) ];
+      int start[2] = { p[2], p[3] }, goal[2] = { p[0], p[1] }; // flipped, as NavfnROS does
+      nav.setCostmap( &map.costs[0], true, true );
+      nav.setStart( start );
+      nav.setGoal( goal );
+      nav.setupNavFn( true );
+      perf.start();
+      if( engine == ASTAR )
+        nav.propNavFnAstar( std::max( nav.nx*nav.ny/20, nav.nx+nav.ny ));
+      else
+        nav.propNavFnDijkstra( std::max( nav.nx*nav.ny/20, nav.nx+nav.ny ), true );
+      perf.stop();
+      if( nav.calcPath( nav.nx*4 ) > 0 )
+        found++;
+      cells += nav.propCells;
+      max_buffer = std::max( max_buffer, nav.propMaxBuf );
+      plans++;
+    }
+
+    state.SetLabel( navfn::MapGenerator::layoutName( (navfn::MapGenerator::Layout)layout ));
+    state.counters["cells_per_second"] = benchmark::Counter( cells, benchmark::Counter::kIsRate );
+    state.counters["cells"] = cells / plans;
+    state.counters["found"] = (double)found / plans;
+    state.counters["max_buffer"] = max_buffer;
+    state.counters["planner_bytes"] = benchmark::Counter( plannerBytes( nav ), benchmark::Counter::kDefaults, benchmark::Counter::kIs1024 );
+    state.counters["peak_rss"] = benchmark::Counter( peakRssBytes(), benchmark::Counter::kDefaults, benchmark::Counter::kIs1024 );
+    perf.report( state, "propagate.", cells, "cell" );
+  }
+
+}
+
+int main(int argc, char **argv)
+{
+  // our own flag, taken out before benchmark sees the arguments
+  int max_size = 20000;
+  int kept = 1;
+  for( int i = 1; i < argc; i++ )
+  {
+    if( strncmp( argv[ i ], "--max_size=", 11 ) == 0 )
+      max_size = atoi( argv[ i ] + 11 );
+    else
+      argv[ kept++ ] = argv[ i ];
+  }
+  argc = kept;
+  if( !PerfCounters().available() )
+    fprintf( stderr, "Hardware counters are not available (see kernel.perf_event_paranoid), reporting times only\n" );
+
+  // sizes outermost, so each map is generated once for both engines
+  for( unsigned int s = 0; s < sizeof(sizes) / sizeof(sizes[0]) && sizes[ s ] <= max_size; s++ )
+  {
+    for( int layout = navfn::MapGenerator::OPEN_HALL; layout <= navfn::MapGenerator::RANDOM_OBSTACLES; layout++ )
+    {
+      benchmark::RegisterBenchmark( "scaling/dijkstra", BM_scaling, DIJKSTRA )
+        ->Args( { sizes[ s ], layout } )->ArgNames( { "size", "layout" } )->Unit( benchmark::kMillisecond );
+      benchmark::RegisterBenchmark( "scaling/astar", BM_scaling, ASTAR )
+        ->Args( { sizes[ s ], layout } )->ArgNames( { "size", "layout" } )->Unit( benchmark::kMillisecond );
+    }
+  }
+
+  benchmark::Initialize( &argc, argv );
+  if( benchmark::ReportUnrecognizedArguments( argc, argv ))
+    return 1;
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
@@ -0,0 +1,170 @@
+/*********************************************************************
+*
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2008, Willow Garage, Inc.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*
+*********************************************************************/
+#include "perf_counters.h"
+#include <string.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+namespace {
+
+  int openCounter(uint32_t type, uint64_t config)
+  {
+    struct perf_event_attr attr;
+    memset( &attr, 0, sizeof(attr) );
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return syscall( __NR_perf_event_open, &attr, 0, -1, -1, 0 );
+  }
+
+  // value, time enabled, time running
+  bool readCounter(int fd, uint64_t *v)
+  {
+    return read( fd, v, 3 * sizeof(uint64_t) ) == (ssize_t)( 3 * sizeof(uint64_t) );
+  }
+
+}
+#endif
+
+PerfCounters::PerfCounters()
+{
+  for( int c = 0; c < NUM_COUNTERS; c++ )
+  {
+    fd_[ c ] = -1;
+    total_[ c ] = 0.0;
+  }
+#ifdef __linux__
+  fd_[ CYCLES ] = openCounter( PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES );
+  fd_[ INSTRUCTIONS ] = openCounter( PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS );
+  fd_[ L1D_MISSES ] = openCounter( PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D
+      | ( PERF_COUNT_HW_CACHE_OP_READ << 8 ) | ( PERF_COUNT_HW_CACHE_RESULT_MISS << 16 ));
+  fd_[ LLC_MISSES ] = openCounter( PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES );
+  fd_[ BRANCH_MISSES ] = openCounter( PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES );
+#endif
+}
+
+PerfCounters::~PerfCounters()
+{
+#ifdef __linux__
+  for( int c = 0; c < NUM_COUNTERS; c++ )
+    if( fd_[ c ] >= 0 )
+      close( fd_[ c ] );
+#endif
+}
+
+bool PerfCounters::available() const
+{
+  for( int c = 0; c < NUM_COUNTERS; c++ )
+    if( fd_[ c ] >= 0 )
+      return true;
+  return false;
+}
+
+void PerfCounters::start()
+{
+#ifdef __linux__
+  for( int c = 0; c < NUM_COUNTERS; c++ )
+  {
+    if( fd_[ c ] >= 0 )
+    {
+      ioctl( fd_[ c ], PERF_EVENT_IOC_RESET, 0 );
+      ioctl( fd_[ c ], PERF_EVENT_IOC_ENABLE, 0 );
+    }
+  }
+#endif
+}
+
+void PerfCounters::stop()
+{
+#ifdef __linux__
+  for( int c = 0; c < NUM_COUNTERS; c++ )
+    if( fd_[ c ] >= 0 )
+      ioctl( fd_[ c ], PERF_EVENT_IOC_DISABLE, 0 );
+
+  for( int c = 0; c < NUM_COUNTERS; c++ )
+  {
+    uint64_t v[3];
+    if( fd_[ c ] < 0 || !readCounter( fd_[ c ], v ))
+      continue;
+    // the counter only ran for part of the time it was enabled when the PMU was shared
+    if( v[2] > 0 )
+      total_[ c ] += (double)v[0] * v[1] / v[2];
+  }
+#endif
+}
+
+double PerfCounters::value(Counter c) const
+{
+  return total_[ c ];
+}
+
+void PerfCounters::reset()
+{
+  for( int c = 0; c < NUM_COUNTERS; c++ )
+    total_[ c ] = 0.0;
+}
+
+const char *PerfCounters::name(Counter c)
+{
+  static const char *names[ NUM_COUNTERS ] = { "cycles", "instructions", "L1D_misses", "LLC_misses", "branch_misses" };
+  return names[ c ];
+}
+
+void PerfCounters::report(benchmark::State& state, const std::string& prefix, double units, const std::string& unit) const
+{
+  if( state.iterations() == 0 )
+    return;
+  for( int c = 0; c < NUM_COUNTERS; c++ )
+  {
+    if( !has( (Counter)c ))
+      continue;
+    state.counters[ prefix + name( (Counter)c ) ] = total_[ c ] / state.iterations();
+    if( units > 0.0 )
+      state.counters[ prefix + name( (Counter)c ) + "/" + unit ] = total_[ c ] / units;
+  }
+  if( has( CYCLES ) && has( INSTRUCTIONS ) && total_[ CYCLES ] > 0.0 )
+    state.counters[ prefix + "IPC" ] = total_[ INSTRUCTIONS ] / total_[ CYCLES ];
+}
@@ -0,0 +1,83 @@
+/*********************************************************************
+*
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2008, Willow Garage, Inc.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*
+*********************************************************************/
+#ifndef NAVFN_BENCH_PERF_COUNTERS_H_
+#define NAVFN_BENCH_PERF_COUNTERS_H_
+
+#include <benchmark/benchmark.h>
+#include <stdint.h>
+#include <string>
+
+// Hardware counters of the calling thread around the phases of a benchmark, read
+// through perf_event_open. Counters the kernel, the hardware or the permissions
+// (kernel.perf_event_paranoid) don't allow are left out, and on other systems
+// than Linux there are none, so benchmarks run the same with or without them.
+class PerfCounters
+{
+public:
+  enum Counter { CYCLES, INSTRUCTIONS, L1D_MISSES, LLC_MISSES, BRANCH_MISSES, NUM_COUNTERS };
+
+  PerfCounters();
+  ~PerfCounters();
+
+  // the counters' file descriptors are owned, and closed once
+  PerfCounters(const PerfCounters&) = delete;
+  PerfCounters& operator=(const PerfCounters&) = delete;
+
+  // true if at least one counter could be opened
+  bool available() const;
+
+  // count from here on, until stop(); calls add up
+  void start();
+  void stop();
+
+  // the counts since construction or the last reset(), scaled up when the kernel multiplexed the counter
+  double value(Counter c) const;
+  bool has(Counter c) const { return fd_[ c ] >= 0; }
+  void reset();
+
+  // add the counts of the open counters to a benchmark's counters, per iteration as "<prefix><name>" and, when
+  // units > 0, per unit of work over all iterations as "<prefix><name>/<unit>"; IPC is added when cycles and
+  // instructions are both open
+  void report(benchmark::State& state, const std::string& prefix, double units = 0.0, const std::string& unit = "") const;
+
+  static const char *name(Counter c);
+
+private:
+  int fd_[ NUM_COUNTERS ];
+  double total_[ NUM_COUNTERS ];
+};
+
+#endif
@@ -0,0 +1,120 @@
+/*********************************************************************
+*
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2008, Willow Garage, Inc.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*
+*********************************************************************/
+#ifndef NAVFN_COST_TRANSLATION_CACHE_H_
+#define NAVFN_COST_TRANSLATION_CACHE_H_
+
+#include <navfn/navfn.h>
+#include <navfn/navfn_pool.h>
+#include <boost/thread.hpp>
+#include <boost/shared_ptr.hpp>
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace navfn {
+  /**
+   * @class CostTranslationCache
+   * @brief Process-wide cache of translated costmaps, keyed by a map id and version the caller supplies, e.g. the
+   * static map's topic and load time. Planner instances planning on the same map, e.g. one per simulated robot,
+   * share one read-only translation instead of each keeping and re-translating its own copy. The costmap is
+   * never looked at on a hit, so it has to change only with the version: the cache suits costmaps made of the
+   * static map and its inflation, with anything that moves stamped as an overlay. The cache holds the most recently used
+   * translations itself, so planners that plan at different times still share them, and a planner holds the
+   * one it points into for as long as it uses it. Dynamic obstacles stamped with NavFn::stampOverlay() are
+   * kept next to the shared costs, which are never written.
+   */
+  class CostTranslationCache {
+    public:
+      /**
+       * @brief  The cache shared by every planner of the process
+       */
+      static CostTranslationCache& instance();
+
+      /**
+       * @brief  Get the translation of a ROS costmap, with obstacle border, translating it unless the cache holds it
+       * @param map_id The map the costmap is made from
+       * @param version The version of that map, a new version is translated again
+       * @param cmap The costmap, only read when it is translated
+       * @param nx The x size of the costmap
+       * @param ny The y size of the costmap
+       * @param allow_unknown Whether or not the planner should be allowed to plan through unknown space
+       * @return The translated costs, to be passed to NavFn::setCostArr() and held while planning
+       */
+      boost::shared_ptr<const CostSnapshot> get(const std::string& map_id, uint64_t version, const COSTTYPE* cmap,
+          int nx, int ny, bool allow_unknown);
+
+      /**
+       * @brief  Set how many translations the cache holds, the least recently used ones are dropped first
+       */
+      void setCapacity(unsigned int capacity);
+
+      unsigned int size();		/**< number of translations the cache holds */
+      unsigned int translations();	/**< number of translations done so far */
+
+    private:
+      CostTranslationCache() : capacity_(4), translations_(0) {}
+
+      struct Key {
+        std::string map_id;
+        uint64_t version;
+        int nx, ny;
+        bool allow_unknown;
+        bool operator<(const Key& o) const {
+          if(map_id != o.map_id) return map_id < o.map_id;
+          if(version != o.version) return version < o.version;
+          if(nx != o.nx) return nx < o.nx;
+          if(ny != o.ny) return ny < o.ny;
+          return allow_unknown < o.allow_unknown;
+        }
+      };
+
+      struct Entry {
+        boost::shared_ptr<const CostSnapshot> snapshot;
+        std::list<Key>::iterator used;
+      };
+
+      void prune();
+
+      boost::mutex mutex_;
+      std::map<Key, Entry> entries_;
+      std::list<Key> lru_; /**< most recently used first */
+      unsigned int capacity_;
+      unsigned int translations_;
+  };
+};
+
+#endif
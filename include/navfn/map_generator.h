@@ -0,0 +1,121 @@
+/*********************************************************************
+*
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2008, Willow Garage, Inc.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*
+*********************************************************************/
+#ifndef NAVFN_MAP_GENERATOR_H_
+#define NAVFN_MAP_GENERATOR_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace navfn {
+  /**
+   * @class MapGenerator
+   * @brief Generates synthetic costmaps for scaling studies, in the ROS convention (0 free, 253 inscribed,
+   * 254 lethal), with inflation like the costmap's inflation layer. The same seed and options always give
+   * the same map and problems, on any platform.
+   */
+  class MapGenerator {
+    public:
+      enum Layout {
+        OPEN_HALL,        /**< a walled hall with a regular grid of jittered pillars */
+        AISLES,           /**< warehouse shelves along x, with cross aisles */
+        MAZE,             /**< corridors of a maze, with loops */
+        RANDOM_OBSTACLES  /**< discs of random size at random places */
+      };
+
+      struct Options {
+        Options() : layout(RANDOM_OBSTACLES), width(1000), height(1000), density(0.1), feature_size(8),
+          inscribed_radius(3.0), inflation_radius(10.0), cost_scaling(0.3) {}
+
+        Layout layout;
+        int width, height;       /**< size of the map, in cells */
+        double density;          /**< share of the area covered by obstacles; for mazes the share of the walls kept besides the spanning tree */
+        int feature_size;        /**< pillar side, shelf depth, corridor width or largest disc radius, in cells */
+        double inscribed_radius; /**< cells this close to an obstacle get 253, in cells */
+        double inflation_radius; /**< cells further away than this from obstacles stay free, in cells */
+        double cost_scaling;     /**< exponential decay of the inflated cost with the distance, per cell */
+      };
+
+      /**
+       * @param seed The seed of the generator, maps and problems depend on it and on nothing else
+       */
+      explicit MapGenerator(uint64_t seed);
+
+      /**
+       * @brief  Generate a costmap
+       * @param opts The layout and size of the map
+       * @param costs Resized to width * height and filled with the costs, row-major
+       */
+      void generate(const Options& opts, std::vector<unsigned char>& costs);
+
+      /**
+       * @brief  Sample start/goal pairs that are connected to each other, all of them in the largest connected free area
+       * that could be found
+       * @param costs The costmap
+       * @param nx The width of the costmap
+       * @param ny The height of the costmap
+       * @param n The number of pairs to sample
+       * @param min_distance The smallest straight line distance between start and goal, in cells
+       * @param problems Filled with start x, start y, goal x, goal y for each pair
+       * @return The number of pairs sampled, less than n if the free area is too small or too cramped
+       */
+      int sampleProblems(const std::vector<unsigned char>& costs, int nx, int ny, int n, double min_distance,
+          std::vector<int>& problems);
+
+      /**
+       * @brief  Look up a layout by its name: hall, aisles, maze or random
+       * @return False if there is no such layout
+       */
+      static bool parseLayout(const std::string& name, Layout& layout);
+      static const char* layoutName(Layout layout);
+
+    private:
+      uint64_t next();
+      int uniform(int n); /**< uniform in [0, n) */
+      double uniform01();
+
+      void openHall(const Options& opts, std::vector<unsigned char>& costs);
+      void aisles(const Options& opts, std::vector<unsigned char>& costs);
+      void maze(const Options& opts, std::vector<unsigned char>& costs);
+      void randomObstacles(const Options& opts, std::vector<unsigned char>& costs);
+      void inflate(const Options& opts, std::vector<unsigned char>& costs);
+      int floodFill(const std::vector<unsigned char>& costs, int nx, int ny, int seed, std::vector<bool>& reached);
+
+      uint64_t state_;
+  };
+};
+
+#endif
@@ -77,12 +77,16 @@
 // priority buffers
 #define PRIORITYBUFSIZE 10000
 
+// side of the square tiles updateCostmap() compares, in cells
+#define COST_TILE 64
+
 
 namespace navfn {
   /**
-    Navigation function call.
-    \param costmap Cost map array, of type COSTTYPE; origin is upper left
-NOTE: will be modified to have a border of obstacle costs
+    Navigation function call, planning with A* on a planner kept per thread.
+    See navfn_c.h for the handle based interface this is built on.
+    \param costmap Cost map array, of type COSTTYPE; origin is upper left,
+    copied, the caller's array is not modified
 \param nx Width of map in cells
 \param ny Height of map in cells
 \param goal X,Y position of goal cell
@@ -131,6 +135,114 @@ positions at about 1/2 cell resolution; else returns 0.
        */
       void setCostmap(const COSTTYPE *cmap, bool isROS=true, bool allow_unknown = true); /**< sets up the cost map */
 
+      /**
+       * @brief  Plan on an already translated cost array instead of a private copy, e.g. one shared by several planners.
+       * The array is never written or freed by the planner, so it must already have an obstacle border and outlive its use.
+       * @param cmap The translated cost array, nx*ny cells
+       */
+      void setCostArr(const COSTTYPE *cmap);
+      bool costarr_shared;		/**< true if costarr is borrowed through setCostArr() */
+
+      /**
+       * @brief  Plan on a ROS costmap in place, without copying or translating it. Costs are translated through
+       * costlut as the propagation reads them, and the map border is kept out of the propagation instead of being
+       * written as obstacles. The costmap is never written or freed, it must outlive its use and not change while planning.
+       * @param cmap The ROS costmap, nx*ny cells
+       * @param allow_unknown Whether or not the planner should be allowed to plan through unknown space
+       */
+      void setCostmapView(const COSTTYPE *cmap, bool allow_unknown = true);
+      bool costview;		/**< true if costarr is an untranslated ROS costmap set with setCostmapView() */
+      COSTTYPE costlut[256];	/**< ROS cost to planner cost, used when costview is set */
+      void setCostLut(bool allow_unknown); /**< fills costlut */
+      void lutRegion(const COSTTYPE *cmap, int x0, int y0, int x1, int y1); /**< translates a rectangle of cmap through costlut */
+
+      /**
+       * @brief  Planner cost of a cell, whether costarr is translated or a view
+       * @param n The index of the cell
+       */
+      COSTTYPE cellCost(int n) const
+      {
+        if (ovlSparse && ovlCosts[n])
+          return ovlCosts[n];
+        return costview ? costlut[costarr[n]] : costarr[n];
+      }
+
+      /**
+       * @brief  Update the cost array from a ROS costmap, re-translating only the COST_TILE x COST_TILE tiles whose
+       * contents changed since the last update. Falls back to translating every tile if the cost array was replaced,
+       * reset or resized since then, or allow_unknown changed.
+       * @param cmap The costmap
+       * @param allow_unknown Whether or not the planner should be allowed to plan through unknown space
+       * @return The number of tiles re-translated, also listed in dirtyTiles
+       */
+      int updateCostmap(const COSTTYPE *cmap, bool allow_unknown = true);
+
+      /**
+       * @brief  Re-translate the cells x0 <= x < x1, y0 <= y < y1 of a ROS costmap that is otherwise unchanged since
+       * it was last loaded, e.g. after writing a costmap update into it. A borrowed cost array is replaced by a full translation.
+       * @param cmap The whole costmap, nx*ny cells
+       * @param allow_unknown Whether or not the planner should be allowed to plan through unknown space
+       */
+      void translateRegion(const COSTTYPE *cmap, int x0, int y0, int x1, int y1, bool allow_unknown = true);
+
+      uint64_t *tileHash;		/**< fingerprint of each tile of the costmap last given to updateCostmap() */
+      int *dirtyTiles;		/**< indices (ty*tilesX + tx) of the tiles re-translated by the last updateCostmap() */
+      int ndirty;			/**< number of dirty tiles */
+      int tilesX, tilesY;		/**< number of tiles across and down the map */
+      bool tilesValid;		/**< false if costarr no longer matches tileHash */
+      bool tilesUnknown;		/**< allow_unknown of the last updateCostmap() */
+
+      /**
+       * @brief  Raise the cost of a few cells on top of the loaded costs, e.g. for dynamic obstacles, without reloading
+       * the rest of the map. The costs underneath are saved, and restored by clearOverlay() or before new costs are loaded.
+       * A borrowed cost array or view is never written: the overlay goes into ovlCosts instead, which the update
+       * kernels and cellCost() check before the base costs.
+       * @param cells The indices of the cells
+       * @param costs The planner costs of the cells, a cell that is already costlier keeps its cost
+       * @param n The number of cells
+       */
+      void stampOverlay(const int *cells, const COSTTYPE *costs, int n);
+
+      /**
+       * @brief  Make a cell free on top of the loaded costs, e.g. the robot's own cell, until the overlay is cleared
+       * @param k The index of the cell
+       */
+      void stampFree(int k);
+      void growOverlay(int n); /**< makes room for <n> more overlay cells */
+
+      /**
+       * @brief  Restore the costs under the overlay
+       */
+      void clearOverlay();
+      int *ovlCells;		/**< cells changed by the overlay, in stamping order */
+      COSTTYPE *ovlSaved;		/**< their costs before stamping */
+      int novl, novlbuf;		/**< number of overlay cells, and size of the overlay buffers */
+      COSTTYPE *ovlCosts;		/**< overlay costs over a borrowed array, 0 where there is none, allocated on first use */
+      bool ovlSparse;		/**< true if the overlay is in ovlCosts rather than stamped into costarr */
+
+      /**
+       * @brief  Translate a costmap into planner costs, as done by setCostmap()
+       * @param cmap The costmap to translate
+       * @param costs The translated cost array to fill, nx*ny cells
+       * @param nx The x size of the map
+       * @param ny The y size of the map
+       * @param isROS Whether or not the costmap is coming in in ROS format
+       * @param allow_unknown Whether or not the planner should be allowed to plan through unknown space
+       */
+      static void translateCostmap(const COSTTYPE *cmap, COSTTYPE *costs, int nx, int ny,
+          bool isROS=true, bool allow_unknown = true);
+
+      /**
+       * @brief  Fingerprint the cells x0 <= x < x1, y0 <= y < y1 of a costmap, as used to find changed tiles
+       * @param nx The x size of the whole costmap
+       */
+      static uint64_t hashCostmap(const COSTTYPE *cmap, int nx, int x0, int y0, int x1, int y1);
+
+      /**
+       * @brief  Set the outer rows and columns of a cost array to obstacles, so propagation never leaves the map
+       */
+      static void setObsBorder(COSTTYPE *costs, int nx, int ny);
+
       /**
        * @brief  Calculates a plan using the A* heuristic, returns true if one is found
        * @return True if a plan is found, false otherwise
@@ -220,8 +332,29 @@ positions at about 1/2 cell resolution; else returns 0.
        */
       void updateCellAstar(int n);	/**< updates the cell at index <n>, uses A* heuristic */
 
+      /**
+       * @brief  The update kernels, reading costs through costlut if <view> is set, and ovlCosts first if <ovl> is
+       */
+      template <bool view, bool ovl> void updateCellT(int n);
+      template <bool view, bool ovl> void updateCellAstarT(int n);
+
+      /**
+       * @brief  Update the <cnt> cells of a priority block, dispatching once on costview and ovlSparse
+       * @param astar Whether or not to use the A* heuristic
+       */
+      void updateBlock(const int *pb, int cnt, bool astar);
+
       void setupNavFn(bool keepit = false); /**< resets all nav fn arrays for propagation */
 
+      /**
+       * @brief  setupNavFn() in parts, for callers that spread it over time: setupNavFnBegin(), then
+       * setupNavFnRows() over every row, in order and in as many calls as wanted, then setupNavFnEnd()
+       */
+      void setupNavFnBegin(bool keepit = false);
+      void setupNavFnRows(int lo, int hi); /**< resets rows <lo> to <hi>-1 */
+      void setupNavFnEnd();
+      bool setupKeep;		/**< keepit of the setup in progress */
+
       /**
        * @brief  Run propagation for <cycles> iterations, or until start is reached using breadth-first Dijkstra method
        * @param cycles The maximum number of iterations to run for
@@ -232,9 +365,10 @@ positions at about 1/2 cell resolution; else returns 0.
       /**
        * @brief  Run propagation for <cycles> iterations, or until start is reached using the best-first A* method with Euclidean distance heuristic
        * @param cycles The maximum number of iterations to run for
+       * @param resume Whether this continues an earlier call, whose threshold is kept instead of being raised by the heuristic again
        * @return true if the start point is reached
        */
-      bool propNavFnAstar(int cycles); /**< returns true if start point found */
+      bool propNavFnAstar(int cycles, bool resume = false); /**< returns true if start point found */
 
       /** gradient and paths */
       float *gradx, *grady;		/**< gradient arrays, size of potential array */
@@ -243,6 +377,9 @@ positions at about 1/2 cell resolution; else returns 0.
       int npathbuf;			/**< size of pathx, pathy buffers */
 
       float last_path_cost_; /**< Holds the cost of the path found the last time A* was called */
+      int propCycles;		/**< cycles run by the last propagation */
+      int propCells;		/**< cells put into priority blocks by the last propagation */
+      int propMaxBuf;		/**< largest priority block of the last propagation */
 
 
       /**
@@ -255,11 +392,49 @@ positions at about 1/2 cell resolution; else returns 0.
       float gradCell(int n);	/**< calculates gradient at cell <n>, returns norm */
       float pathStep;		/**< step size for following gradient */
 
+      /**
+       * @brief  Compute the normalized gradient of the whole propagated area in one vectorized pass, instead of
+       * lazily per cell with gradCell(). Valid for rows gradLo to gradHi, other rows are left untouched.
+       */
+      void computeGradientField();
+      bool denseGrad;		/**< if true, calcPath() uses computeGradientField() and gradients are not reset per plan */
+      bool gradField;		/**< true once computeGradientField() has run on the current potential */
+      int gradLo, gradHi;		/**< rows covered by the dense gradient field */
+      int visitLo, visitHi;	/**< lowest and highest cell index updated by the last propagation */
+
+      /**
+       * @brief  Post-process the path found by calcPath(): shortcut it along straight lines that cross no cell
+       * costlier than the stretch of path they replace, then resample each line evenly
+       * @param spacing Largest distance between points of the resampled path, in cells; 0 keeps only the shortcut vertices
+       * @return The new length of the path
+       */
+      int simplifyPath(float spacing);
+
+      /**
+       * @brief  Check that a straight line stays on cells with cost at most <maxcost>
+       * @return True if every cell touched by the line is cheap enough and not an obstacle
+       */
+      bool lineOfSight(float x0, float y0, float x1, float y1, int maxcost);
+
+      /**
+       * @brief  Find the cell closest to (x, y) with a valid potential, searching outward in square rings
+       * @param x The x coordinate of the cell to search around, may be off the map
+       * @param y The y coordinate of the cell to search around, may be off the map
+       * @param radius The largest offset to search along each axis, in cells
+       * @param best Filled with the coordinates of the closest cell, the first in row order on ties
+       * @return True if a cell with a valid potential was found
+       */
+      bool nearestReachable(int x, int y, int radius, int *best) const;
+
       /** display callback */
       void display(void fn(NavFn *nav), int n = 100); /**< <n> is the number of cycles between updates  */
       int displayInt;		/**< save second argument of display() above */
       void (*displayFn)(NavFn *nav); /**< display function itself */
 
+      /** tracing, see Tracer */
+      int traceInt;		/**< cycles between samples of the priority buffers in the trace, while tracing is enabled */
+      void traceProgress(int cells); /**< record a sample of the priority buffers and threshold, and the cells expanded so far */
+
       /** save costmap */
       void savemap(const char *fname); /**< write out costmap and start/goal states as fname.pgm and fname.txt */
 
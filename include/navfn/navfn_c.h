@@ -0,0 +1,102 @@
+/*********************************************************************
+*
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2008, Willow Garage, Inc.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*
+*********************************************************************/
+#ifndef NAVFN_NAVFN_C_H_
+#define NAVFN_NAVFN_C_H_
+
+/*
+ * A C interface to the planner for embedding it in other programs. Each
+ * context owns a planner whose buffers are reused from plan to plan while
+ * the map size stays the same. A context is used by one thread at a time,
+ * different contexts may plan concurrently. Pools hand out contexts to any
+ * number of threads. The planner never keeps or writes the memory it is
+ * given.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct navfn_context navfn_context;
+typedef struct navfn_pool navfn_pool;
+
+/* results of the calls; navfn_plan() returns a path length or one of the negative ones */
+#define NAVFN_OK 0
+#define NAVFN_INVALID -1	/* a bad argument, such as a start or goal off the map */
+#define NAVFN_NO_MEMORY -2
+#define NAVFN_NO_PATH -3	/* the goal can't be reached from the start */
+
+/* flags of navfn_plan() */
+#define NAVFN_ROS_COSTS 1	/* costs are in the ROS convention and translated, otherwise they are planner costs */
+#define NAVFN_ALLOW_UNKNOWN 2	/* with NAVFN_ROS_COSTS, plan through unknown cells */
+
+/* a context planning with A*, or NULL if it couldn't be allocated */
+navfn_context *navfn_create(void);
+
+/* frees a context, or gives a pooled one back to its pool; NULL is ignored */
+void navfn_destroy(navfn_context *ctx);
+
+/* propagate with an engine of the EngineRegistry, "dijkstra" or "astar"; NAVFN_INVALID if there is none such */
+int navfn_set_engine(navfn_context *ctx, const char *engine);
+
+/*
+ * Plans from start to goal, cells given as x, y. The costs, nx * ny of them
+ * with the origin at the upper left, are copied into the context's own
+ * buffer, so the caller's array is left untouched and may change as soon as
+ * the call returns. Writes at most nplan x, y points to plan, which has room
+ * for 2 * nplan floats. Returns the number of points written, NAVFN_NO_PATH if
+ * there is no path, or NAVFN_INVALID or NAVFN_NO_MEMORY.
+ */
+int navfn_plan(navfn_context *ctx, const unsigned char *costs, int nx, int ny, int flags,
+    const int goal[2], const int start[2], float *plan, int nplan);
+
+/*
+ * A pool of size contexts, or NULL if it couldn't be allocated. A thread
+ * asking for one while all are in use waits up to wait_time seconds, with at
+ * most queue_depth threads waiting.
+ */
+navfn_pool *navfn_pool_create(int size, int queue_depth, double wait_time);
+
+/* all contexts have to be back in the pool */
+void navfn_pool_destroy(navfn_pool *pool);
+
+/* a context of the pool, given back with navfn_destroy(), or NULL if none became free in time */
+navfn_context *navfn_pool_acquire(navfn_pool *pool);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,97 @@
+/*********************************************************************
+*
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2008, Willow Garage, Inc.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*
+*********************************************************************/
+#ifndef NAVFN_NAVFN_POOL_H_
+#define NAVFN_NAVFN_POOL_H_
+
+#include <navfn/navfn.h>
+#include <boost/thread.hpp>
+#include <boost/shared_ptr.hpp>
+#include <vector>
+
+namespace navfn {
+  /**
+   * @struct CostSnapshot
+   * @brief A translated cost array, with obstacle border, shared read-only by the planners of a pool
+   */
+  struct CostSnapshot {
+    int nx, ny;
+    std::vector<COSTTYPE> costs;
+  };
+
+  /**
+   * @class NavFnPool
+   * @brief A fixed set of NavFn instances handed out to concurrent plan requests. Each request leases
+   * one planner for its whole duration, so independent requests propagate in parallel instead of
+   * queueing behind a single planner.
+   */
+  class NavFnPool {
+    public:
+      /**
+       * @brief  Constructs the pool
+       * @param size The number of planners in the pool
+       * @param queue_depth The number of requests allowed to wait for a planner, further requests are rejected
+       * @param wait_time The time in seconds a request waits for a planner before giving up
+       */
+      NavFnPool(int size, int queue_depth, double wait_time);
+
+      ~NavFnPool();
+
+      /**
+       * @brief  Lease a planner, waiting up to the pool's wait time if all of them are busy
+       * @return The planner, returned to the pool when the last copy of the pointer goes away,
+       * or an empty pointer if the wait queue is full or the wait timed out
+       */
+      boost::shared_ptr<NavFn> acquire();
+
+      int size() const { return size_; } /**< number of planners in the pool */
+      int busy();			/**< number of planners currently leased */
+      int waiting();			/**< number of requests waiting for a planner */
+      unsigned int rejected();		/**< number of requests turned away so far */
+
+    private:
+      void release(NavFn* planner);
+
+      int size_, queue_depth_;
+      double wait_time_;
+      std::vector<NavFn*> free_;
+      int waiting_;
+      unsigned int rejected_;
+      boost::mutex mutex_;
+      boost::condition_variable cond_;
+  };
+};
+
+#endif
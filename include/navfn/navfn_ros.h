@@ -44,10 +44,27 @@
 #include <geometry_msgs/Point.h>
 #include <nav_msgs/Path.h>
 #include <tf/transform_datatypes.h>
+#include <map>
 #include <vector>
 #include <nav_core/base_global_planner.h>
 #include <nav_msgs/GetPlan.h>
+#include <nav_msgs/MapMetaData.h>
+#include <navfn/navfn_pool.h>
+#include <navfn/cost_translation_cache.h>
+#include <navfn/potential_field.h>
+#include <navfn/publish_queue.h>
+#include <navfn/plan_stats.h>
+#include <navfn/trace.h>
+#include <navfn/plan_recorder.h>
+#include <navfn/planner_engine.h>
+#include <navfn/potential_shm.h>
+#include <navfn/NavFnConfig.h>
+#include <dynamic_reconfigure/server.h>
+#include <std_srvs/Empty.h>
+#include <diagnostic_msgs/DiagnosticArray.h>
+#include <navfn/PotentialGrid.h>
 #include <navfn/potarr_point.h>
+#include <navfn/subgoal_segment_cache.h>
 #include <pcl_ros/publisher.h>
 #include <geometry_msgs/PoseArray.h> //added for sub_goal planning
 #include <geometry_msgs/PoseWithCovarianceStamped.h> // added for reading initial pose
@@ -113,6 +130,18 @@ namespace navfn {
        */
       bool makePlan(const geometry_msgs::PoseStamped& start, 
           const geometry_msgs::PoseStamped& goal, double tolerance, std::vector<geometry_msgs::PoseStamped>& plan);
+
+      /**
+       * @brief Given a goal pose in the world, compute a plan and report where the time went
+       * @param start The start pose 
+       * @param goal The goal pose 
+       * @param tolerance The tolerance on the goal point for the planner
+       * @param plan The plan... filled by the planner
+       * @param stats Filled with the time spent in each phase and the propagation counters of this plan
+       * @return True if a valid plan was found, false otherwise
+       */
+      bool makePlan(const geometry_msgs::PoseStamped& start, const geometry_msgs::PoseStamped& goal, double tolerance,
+          std::vector<geometry_msgs::PoseStamped>& plan, PlanStats& stats);
       /**
        * @brief Given a subgoal pose in the world, compute a plan. Needs to be truncated for reaching the end goal.
        * @param start The start pose
@@ -127,7 +156,21 @@ namespace navfn {
       void subgoalCallback(const geometry_msgs::PoseWithCovarianceStamped::ConstPtr& subgoal);
 
       /**
-       * @brief  Computes the full navigation function for the map given a point in the world to start from
+       * @brief Replace the dynamic obstacles stamped over the costmap for the next plans
+       * @param obstacles The centers of the obstacles, in the global frame
+       */
+      void dynamicObstaclesCallback(const geometry_msgs::PoseArray::ConstPtr& obstacles);
+
+      /**
+       * @brief Take the version of the shared costmap translation from the static map's load time
+       * @param info The metadata of the static map
+       */
+      void mapMetaDataCallback(const nav_msgs::MapMetaData::ConstPtr& info);
+
+      /**
+       * @brief  Computes the full navigation function for the map given a point in the world to start from. With a
+       * planner pool, makePlan() plans on leased planners, so getPlanFromPotential(), getPointPotential(),
+       * validPointPotential() and getGradientField() only answer for the potential computed here.
        * @param world_point The point to use for seeding the navigation function 
        * @return True if the navigation function was computed successfully, false otherwise
        */
@@ -148,6 +191,37 @@ namespace navfn {
        */
       double getPointPotential(const geometry_msgs::Point& world_point);
 
+      /**
+       * @brief Get the navigation function of the last computePotential() call. The field is never modified
+       * and can be used from any thread, without waiting for the planner.
+       * @return The field, empty if no potential was computed yet
+       */
+      boost::shared_ptr<const PotentialField> getPotentialField();
+
+      /**
+       * @brief Get the potential at a batch of points in the world, e.g. to score sampled trajectories
+       * (Note: You should call computePotential first). See PotentialField::sample().
+       * @param wx The x coordinates of the points
+       * @param wy The y coordinates of the points
+       * @param n The number of points
+       * @param potentials Filled with the n potentials, POT_HIGH for points that are off the map or unreachable
+       * @param interpolate Interpolate bilinearly between cell centers
+       * @param gradx If not NULL, filled with the x derivative of the potential, per meter
+       * @param grady If not NULL, filled with the y derivative of the potential, per meter
+       * @return True if a potential has been computed, false otherwise
+       */
+      bool getPotentials(const float* wx, const float* wy, unsigned int n, float* potentials,
+          bool interpolate = false, float* gradx = NULL, float* grady = NULL);
+
+      /**
+       * @brief Get the normalized gradient of the navigation function over the whole map, for controllers that
+       * follow the vector field directly (Note: You should call computePotential first)
+       * @param gradx Filled with the x component of the gradient, row-major with the size of the costmap
+       * @param grady Filled with the y component of the gradient
+       * @return True if the field is available, false otherwise
+       */
+      bool getGradientField(std::vector<float>& gradx, std::vector<float>& grady);
+
       /**
        * @brief Check for a valid potential value at a given point in the world (Note: You should call computePotential first)
        * @param world_point The point to get the potential for 
@@ -163,15 +237,37 @@ namespace navfn {
        */
       bool validPointPotential(const geometry_msgs::Point& world_point, double tolerance);
 
+      /**
+       * @brief Tell the planner that a rectangle of its costmap was written, for owners that stream updates into
+       * the costmap themselves. From the first call on, the planner keeps its translated costs between plans and
+       * only translates the rectangles it is told about, unless the costmap is resized.
+       * @param x0 The first column of the rectangle
+       * @param y0 The first row of the rectangle
+       * @param width The width of the rectangle, in cells
+       * @param height The height of the rectangle, in cells
+       */
+      void costmapRegionUpdated(unsigned int x0, unsigned int y0, unsigned int width, unsigned int height);
+
       /**
        * @brief  Publish a path for visualization purposes
        */
       void publishPlan(const std::vector<geometry_msgs::PoseStamped>& path, double r, double g, double b, double a);
 
-      ~NavfnROS(){}
+      ~NavfnROS(){
+        //the publisher thread may still be using the members below, and the diagnostics timer the publisher thread
+        diagnostics_timer_.stop();
+        publish_queue_.reset();
+      }
 
       bool makePlanService(nav_msgs::GetPlan::Request& req, nav_msgs::GetPlan::Response& resp);
 
+      /**
+       * @brief  Propagate the following plans with another engine of the EngineRegistry
+       * @param name The name of the engine
+       * @return False if there is no such engine, the current one is kept then
+       */
+      bool setEngine(const std::string& name);
+
     protected:
 
       /**
@@ -179,6 +275,7 @@ namespace navfn {
        */
       costmap_2d::Costmap2D* costmap_;
       boost::shared_ptr<NavFn> planner_;
+      boost::shared_ptr<NavFnPool> planner_pool_;
       ros::Publisher plan_pub_;
       pcl_ros::Publisher<PotarrPoint> potarr_pub_;
       bool initialized_, allow_unknown_, visualize_potential_;
@@ -192,10 +289,157 @@ namespace navfn {
       }
 
       void mapToWorld(double mx, double my, double& wx, double& wy);
+
+      void reconfigureCB(NavFnConfig& config, uint32_t level);
+
+      /**
+       * @brief Plan a single leg from start to goal on the given planner
+       * @param planner The planner to use, either planner_ or one leased from the pool
+       * @param start The start pose
+       * @param goal The goal pose
+       * @param tolerance The tolerance on the goal point for the planner
+       * @param plan The plan... filled by the planner
+       * @param stats The times and counters of the leg are added to these
+       * @return True if a valid plan was found, false otherwise
+       */
+      bool planLeg(NavFn& planner, const geometry_msgs::PoseStamped& start,
+          const geometry_msgs::PoseStamped& goal, double tolerance, std::vector<geometry_msgs::PoseStamped>& plan,
+          PlanStats& stats);
+
+      /**
+       * @brief Plan a request through the queued subgoals, the body of makePlan
+       */
+      bool planRequest(const geometry_msgs::PoseStamped& start, const geometry_msgs::PoseStamped& goal, double tolerance,
+          std::vector<geometry_msgs::PoseStamped>& plan, PlanStats& stats);
+
+      /**
+       * @brief Follow the potential of a planner back from the goal, after the potential has been computed
+       */
+      bool extractPlan(NavFn& planner, const geometry_msgs::PoseStamped& goal, std::vector<geometry_msgs::PoseStamped>& plan,
+          PlanStats* stats = NULL);
+
+      /**
+       * @brief Publish the latency percentiles of the plans since the last call as diagnostics and start over
+       */
+      void publishDiagnostics(const ros::TimerEvent& event);
+
+      /**
+       * @brief Write the events recorded by the Tracer to trace_file_ as Chrome trace JSON
+       */
+      bool dumpTraceService(std_srvs::Empty::Request& req, std_srvs::Empty::Response& resp);
+
+      /**
+       * @brief Write the trace if SIGUSR1 was received since the last call
+       */
+      void checkTraceSignal(const ros::TimerEvent& event);
+
+      /**
+       * @brief Get the potential of a planner at a given point in the world
+       */
+      double getPointPotential(const NavFn& planner, const geometry_msgs::Point& world_point);
+
+      /**
+       * @brief Lease a planner from the pool, or return planner_ when there is no pool
+       * @return The planner, empty if the pool could not serve the request
+       */
+      boost::shared_ptr<NavFn> leasePlanner();
+
+      /**
+       * @brief Check that planner_ holds a potential for the potential queries, logging why not
+       */
+      bool hasPotential();
+
+      /**
+       * @brief Get the translated costmap shared by the planners of the pool, translating it again once it is too old
+       */
+      boost::shared_ptr<const CostSnapshot> getCostSnapshot();
+
+      /**
+       * @brief Load the current costs into a planner, by copy, as a view of the costmap, from a shared translation, or by keeping what it already has
+       * @param planner The planner to load
+       * @param snapshot Set to the shared snapshot the planner now points into, which must be kept alive while planning
+       * @param costmap_lock An unlocked lock on the costmap, locked here if the planner views the costmap and held while planning
+       * @return True if the planner kept costs translated before this call, which may not match the costmap everywhere
+       */
+      bool loadCostmap(NavFn& planner, boost::shared_ptr<const CostSnapshot>& snapshot,
+          boost::unique_lock<costmap_2d::Costmap2D::mutex_t>& costmap_lock);
+
+      /**
+       * @brief Append an unoriented pose in the global frame to a plan
+       * @param mx The x map coordinate of the pose, in cells
+       * @param my The y map coordinate of the pose, in cells
+       */
+      void appendPose(double mx, double my, const ros::Time& stamp, std::vector<geometry_msgs::PoseStamped>& plan);
+
+      /**
+       * @brief Append the cached legs of a route to a plan, stopping at the first leg that is not available yet
+       * @param route The remaining subgoals followed by the goal, the plan already ends at route[0]
+       * @param plan The plan to extend
+       */
+      void appendCachedSegments(const std::vector<geometry_msgs::Pose>& route, std::vector<geometry_msgs::PoseStamped>& plan);
+      /**
+       * @brief Stamp the current dynamic obstacles over the costs loaded in a planner, replacing the ones of the previous plan
+       */
+      void stampDynamicObstacles(NavFn& planner);
+      /**
+       * @brief Publish a copy of a planner's potential for getPotentialField(), reusing the buffer of a field no one holds anymore
+       */
+      void publishPotentialField(const NavFn& planner);
+
+      /**
+       * @brief Hand a decimated copy of a planner's potential to the publisher thread for visualization, rate limited
+       */
+      void publishPotential(const NavFn& planner);
+
+      /**
+       * @brief Build and publish the visualization of a potential in the configured encoding, on the publisher thread
+       */
+      void buildPotentialMessage(const boost::shared_ptr<PotentialField>& field, float start_pot, const ros::Time& stamp);
+
+      /**
+       * @brief Keep the field of a published frame for publishPotential() to fill with the next one
+       */
+      void recyclePotential(const boost::shared_ptr<PotentialField>& field);
+
+      /**
+       * @brief Queue a copy of the subgoals for publication, the caller holds subgoal_mutex_
+       */
+      void publishSubgoals();
       void clearRobotCell(const tf::Stamped<tf::Pose>& global_pose, unsigned int mx, unsigned int my);
       double planner_window_x_, planner_window_y_, default_tolerance_, subgoal_tolerance_;
+      bool simplify_path_, dense_gradient_, costmap_view_, incremental_costmap_;
+      bool streamed_costs_; /**< planner_ holds costs pushed through costmapRegionUpdated() */
+      bool static_costmap_, static_loaded_; /**< translate the costmap once, dynamic obstacles come from the overlay */
+      double dynamic_obstacle_radius_;
+      boost::mutex dynamic_mutex_; /**< guards dynamic_obstacles_ */
+      std::vector<geometry_msgs::Pose> dynamic_obstacles_;
+      ros::Subscriber dynamic_obstacles_sub_;
+      boost::shared_ptr<const PotentialField> potential_field_; /**< only accessed through boost::atomic_load/exchange */
+      boost::mutex field_mutex_; /**< guards spare_potential_ */
+      std::vector<float> spare_potential_;
+      std::string potential_encoding_;
+      int potential_decimation_;
+      double potential_rate_;
+      ros::WallTime last_potential_pub_;
+      boost::mutex potential_viz_mutex_; /**< guards last_potential_pub_ and spare_viz_field_ */
+      boost::shared_ptr<PotentialField> spare_viz_field_; /**< the last visualized field, reused by the next frame */
+      PotentialGrid potential_grid_; /**< reused by the publisher thread only, like potential_cloud_ */
+      pcl::PointCloud<PotarrPoint> potential_cloud_;
+      ros::Publisher potential_grid_pub_;
+      double path_spacing_;
       std::string tf_prefix_;
-      boost::mutex mutex_;
+      boost::mutex mutex_; /**< serializes requests on planner_ when there is no pool */
+      boost::atomic<bool> planner_potential_; /**< planner_ has propagated, so the potential queries have something to read */
+      boost::mutex subgoal_mutex_; /**< guards v_subgoals_ */
+      boost::mutex snapshot_mutex_;
+      boost::shared_ptr<const CostSnapshot> cost_snapshot_;
+      ros::WallTime snapshot_time_;
+      double snapshot_max_age_;
+      bool shared_costmap_cache_; /**< take translated costs from the process-wide CostTranslationCache */
+      std::string shared_costmap_id_; /**< the map the costmap is made from, as known to the cache */
+      boost::atomic<uint64_t> map_version_; /**< load time of that map in ns, 0 until its metadata arrives */
+      ros::Subscriber map_metadata_sub_;
+      boost::shared_ptr<const CostSnapshot> planner_costs_; /**< the shared translation planner_ points into, guarded by mutex_ */
       ros::ServiceServer make_plan_srv_;
       std::string global_frame_;
 
@@ -204,6 +448,21 @@ namespace navfn {
       geometry_msgs::PoseArray v_subgoals_;
       ros::Publisher subgoal_pub_;
       ros::Subscriber subgoal_pose_sub_;
+      boost::shared_ptr<SubgoalSegmentCache> segment_cache_;
+      boost::shared_ptr<PublishQueue> publish_queue_;
+      boost::mutex stats_mutex_; /**< guards plan_stats_ */
+      PlanStatsAggregator plan_stats_;
+      std::map<std::string, PlanStatsAggregator> engine_stats_; /**< the plans of each engine, also guarded by stats_mutex_ */
+      std::string diagnostics_name_;
+      ros::Publisher diagnostics_pub_;
+      ros::Timer diagnostics_timer_;
+      std::string trace_file_;
+      ros::ServiceServer dump_trace_srv_;
+      ros::Timer trace_timer_;
+      boost::shared_ptr<PlanRecorder> recorder_; /**< NULL unless plans are recorded */
+      boost::shared_ptr<const PlannerEngine> engine_; /**< swapped atomically, legs take a copy before propagating */
+      boost::shared_ptr<dynamic_reconfigure::Server<NavFnConfig> > dsrv_;
+      boost::shared_ptr<PotentialShmWriter> potential_shm_; /**< NULL unless the potential is exported */
   };
 };
 
@@ -0,0 +1,87 @@
+/*********************************************************************
+*
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2008, Willow Garage, Inc.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*
+*********************************************************************/
+#ifndef NAVFN_PGM_MAP_H_
+#define NAVFN_PGM_MAP_H_
+
+#include <string>
+#include <vector>
+
+namespace navfn {
+  /**
+   * @class PgmMap
+   * @brief Reads PGM images, binary (P5) and plain (P2), without netpbm. An 8-bit binary image is memory mapped
+   * and its pixels are used in place, so a map of any size opens in constant time. Plain images are read into a
+   * buffer the map owns, and 16-bit ones are scaled down to 0-255 on the way; 8-bit values are never scaled, as
+   * costmaps store costs rather than gray levels.
+   */
+  class PgmMap {
+    public:
+      PgmMap();
+      ~PgmMap();
+
+      /**
+       * @brief  Open an image, closing the one open before
+       * @return False if the file can't be read or is not a well formed PGM image
+       */
+      bool open(const std::string& path);
+      void close();
+
+      int width() const { return width_; }
+      int height() const { return height_; }
+      int maxval() const { return maxval_; }
+
+      /**
+       * @brief  The pixels, width() * height() bytes in rows from the top, valid until the image is closed
+       */
+      const unsigned char* data() const { return data_; }
+
+      /**
+       * @brief  True if data() points into the mapped file rather than a converted copy
+       */
+      bool mapped() const { return data_ && pixels_.empty(); }
+
+    private:
+      bool parse(const unsigned char* bytes, size_t size);
+
+      void* map_;
+      size_t map_size_;
+      const unsigned char* data_;
+      std::vector<unsigned char> pixels_;
+      int width_, height_, maxval_;
+  };
+};
+
+#endif
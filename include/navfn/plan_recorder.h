@@ -0,0 +1,101 @@
+/*********************************************************************
+*
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2008, Willow Garage, Inc.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*
+*********************************************************************/
+#ifndef NAVFN_PLAN_RECORDER_H_
+#define NAVFN_PLAN_RECORDER_H_
+
+#include <navfn/navfn.h>
+#include <navfn/planning_snapshot.h>
+#include <navfn/publish_queue.h>
+#include <boost/atomic.hpp>
+#include <boost/shared_ptr.hpp>
+#include <string>
+
+namespace navfn {
+  /**
+   * @class PlanRecorder
+   * @brief Records plans as planning snapshots into a ring of files in a directory, plan_0000.navfn and on, so
+   * slow or failing plans seen in the field can be replayed with navfn_replay. Plans are recorded every so many
+   * plans or when they take longer than a threshold; the planner's arrays are copied on the planning thread and
+   * the file is written by the publish queue.
+   */
+  class PlanRecorder {
+    public:
+      /**
+       * @brief  Constructs a recorder, creating its directory if needed
+       * @param directory Where the recordings are written, numbering carries on after the newest one in it
+       * @param ring The number of recordings kept, the oldest one is overwritten by the next
+       * @param every Record every this many plans, 0 for none
+       * @param latency Record plans that took longer than this many seconds, 0 for none
+       * @param flags SNAPSHOT_POTENTIAL, SNAPSHOT_PATH and SNAPSHOT_LZ4 for the recordings
+       */
+      PlanRecorder(const std::string& directory, int ring, int every, double latency, int flags);
+
+      /**
+       * @brief  Count a plan and tell whether to record it, safe to call from several planning threads
+       * @param latency How long the plan took, in seconds
+       */
+      bool wants(double latency);
+
+      /**
+       * @brief  Copy a planner's problem and result, and write them to the next file of the ring
+       * @param planner The planner, after its path was calculated
+       * @param info The problem, nx, ny, start, goal and the path are taken from the planner
+       * @param queue Writes the file, or NULL to write it from the calling thread. Recordings are dropped when
+       * it is full.
+       */
+      void record(const NavFn& planner, const SnapshotInfo& info, PublishQueue* queue);
+
+      /**
+       * @brief  The number of recordings written
+       */
+      unsigned long recorded() const { return recorded_; }
+
+    private:
+      struct Recording;
+      void write(const boost::shared_ptr<Recording>& rec);
+
+      std::string directory_;
+      unsigned int ring_;
+      unsigned int every_;
+      double latency_;
+      int flags_;
+      boost::atomic<unsigned long> plans_;
+      boost::atomic<unsigned long> slot_;
+      boost::atomic<unsigned long> recorded_;
+  };
+};
+
+#endif
@@ -0,0 +1,141 @@
+/*********************************************************************
+*
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2008, Willow Garage, Inc.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*
+*********************************************************************/
+#ifndef NAVFN_PLAN_STATS_H_
+#define NAVFN_PLAN_STATS_H_
+
+#include <diagnostic_msgs/DiagnosticStatus.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace navfn {
+  /**
+   * @struct PlanStats
+   * @brief Where the time of one makePlan call went, and how much propagation work it did. Times are in seconds
+   * and summed over every leg planned by the call.
+   */
+  struct PlanStats {
+    PlanStats() : translate(0.0), setup(0.0), propagate(0.0), path(0.0), tolerance(0.0), build(0.0), publish(0.0),
+      total(0.0), cycles(0), cells(0), max_buffer(0), path_len(0), found(false), engine(NULL) {}
+
+    double translate; /**< loading the costmap into the planner, including dynamic obstacles */
+    double setup; /**< setupNavFn */
+    double propagate; /**< the wavefront propagation */
+    double path; /**< calcPath and path simplification */
+    double tolerance; /**< the search for a reachable cell near the goal */
+    double build; /**< building the plan poses */
+    double publish; /**< handing the plan and visualization to the publisher thread */
+    double total; /**< the whole call */
+    int cycles; /**< propagation cycles */
+    int cells; /**< cells put into priority blocks */
+    int max_buffer; /**< largest priority block */
+    int path_len; /**< poses in the plan */
+    bool found;
+    const char* engine; /**< name of the engine that propagated the last leg, NULL if none did */
+  };
+
+  /**
+   * @class LatencyHistogram
+   * @brief A histogram of durations in the spirit of HdrHistogram: buckets are linear within each power of two, so
+   * every recorded value is kept to within about 3% from a microsecond up to days, in constant memory and time.
+   */
+  class LatencyHistogram {
+    public:
+      LatencyHistogram();
+
+      /**
+       * @brief  Record a duration
+       * @param seconds The duration, negative values count as 0
+       */
+      void record(double seconds);
+
+      /**
+       * @brief  The duration below which a fraction of the recorded ones fall
+       * @param q The fraction, in [0, 1]
+       * @return The upper bound of the bucket holding that rank, in seconds, 0 if nothing was recorded
+       */
+      double percentile(double q) const;
+
+      double max() const { return max_ * 1e-6; }
+      double mean() const { return count_ ? sum_ * 1e-6 / count_ : 0.0; }
+      uint64_t count() const { return count_; }
+
+      void reset();
+
+    private:
+      static int bucket(uint64_t usec);
+      static uint64_t upperBound(int bucket);
+
+      std::vector<uint64_t> counts_;
+      uint64_t count_, max_;
+      double sum_;
+  };
+
+  /**
+   * @class PlanStatsAggregator
+   * @brief Collects the PlanStats of many plans into a histogram per phase and summarizes them as a diagnostic
+   * status. It is not thread safe, its owner serializes access.
+   */
+  class PlanStatsAggregator {
+    public:
+      PlanStatsAggregator();
+
+      void record(const PlanStats& stats);
+
+      /**
+       * @brief  Summarize the plans recorded since the last reset: percentiles per phase and mean counters
+       * @param status Filled with one key/value pair per phase and counter, its name and hardware id are left alone
+       */
+      void summarize(diagnostic_msgs::DiagnosticStatus& status) const;
+
+      /**
+       * @brief  The number of plans recorded since the last reset
+       */
+      uint64_t plans() const { return plans_; }
+
+      void reset();
+
+    private:
+      enum { TRANSLATE, SETUP, PROPAGATE, PATH, TOLERANCE, BUILD, PUBLISH, TOTAL, NUM_PHASES };
+
+      LatencyHistogram phases_[NUM_PHASES];
+      uint64_t plans_, failed_;
+      double cycles_, cells_;
+      int max_buffer_;
+  };
+};
+
+#endif
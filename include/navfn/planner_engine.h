@@ -0,0 +1,123 @@
+/*********************************************************************
+*
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2008, Willow Garage, Inc.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*
+*********************************************************************/
+#ifndef NAVFN_PLANNER_ENGINE_H_
+#define NAVFN_PLANNER_ENGINE_H_
+
+#include <navfn/navfn.h>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace navfn {
+  /**
+   * @class PlannerEngine
+   * @brief A way of propagating the potential of a NavFn. Engines hold no state of their own, one instance is
+   * shared by every planner and thread; all of a propagation's state is in the planner, so it can be run in
+   * steps.
+   */
+  class PlannerEngine {
+    public:
+      virtual ~PlannerEngine() {}
+
+      /**
+       * @brief  The name the engine is selected by
+       */
+      virtual const char* name() const = 0;
+
+      /**
+       * @brief  Propagate the potential of a planner prepared with setupNavFn(true), from its goal towards its start
+       * @param planner The planner, its propCycles, propCells and propMaxBuf describe the work done
+       * @return True if the start was reached, or the whole map covered
+       */
+      bool propagate(NavFn& planner) const {
+        return step(planner, maxCycles(planner), false);
+      }
+
+      /**
+       * @brief  Run a part of a propagation
+       * @param planner The planner, prepared with setupNavFn(true), its propCycles, propCells and propMaxBuf
+       * describe the work done by this step
+       * @param cycles The most cycles to run
+       * @param resume False for the first step of a propagation, true for the ones continuing it
+       * @return True if the start was reached, or the whole map covered
+       */
+      virtual bool step(NavFn& planner, int cycles, bool resume) const = 0;
+
+      /**
+       * @brief  The cycles a whole propagation may take before it is given up
+       */
+      static int maxCycles(const NavFn& planner){
+        return std::max(planner.nx * planner.ny / 20, planner.nx + planner.ny);
+      }
+  };
+
+  /**
+   * @class EngineRegistry
+   * @brief The engines planners can be switched between at run time, by name. It starts out with "dijkstra",
+   * which computes the full navigation function up to the start, and "astar", which expands towards the start first
+   * and usually touches far fewer cells.
+   */
+  class EngineRegistry {
+    public:
+      static EngineRegistry& instance();
+
+      /**
+       * @brief  Add an engine, replacing one of the same name
+       */
+      void add(const boost::shared_ptr<const PlannerEngine>& engine);
+
+      /**
+       * @brief  The engine of a name, or NULL if there is none
+       */
+      boost::shared_ptr<const PlannerEngine> get(const std::string& name) const;
+
+      /**
+       * @brief  The names of the engines, in order
+       */
+      std::vector<std::string> names() const;
+
+    private:
+      EngineRegistry();
+
+      mutable boost::mutex mutex_;
+      std::map<std::string, boost::shared_ptr<const PlannerEngine> > engines_;
+  };
+};
+
+#endif
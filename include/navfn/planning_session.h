@@ -0,0 +1,102 @@
+/*********************************************************************
+*
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2008, Willow Garage, Inc.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*
+*********************************************************************/
+#ifndef NAVFN_PLANNING_SESSION_H_
+#define NAVFN_PLANNING_SESSION_H_
+
+#include <navfn/navfn.h>
+#include <navfn/planner_engine.h>
+#include <boost/shared_ptr.hpp>
+#include <stdint.h>
+
+namespace navfn {
+  /**
+   * @class PlanningSession
+   * @brief One plan spread over several time slices, for callers that can only give the planner a few
+   * milliseconds at a time. begin() starts a plan, each step() resets the planner's arrays a few rows at a time and
+   * then propagates, for at most about its budget, and finish() extracts the path. Only step() is bounded, finish()
+   * runs whatever is left in one go. The priority blocks, threshold and potential stay in the planner in between,
+   * so the planner must not be used for anything else until the session is finished.
+   */
+  class PlanningSession {
+    public:
+      /**
+       * @param planner The planner, with its costs, start and goal set
+       * @param engine The engine propagating the potential, Dijkstra if NULL
+       */
+      PlanningSession(NavFn& planner, const boost::shared_ptr<const PlannerEngine>& engine =
+          boost::shared_ptr<const PlannerEngine>());
+
+      /**
+       * @brief  Start a plan. It takes constant time, the setup of the planner's arrays is left to step()
+       */
+      void begin();
+
+      /**
+       * @brief  Set up and propagate for about <budget> seconds, beginning the plan first if needed. Setup runs
+       * in chunks of rows and propagation in batches of cycles, both sized from the ones timed before, and a step
+       * does at least one chunk or one cycle.
+       * @return True once propagation is complete, further steps do nothing then
+       */
+      bool step(double budget);
+
+      /**
+       * @brief  Complete the propagation without a budget, if it isn't, and calculate the path
+       * @return True if a path was found
+       */
+      bool finish();
+
+      bool propagated() const { return propagated_; }
+
+      int steps() const { return steps_; }
+      int cycles() const { return cycles_; } /**< propagation cycles so far */
+      int cells() const { return cells_; }   /**< cells put into priority blocks so far */
+
+    private:
+      bool startReached() const;
+      bool setup(uint64_t deadline);
+      void run(int cycles);
+
+      NavFn& planner_;
+      boost::shared_ptr<const PlannerEngine> engine_;
+      bool begun_, propagated_;
+      int steps_, cycles_, cells_, max_buffer_;
+      int setup_row_;     /**< next row to set up, the planner's height once setup is done */
+      double row_time_;   /**< seconds per row of setup, from the last chunk */
+      double cycle_time_; /**< seconds per cycle, averaged over the cycles run so far */
+  };
+};
+
+#endif
@@ -0,0 +1,158 @@
+/*********************************************************************
+*
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2008, Willow Garage, Inc.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*
+*********************************************************************/
+#ifndef NAVFN_PLANNING_SNAPSHOT_H_
+#define NAVFN_PLANNING_SNAPSHOT_H_
+
+#include <navfn/navfn.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// the version written; files of a newer major version are refused, minor versions only add sections
+#define SNAPSHOT_VERSION_MAJOR 1
+#define SNAPSHOT_VERSION_MINOR 0
+
+namespace navfn {
+  /**
+   * @struct SnapshotInfo
+   * @brief The problem a snapshot holds besides its arrays, stored as is in the file header
+   */
+  struct SnapshotInfo {
+    SnapshotInfo() : nx(0), ny(0), tolerance(0.0), resolution(0.0), origin_x(0.0), origin_y(0.0),
+      pri_inc(2 * COST_NEUTRAL), allow_unknown(1), astar(0), path_len(0) {
+      start[0] = start[1] = goal[0] = goal[1] = 0;
+      reserved[0] = reserved[1] = 0;
+    }
+
+    int32_t nx, ny;
+    int32_t start[2], goal[2]; /**< as set on the planner, i.e. flipped with respect to the robot's request */
+    double tolerance;          /**< the goal tolerance of the request, in meters */
+    double resolution, origin_x, origin_y;
+    float pri_inc;
+    uint8_t allow_unknown;
+    uint8_t astar;             /**< propagated with A* instead of Dijkstra */
+    uint8_t reserved[2];
+    int32_t path_len;          /**< points in the path section, if there is one */
+  };
+
+  enum {
+    SNAPSHOT_POTENTIAL = 1, /**< also store the potential of the planner */
+    SNAPSHOT_PATH = 2,      /**< also store the path of the planner */
+    SNAPSHOT_LZ4 = 4        /**< compress the sections with LZ4 */
+  };
+
+  /**
+   * @class PlanningSnapshot
+   * @brief A versioned binary file holding a planning problem: the raw and translated costs, start, goal, tolerance and
+   * parameters, and optionally the potential and path the planner found. Sections are 64 byte aligned, so uncompressed
+   * ones are used straight from the memory mapped file and opening even a large snapshot costs next to nothing;
+   * compressed sections are inflated the first time they are asked for.
+   */
+  class PlanningSnapshot {
+    public:
+      PlanningSnapshot();
+      ~PlanningSnapshot();
+
+      /**
+       * @brief  Write a snapshot of a planner
+       * @param path The file to write
+       * @param info The problem, nx, ny, start, goal, pri_inc and path_len are taken from the planner
+       * @param raw_costs The costmap in the ROS convention the planner's costs were translated from, or NULL
+       * @param planner The planner, its translated costs are stored as it reads them
+       * @param flags SNAPSHOT_POTENTIAL, SNAPSHOT_PATH and SNAPSHOT_LZ4
+       * @return False if the file could not be written
+       */
+      static bool save(const std::string& path, const SnapshotInfo& info, const unsigned char* raw_costs,
+          const NavFn& planner, int flags);
+
+      /**
+       * @brief  Write a snapshot of copied arrays, for writing it away from the planning thread
+       * @param info The problem, nx and ny give the size of the arrays and path_len that of the path
+       * @param raw_costs The costmap in the ROS convention, or NULL
+       * @param costs The translated costs
+       * @param potential The potential, or NULL
+       * @param pathx, pathy The path, or NULL
+       * @param flags SNAPSHOT_LZ4, the sections stored are the ones given
+       * @return False if the file could not be written
+       */
+      static bool save(const std::string& path, const SnapshotInfo& info, const unsigned char* raw_costs,
+          const COSTTYPE* costs, const float* potential, const float* pathx, const float* pathy, int flags);
+
+      /**
+       * @brief  Map a snapshot, checking its header and section table, and that the sections have the sizes the
+       * header gives
+       * @return False if the file can't be read or is not a snapshot of a version we understand
+       */
+      bool open(const std::string& path);
+      void close();
+
+      const SnapshotInfo& info() const { return info_; }
+
+      /** the sections, NULL if the snapshot doesn't have them */
+      const unsigned char* rawCosts();
+      const COSTTYPE* costs();
+      const float* potential();
+      const float* pathX();
+      const float* pathY(); /**< path_len points after pathX() */
+
+      /**
+       * @brief  Load the translated costs, start and goal into a planner of the snapshot's size, ready to propagate.
+       * The costs are borrowed through setCostArr(), so the snapshot has to stay open while the planner uses them.
+       * @return False if the sizes differ, or the snapshot has no costs or costs without an obstacle border
+       */
+      bool restore(NavFn& planner);
+
+    private:
+      enum { RAW_COSTS = 1, COSTS = 2, POTENTIAL = 3, PATH = 4, NUM_SECTIONS };
+
+      struct Section {
+        uint32_t type, codec;  /**< codec 0 is raw, 1 is LZ4 */
+        uint64_t offset, size; /**< where the stored bytes are in the file */
+        uint64_t raw_size;     /**< size once decompressed */
+      };
+
+      const void* section(uint32_t type);
+
+      SnapshotInfo info_;
+      void* map_;
+      size_t map_size_;
+      const Section* sections_;
+      uint32_t nsections_;
+      std::vector<char> inflated_[NUM_SECTIONS];
+  };
+};
+
+#endif
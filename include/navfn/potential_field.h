@@ -0,0 +1,89 @@
+/*********************************************************************
+*
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2008, Willow Garage, Inc.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*
+*********************************************************************/
+#ifndef NAVFN_POTENTIAL_FIELD_H_
+#define NAVFN_POTENTIAL_FIELD_H_
+
+#include <navfn/navfn.h>
+#include <vector>
+
+namespace navfn {
+  /**
+   * @class PotentialField
+   * @brief A read-only copy of a navigation function together with the geometry of its costmap. Once
+   * published it is never modified, so it can be sampled from any thread without holding the planner,
+   * while the planner goes on with the next request.
+   */
+  class PotentialField {
+    public:
+      PotentialField() : nx(0), ny(0), origin_x(0.0), origin_y(0.0), resolution(1.0) {}
+
+      /**
+       * @brief  Copy the potential of a planner, reusing the capacity of this field's buffer
+       * @param planner The planner, after propagation
+       * @param ox The x origin of the costmap, in meters
+       * @param oy The y origin of the costmap, in meters
+       * @param res The resolution of the costmap, in meters per cell
+       */
+      void copyFrom(const NavFn& planner, double ox, double oy, double res);
+
+      /**
+       * @brief  Sample the potential at a batch of points in the world. Points off the map or not reached by the
+       * propagation get POT_HIGH.
+       * @param wx The x coordinates of the points
+       * @param wy The y coordinates of the points
+       * @param n The number of points
+       * @param pot Filled with the n potentials
+       * @param interpolate Interpolate bilinearly between cell centers instead of taking the cell's value.
+       * Where a neighboring cell was not reached the cell's own value is used.
+       * @param gradx If not NULL, filled with the x derivative of the interpolated potential, per meter, 0 where it is undefined
+       * @param grady If not NULL, filled with the y derivative of the interpolated potential
+       */
+      void sample(const float* wx, const float* wy, unsigned int n, float* pot,
+          bool interpolate = false, float* gradx = NULL, float* grady = NULL) const;
+
+      int nx, ny;
+      double origin_x, origin_y, resolution;
+      std::vector<float> pot;
+
+    private:
+      float at(int x, int y) const {
+        return (x < 0 || y < 0 || x >= nx || y >= ny) ? (float)POT_HIGH : pot[y * nx + x];
+      }
+      void bilinear(int ix, int iy, float tx, float ty, bool interpolate, float* pot, float* gx, float* gy) const;
+  };
+};
+
+#endif
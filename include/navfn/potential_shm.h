@@ -0,0 +1,178 @@
+/*********************************************************************
+*
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2008, Willow Garage, Inc.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*
+*********************************************************************/
+#ifndef NAVFN_POTENTIAL_SHM_H_
+#define NAVFN_POTENTIAL_SHM_H_
+
+#include <boost/atomic.hpp>
+#include <boost/thread/mutex.hpp>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+namespace navfn {
+  /**
+   * @struct PotentialInfo
+   * @brief The geometry and origin of an exported potential
+   */
+  struct PotentialInfo {
+    PotentialInfo() {
+      // all of it, frame_id included, ends up in the segment
+      memset(this, 0, sizeof(*this));
+    }
+
+    int32_t nx, ny;
+    double resolution;       /**< meters per cell */
+    double origin_x, origin_y; /**< world position of cell 0, 0 */
+    int32_t start[2], goal[2]; /**< as set on the planner, the potential is 0 at goal */
+    uint64_t stamp;          /**< nanoseconds since the epoch when the potential was computed */
+    uint64_t plan;           /**< counts the potentials exported, set by the writer */
+    char frame_id[64];
+  };
+
+  /**
+   * @class PotentialShm
+   * @brief The layout of the shared memory segment the planner exports its potential through: a header followed
+   * by two buffers of potentials. The writer fills the buffer readers are not pointed at, then flips front, so a
+   * reader can use the front buffer in place; each buffer's sequence number is odd while it is written and is
+   * checked again after reading, so a reader still using a buffer when the writer comes back to it notices.
+   */
+  struct PotentialShm {
+    struct Buffer {
+      boost::atomic<uint64_t> seq;
+      PotentialInfo info;
+      uint64_t offset;       /**< of the potentials, from the start of the segment */
+    };
+
+    char magic[8];           /**< "NAVFNPOT" */
+    uint32_t version;
+    uint32_t header_size;
+    uint64_t capacity;       /**< cells each buffer has room for */
+    boost::atomic<uint32_t> stale; /**< set when the writer replaced the segment by a larger one, readers reopen it */
+    boost::atomic<uint32_t> front; /**< the buffer holding the latest potential */
+    Buffer buffers[2];
+  };
+
+  /**
+   * @class PotentialShmWriter
+   * @brief Exports potentials into a POSIX shared memory segment, the segment is removed when the writer goes
+   * away. publish() may be called from several threads.
+   */
+  class PotentialShmWriter {
+    public:
+      PotentialShmWriter();
+      ~PotentialShmWriter();
+
+      /**
+       * @brief  Create the segment, replacing one of the same name
+       * @param name The name of the segment, such as "/navfn_potential"
+       * @param capacity Cells the buffers have room for, the segment grows when a larger potential is published
+       * @return False if the segment could not be created
+       */
+      bool open(const std::string& name, size_t capacity);
+      void close();
+
+      /**
+       * @brief  Copy a potential of info.nx * info.ny cells into the segment and make it the latest
+       * @return False if the writer is not open, or a larger segment could not be made
+       */
+      bool publish(const PotentialInfo& info, const float* potential);
+
+    private:
+      bool create(size_t capacity);
+
+      boost::mutex mutex_;
+      std::string name_;
+      void* map_;
+      size_t map_size_;
+      uint64_t plans_;
+  };
+
+  /**
+   * @class PotentialShmReader
+   * @brief Reads the potentials a PotentialShmWriter exports, in place
+   */
+  class PotentialShmReader {
+    public:
+      /**
+       * @struct View
+       * @brief The latest potential, in the writer's buffer
+       */
+      struct View {
+        View() : potential(NULL), seq(0), buffer(0) {}
+        PotentialInfo info;
+        const float* potential;
+        uint64_t seq;
+        int buffer;
+      };
+
+      PotentialShmReader();
+      ~PotentialShmReader();
+
+      /**
+       * @brief  Map the segment of a writer
+       * @return False if there is none, or it is not a potential export
+       */
+      bool open(const std::string& name);
+      void close();
+
+      /**
+       * @brief  Look at the latest potential without copying it. Check the view with valid() once done with it; it
+       * can be used until the next call to latest() or copy(), which may map a segment the writer replaced.
+       * @return False if nothing was exported yet
+       */
+      bool latest(View& view);
+
+      /**
+       * @brief  Whether the writer left a view's buffer alone since latest() returned it, so what was read is
+       * consistent
+       */
+      bool valid(const View& view) const;
+
+      /**
+       * @brief  Copy the latest potential, retrying until the copy is consistent
+       * @return False if nothing was exported yet
+       */
+      bool copy(PotentialInfo& info, std::vector<float>& potential);
+
+    private:
+      std::string name_;
+      void* map_;
+      size_t map_size_;
+  };
+};
+
+#endif
@@ -0,0 +1,130 @@
+/*********************************************************************
+*
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2008, Willow Garage, Inc.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*
+*********************************************************************/
+#ifndef NAVFN_PUBLISH_QUEUE_H_
+#define NAVFN_PUBLISH_QUEUE_H_
+
+#include <ros/ros.h>
+#include <boost/atomic.hpp>
+#include <boost/function.hpp>
+#include <boost/lockfree/queue.hpp>
+#include <boost/thread.hpp>
+#include <utility>
+
+namespace navfn {
+  /**
+   * @class PublishQueue
+   * @brief Moves message construction and publication off the planning threads. Planners hand
+   * finished messages, or functions building them from immutable snapshots, to a bounded lock-free
+   * queue and return right away; a single publisher thread runs them in order. When the queue is
+   * full, droppable jobs are dropped and the others wait for room, so they keep their order.
+   */
+  class PublishQueue {
+    public:
+      /**
+       * @brief  Constructs the queue and starts the publisher thread
+       * @param capacity The number of jobs that may be waiting at once
+       */
+      explicit PublishQueue(unsigned int capacity);
+
+      /**
+       * @brief  Stops the publisher thread, jobs still queued or waiting for room are dropped
+       */
+      ~PublishQueue();
+
+      /**
+       * @brief  Publish a message from the publisher thread
+       * @param pub The publisher to use
+       * @param msg The message, its contents are moved into the queue and it is left empty
+       * @param droppable If the queue is full, drop the message instead of waiting for room
+       * @return False if the message was dropped
+       */
+      template<class M>
+      bool publish(const ros::Publisher& pub, M& msg, bool droppable){
+        return post(new MessageJob<M>(pub, msg), droppable);
+      }
+
+      /**
+       * @brief  Run a function on the publisher thread
+       * @param fn The function, it must only touch state owned by the publisher thread or captured by value
+       * @param droppable If the queue is full, drop the function instead of waiting for room
+       * @return False if the function was dropped
+       */
+      bool post(const boost::function<void ()>& fn, bool droppable){
+        return post(new FunctionJob(fn), droppable);
+      }
+
+      /**
+       * @brief  The number of jobs dropped because the queue was full
+       */
+      unsigned long dropped() const { return dropped_; }
+
+    private:
+      struct Job {
+        virtual ~Job() {}
+        virtual void run() = 0;
+      };
+
+      template<class M>
+      struct MessageJob : public Job {
+        MessageJob(const ros::Publisher& p, M& m) : pub(p), msg(std::move(m)) {}
+        void run() { pub.publish(msg); }
+        ros::Publisher pub;
+        M msg;
+      };
+
+      struct FunctionJob : public Job {
+        FunctionJob(const boost::function<void ()>& f) : fn(f) {}
+        void run() { fn(); }
+        boost::function<void ()> fn;
+      };
+
+      bool post(Job* job, bool droppable);
+      void worker();
+
+      boost::lockfree::queue<Job*> queue_;
+      boost::atomic<bool> running_;
+      boost::atomic<bool> sleeping_; /**< set by the worker before it waits, so producers only take the mutex to wake it */
+      boost::atomic<int> blocked_;   /**< producers waiting for room, so the worker only takes the mutex to wake them */
+      boost::atomic<unsigned long> pushed_, popped_; /**< jobs in and out of queue_, the worker sleeps while they are equal */
+      boost::atomic<unsigned long> dropped_;
+      boost::mutex mutex_;
+      boost::condition_variable cond_;  /**< the worker waits here for jobs */
+      boost::condition_variable space_; /**< producers wait here for room */
+      boost::thread thread_;
+  };
+};
+
+#endif
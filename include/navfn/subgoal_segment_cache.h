@@ -0,0 +1,129 @@
+/*********************************************************************
+*
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2008, Willow Garage, Inc.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*
+*********************************************************************/
+#ifndef NAVFN_SUBGOAL_SEGMENT_CACHE_H_
+#define NAVFN_SUBGOAL_SEGMENT_CACHE_H_
+
+#include <navfn/navfn.h>
+#include <costmap_2d/costmap_2d.h>
+#include <geometry_msgs/Pose.h>
+#include <boost/thread.hpp>
+#include <boost/shared_ptr.hpp>
+#include <deque>
+#include <map>
+#include <set>
+#include <vector>
+
+namespace navfn {
+  /**
+   * @class SubgoalSegmentCache
+   * @brief Plans the segments between consecutive queued subgoals on a pool of background
+   * workers and keeps them until the costmap underneath them changes. Segments between two
+   * subgoals do not depend on the robot position, so makePlan only has to plan the leg from
+   * the robot to the next subgoal and can splice the cached legs in after it.
+   */
+  class SubgoalSegmentCache {
+    public:
+      /**
+       * @brief  Constructs the cache and starts its workers
+       * @param costmap The costmap to plan on, read under its own mutex by the workers
+       * @param num_workers The number of background planning threads
+       * @param allow_unknown Whether or not the planner should be allowed to plan through unknown space
+       */
+      SubgoalSegmentCache(costmap_2d::Costmap2D* costmap, int num_workers, bool allow_unknown);
+
+      /**
+       * @brief  Stops the workers, dropping any segments still queued
+       */
+      ~SubgoalSegmentCache();
+
+      /**
+       * @brief  Queues every consecutive pair of a route for planning, skipping pairs that are
+       * already cached or queued. Cached segments that are not part of the route are dropped.
+       * @param route The waypoints, in the costmap frame, in the order they will be driven
+       */
+      void request(const std::vector<geometry_msgs::Pose>& route);
+
+      /**
+       * @brief  Looks up a cached segment and checks that the costmap around it is unchanged
+       * @param from The pose the segment starts at
+       * @param to The pose the segment ends at
+       * @param path_x Filled with the x map coordinates of the segment, from -> to
+       * @param path_y Filled with the y map coordinates of the segment, from -> to
+       * @return True if a valid segment was found, false if it is missing, pending, failed or stale
+       */
+      bool lookup(const geometry_msgs::Pose& from, const geometry_msgs::Pose& to,
+          std::vector<float>& path_x, std::vector<float>& path_y);
+
+      /**
+       * @brief  Drops all cached and queued segments
+       */
+      void clear();
+
+    private:
+      /** a planned segment and the fingerprint of the translated costs of the window it was planned on */
+      struct Segment {
+        std::vector<float> path_x, path_y;
+        unsigned int min_x, min_y, max_x, max_y; /**< window the fingerprint covers, inclusive, inside the map border */
+        uint64_t fingerprint;
+        bool valid;
+      };
+
+      struct Job {
+        uint64_t key;
+        unsigned int from[2], to[2];
+      };
+
+      uint64_t key(unsigned int fx, unsigned int fy, unsigned int tx, unsigned int ty) const;
+      bool toCell(const geometry_msgs::Pose& pose, unsigned int* cell) const;
+      void worker();
+      void planSegment(NavFn& planner, const Job& job);
+
+      costmap_2d::Costmap2D* costmap_;
+      bool allow_unknown_;
+      unsigned int nx_, ny_; /**< size of the costmap the cached segments were planned on */
+
+      boost::mutex mutex_;
+      boost::condition_variable cond_;
+      std::deque<Job> queue_;
+      std::set<uint64_t> pending_;
+      std::map<uint64_t, boost::shared_ptr<Segment> > segments_;
+      std::vector<COSTTYPE> window_; /**< a segment's window translated by lookup(), guarded by mutex_ */
+      boost::thread_group workers_;
+      bool running_;
+  };
+};
+
+#endif
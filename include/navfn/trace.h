@@ -0,0 +1,146 @@
+/*********************************************************************
+*
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2008, Willow Garage, Inc.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*
+*********************************************************************/
+#ifndef NAVFN_TRACE_H_
+#define NAVFN_TRACE_H_
+
+#include <boost/atomic.hpp>
+#include <boost/thread/mutex.hpp>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// counter samples carry at most this many values
+#define TRACE_MAX_ARGS 5
+
+namespace navfn {
+  /**
+   * @class Tracer
+   * @brief A process-wide, opt-in record of what the planners spent their time on: complete events for plan phases
+   * and counter samples taken during propagation, kept in a lock-free ring that overwrites the oldest events and can
+   * be dumped as Chrome trace JSON (chrome://tracing, Perfetto) at any time. While disabled, recording an event costs
+   * a relaxed load. Event names and argument keys are not copied and must be string literals.
+   */
+  class Tracer {
+    public:
+      static Tracer& instance();
+
+      /**
+       * @brief  Start recording into a new ring, dropping what was recorded before. A recorder may still be writing
+       * into the ring replaced, so it is only freed with the tracer; enabling is meant to happen a handful of times.
+       * @param capacity The number of events kept, rounded up to a power of two
+       */
+      void enable(unsigned int capacity);
+      void disable();
+      bool enabled() const { return enabled_.load(boost::memory_order_relaxed); }
+
+      /**
+       * @brief  Nanoseconds of a monotonic clock, the time base of all events
+       */
+      static uint64_t now();
+
+      /**
+       * @brief  Record a phase that started at start and lasted dur nanoseconds, on the calling thread
+       */
+      void complete(const char* name, uint64_t start, uint64_t dur);
+
+      /**
+       * @brief  Record a sample of up to TRACE_MAX_ARGS counters, shown as one graph per thread
+       */
+      void counter(const char* name, int n, const char* const* keys, const double* values);
+
+      /**
+       * @brief  Write the events in the ring, oldest first, as Chrome trace JSON
+       * @param path The file to write
+       * @return False if the file could not be written
+       */
+      bool dump(const std::string& path) const;
+
+    private:
+      struct Event {
+        uint64_t ts, dur;
+        const char* name;
+        const char* keys[TRACE_MAX_ARGS];
+        double values[TRACE_MAX_ARGS];
+        uint32_t tid;
+        char phase;
+        unsigned char nargs;
+      };
+
+      /** a slot is a seqlock: odd while being written, 2 * (index + 1) once event index is complete */
+      struct Slot {
+        Slot() : seq(0) {}
+        boost::atomic<uint64_t> seq;
+        Event event;
+      };
+
+      struct Ring {
+        explicit Ring(unsigned int size) : slots(size), mask(size - 1), head(0) {}
+        std::vector<Slot> slots;
+        uint64_t mask;
+        boost::atomic<uint64_t> head;
+      };
+
+      Tracer();
+      ~Tracer();
+      static Event* claim(Ring* ring, uint64_t& index);
+      static void publish(Ring* ring, uint64_t index);
+      static uint32_t threadId();
+
+      boost::atomic<bool> enabled_;
+      boost::atomic<Ring*> ring_;
+      boost::mutex mutex_;
+      std::vector<Ring*> retired_; /**< rings replaced by enable(), guarded by mutex_ */
+  };
+
+  /**
+   * @class TraceScope
+   * @brief Records the lifetime of a scope as a complete event when tracing is enabled
+   */
+  class TraceScope {
+    public:
+      explicit TraceScope(const char* name) : name_(name), start_(Tracer::instance().enabled() ? Tracer::now() : 0) {}
+      ~TraceScope(){
+        if(start_ && Tracer::instance().enabled())
+          Tracer::instance().complete(name_, start_, Tracer::now() - start_);
+      }
+
+    private:
+      const char* name_;
+      uint64_t start_;
+  };
+};
+
+#endif
@@ -0,0 +1,106 @@
+/*********************************************************************
+*
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2008, Willow Garage, Inc.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*
+*********************************************************************/
+#include <navfn/cost_translation_cache.h>
+#include <ros/console.h>
+
+namespace navfn {
+
+  CostTranslationCache& CostTranslationCache::instance(){
+    static CostTranslationCache cache;
+    return cache;
+  }
+
+  boost::shared_ptr<const CostSnapshot> CostTranslationCache::get(const std::string& map_id, uint64_t version,
+      const COSTTYPE* cmap, int nx, int ny, bool allow_unknown){
+    Key key;
+    key.map_id = map_id;
+    key.version = version;
+    key.nx = nx;
+    key.ny = ny;
+    key.allow_unknown = allow_unknown;
+
+    //translating under the lock means planners asking for the same map at once translate it only once
+    boost::mutex::scoped_lock lock(mutex_);
+    std::map<Key, Entry>::iterator it = entries_.find(key);
+    if(it != entries_.end()){
+      lru_.splice(lru_.begin(), lru_, it->second.used);
+      return it->second.snapshot;
+    }
+
+    boost::shared_ptr<CostSnapshot> snapshot(new CostSnapshot);
+    snapshot->nx = nx;
+    snapshot->ny = ny;
+    snapshot->costs.resize(nx * ny);
+    if(!snapshot->costs.empty()){
+      NavFn::translateCostmap(cmap, &snapshot->costs[0], nx, ny, true, allow_unknown);
+      NavFn::setObsBorder(&snapshot->costs[0], nx, ny);
+    }
+    ++translations_;
+
+    Entry& entry = entries_[key];
+    entry.snapshot = snapshot;
+    lru_.push_front(key);
+    entry.used = lru_.begin();
+    prune();
+    ROS_DEBUG("[CostTranslationCache] Translated version %llu of %s, %d x %d, %u translations held",
+        (unsigned long long)version, map_id.c_str(), nx, ny, (unsigned int)entries_.size());
+    return snapshot;
+  }
+
+  void CostTranslationCache::setCapacity(unsigned int capacity){
+    boost::mutex::scoped_lock lock(mutex_);
+    capacity_ = capacity;
+    prune();
+  }
+
+  unsigned int CostTranslationCache::size(){
+    boost::mutex::scoped_lock lock(mutex_);
+    return entries_.size();
+  }
+
+  unsigned int CostTranslationCache::translations(){
+    boost::mutex::scoped_lock lock(mutex_);
+    return translations_;
+  }
+
+  void CostTranslationCache::prune(){
+    //planners still using a dropped translation keep it alive themselves
+    while(lru_.size() > capacity_){
+      entries_.erase(lru_.back());
+      lru_.pop_back();
+    }
+  }
+};
@@ -0,0 +1,347 @@
+/*********************************************************************
+*
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2008, Willow Garage, Inc.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*
+*********************************************************************/
+#include <navfn/map_generator.h>
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#define GEN_FREE 0
+#define GEN_INSCRIBED 253
+#define GEN_LETHAL 254
+
+namespace navfn {
+
+  namespace {
+    // fill a rectangle, clipped to the map
+    void fillRect(std::vector<unsigned char>& costs, int nx, int ny, int x0, int y0, int x1, int y1, unsigned char v){
+      x0 = std::max(x0, 0); y0 = std::max(y0, 0);
+      x1 = std::min(x1, nx); y1 = std::min(y1, ny);
+      for(int y = y0; y < y1; ++y)
+        if(x0 < x1)
+          std::fill(costs.begin() + y * nx + x0, costs.begin() + y * nx + x1, v);
+    }
+
+    void border(std::vector<unsigned char>& costs, int nx, int ny){
+      fillRect(costs, nx, ny, 0, 0, nx, 1, GEN_LETHAL);
+      fillRect(costs, nx, ny, 0, ny - 1, nx, ny, GEN_LETHAL);
+      fillRect(costs, nx, ny, 0, 0, 1, ny, GEN_LETHAL);
+      fillRect(costs, nx, ny, nx - 1, 0, nx, ny, GEN_LETHAL);
+    }
+  }
+
+  MapGenerator::MapGenerator(uint64_t seed) : state_(seed) {}
+
+  //splitmix64, fully specified so maps don't change with the standard library
+  uint64_t MapGenerator::next(){
+    uint64_t z = (state_ += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+  }
+
+  int MapGenerator::uniform(int n){
+    return n > 0 ? (int)(next() % (uint64_t)n) : 0;
+  }
+
+  double MapGenerator::uniform01(){
+    return (next() >> 11) * (1.0 / 9007199254740992.0);
+  }
+
+  bool MapGenerator::parseLayout(const std::string& name, Layout& layout){
+    for(int l = OPEN_HALL; l <= RANDOM_OBSTACLES; ++l){
+      if(name == layoutName((Layout)l)){
+        layout = (Layout)l;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  const char* MapGenerator::layoutName(Layout layout){
+    switch(layout){
+      case OPEN_HALL: return "hall";
+      case AISLES: return "aisles";
+      case MAZE: return "maze";
+      default: return "random";
+    }
+  }
+
+  void MapGenerator::generate(const Options& opts, std::vector<unsigned char>& costs){
+    costs.assign((size_t)opts.width * opts.height, GEN_FREE);
+    switch(opts.layout){
+      case OPEN_HALL: openHall(opts, costs); break;
+      case AISLES: aisles(opts, costs); break;
+      case MAZE: maze(opts, costs); break;
+      default: randomObstacles(opts, costs); break;
+    }
+    border(costs, opts.width, opts.height);
+    inflate(opts, costs);
+  }
+
+  void MapGenerator::openHall(const Options& opts, std::vector<unsigned char>& costs){
+    //one pillar per pitch x pitch square covers the requested share of the hall
+    int side = std::max(1, opts.feature_size);
+    double density = std::min(std::max(opts.density, 0.0), 0.5);
+    if(density <= 0.0)
+      return;
+    int pitch = std::max(side + 2, (int)(side / std::sqrt(density) + 0.5));
+    int jitter = (pitch - side) / 2;
+    for(int y = pitch / 2; y + side < opts.height; y += pitch){
+      for(int x = pitch / 2; x + side < opts.width; x += pitch){
+        int px = x + uniform(2 * jitter + 1) - jitter, py = y + uniform(2 * jitter + 1) - jitter;
+        fillRect(costs, opts.width, opts.height, px, py, px + side, py + side, GEN_LETHAL);
+      }
+    }
+  }
+
+  void MapGenerator::aisles(const Options& opts, std::vector<unsigned char>& costs){
+    //shelves of feature_size depth, aisles as wide as it takes for the shelves to cover the requested share
+    int depth = std::max(1, opts.feature_size);
+    double density = std::min(std::max(opts.density, 0.05), 0.8);
+    int aisle = std::max(2, (int)(depth * (1.0 - density) / density + 0.5));
+    int length = std::max(4 * depth, 10 * aisle); //shelf length between cross aisles
+    for(int y = aisle; y + depth < opts.height - aisle; y += depth + aisle){
+      //stagger the cross aisles a little from one shelf row to the next
+      int offset = aisle + uniform(aisle + 1);
+      for(int x = offset; x < opts.width - aisle; x += length + aisle)
+        fillRect(costs, opts.width, opts.height, x, y, std::min(x + length, opts.width - aisle), y + depth, GEN_LETHAL);
+    }
+  }
+
+  void MapGenerator::maze(const Options& opts, std::vector<unsigned char>& costs){
+    int corridor = std::max(1, opts.feature_size);
+    int wall = std::max(1, corridor / 4);
+    int pitch = corridor + wall;
+    int mx = (opts.width - wall) / pitch, my = (opts.height - wall) / pitch;
+    std::fill(costs.begin(), costs.end(), GEN_LETHAL);
+    if(mx <= 0 || my <= 0)
+      return;
+
+    //carve the cells, then the passages of a random spanning tree from an iterative depth first search
+    for(int cy = 0; cy < my; ++cy)
+      for(int cx = 0; cx < mx; ++cx)
+        fillRect(costs, opts.width, opts.height, wall + cx * pitch, wall + cy * pitch,
+            wall + cx * pitch + corridor, wall + cy * pitch + corridor, GEN_FREE);
+
+    //bit 0: passage to the east is open, bit 1: passage to the south, bit 2: visited
+    std::vector<unsigned char> cells((size_t)mx * my, 0);
+    std::vector<int> stack;
+    stack.push_back(0);
+    cells[0] = 4;
+    while(!stack.empty()){
+      int c = stack.back();
+      int cx = c % mx, cy = c / mx;
+      int options[4], n = 0;
+      if(cx > 0 && !(cells[c - 1] & 4)) options[n++] = c - 1;
+      if(cx + 1 < mx && !(cells[c + 1] & 4)) options[n++] = c + 1;
+      if(cy > 0 && !(cells[c - mx] & 4)) options[n++] = c - mx;
+      if(cy + 1 < my && !(cells[c + mx] & 4)) options[n++] = c + mx;
+      if(n == 0){
+        stack.pop_back();
+        continue;
+      }
+      int d = options[uniform(n)];
+      cells[d] |= 4;
+      if(d == c + 1) cells[c] |= 1;
+      else if(d == c - 1) cells[d] |= 1;
+      else if(d == c + mx) cells[c] |= 2;
+      else cells[d] |= 2;
+      stack.push_back(d);
+    }
+
+    //walls off the tree are knocked down with probability 1 - density, making loops
+    double keep = std::min(std::max(opts.density, 0.0), 1.0);
+    for(int cy = 0; cy < my; ++cy){
+      for(int cx = 0; cx < mx; ++cx){
+        unsigned char& cell = cells[cy * mx + cx];
+        if(cx + 1 < mx && !(cell & 1) && uniform01() >= keep) cell |= 1;
+        if(cy + 1 < my && !(cell & 2) && uniform01() >= keep) cell |= 2;
+        int x = wall + cx * pitch, y = wall + cy * pitch;
+        if(cell & 1)
+          fillRect(costs, opts.width, opts.height, x + corridor, y, x + pitch, y + corridor, GEN_FREE);
+        if(cell & 2)
+          fillRect(costs, opts.width, opts.height, x, y + corridor, x + corridor, y + pitch, GEN_FREE);
+      }
+    }
+  }
+
+  void MapGenerator::randomObstacles(const Options& opts, std::vector<unsigned char>& costs){
+    int nx = opts.width, ny = opts.height;
+    double target = std::min(std::max(opts.density, 0.0), 0.9) * (double)nx * ny;
+    int rmax = std::max(1, opts.feature_size);
+    double covered = 0.0;
+    while(covered < target){
+      int r = 1 + uniform(rmax);
+      int cx = uniform(nx), cy = uniform(ny);
+      for(int dy = -r; dy <= r; ++dy){
+        int y = cy + dy;
+        if(y < 0 || y >= ny)
+          continue;
+        int half = (int)std::sqrt((double)(r * r - dy * dy));
+        int x0 = std::max(cx - half, 0), x1 = std::min(cx + half, nx - 1);
+        unsigned char *row = &costs[(size_t)y * nx];
+        for(int x = x0; x <= x1; ++x){
+          if(row[x] != GEN_LETHAL){
+            row[x] = GEN_LETHAL;
+            covered += 1.0;
+          }
+        }
+      }
+    }
+  }
+
+  void MapGenerator::inflate(const Options& opts, std::vector<unsigned char>& costs){
+    //a kernel of the inflated costs around one lethal cell, stamped around every lethal cell on an obstacle's edge
+    int nx = opts.width, ny = opts.height;
+    int r = (int)std::ceil(opts.inflation_radius);
+    if(r <= 0)
+      return;
+    struct Offset { int dx, dy; unsigned char cost; };
+    std::vector<Offset> kernel;
+    for(int dy = -r; dy <= r; ++dy){
+      for(int dx = -r; dx <= r; ++dx){
+        double d = std::sqrt((double)(dx * dx + dy * dy));
+        if((dx == 0 && dy == 0) || d > opts.inflation_radius)
+          continue;
+        unsigned char cost = d <= opts.inscribed_radius ? GEN_INSCRIBED
+          : (unsigned char)((GEN_INSCRIBED - 1) * std::exp(-opts.cost_scaling * (d - opts.inscribed_radius)));
+        if(cost > GEN_FREE){
+          Offset o = { dx, dy, cost };
+          kernel.push_back(o);
+        }
+      }
+    }
+
+    for(int y = 0; y < ny; ++y){
+      for(int x = 0; x < nx; ++x){
+        size_t i = (size_t)y * nx + x;
+        if(costs[i] != GEN_LETHAL)
+          continue;
+        bool edge = (x > 0 && costs[i - 1] != GEN_LETHAL) || (x + 1 < nx && costs[i + 1] != GEN_LETHAL)
+          || (y > 0 && costs[i - nx] != GEN_LETHAL) || (y + 1 < ny && costs[i + nx] != GEN_LETHAL);
+        if(!edge)
+          continue;
+        for(size_t k = 0; k < kernel.size(); ++k){
+          int kx = x + kernel[k].dx, ky = y + kernel[k].dy;
+          if(kx < 0 || ky < 0 || kx >= nx || ky >= ny)
+            continue;
+          unsigned char& c = costs[(size_t)ky * nx + kx];
+          if(c < kernel[k].cost)
+            c = kernel[k].cost;
+        }
+      }
+    }
+  }
+
+  int MapGenerator::floodFill(const std::vector<unsigned char>& costs, int nx, int ny, int seed, std::vector<bool>& reached){
+    //scanline fill over cells the planner can cross, 4-connected like the propagation
+    reached.assign(costs.size(), false);
+    std::vector<std::pair<int, int> > stack;
+    stack.push_back(std::make_pair(seed % nx, seed / nx));
+    int count = 0;
+    while(!stack.empty()){
+      int x = stack.back().first, y = stack.back().second;
+      stack.pop_back();
+      size_t row = (size_t)y * nx;
+      if(reached[row + x] || costs[row + x] >= GEN_INSCRIBED)
+        continue;
+      int x0 = x, x1 = x;
+      while(x0 > 0 && !reached[row + x0 - 1] && costs[row + x0 - 1] < GEN_INSCRIBED) --x0;
+      while(x1 + 1 < nx && !reached[row + x1 + 1] && costs[row + x1 + 1] < GEN_INSCRIBED) ++x1;
+      for(int i = x0; i <= x1; ++i)
+        reached[row + i] = true;
+      count += x1 - x0 + 1;
+
+      for(int dy = -1; dy <= 1; dy += 2){
+        int ny2 = y + dy;
+        if(ny2 < 0 || ny2 >= ny)
+          continue;
+        size_t nrow = (size_t)ny2 * nx;
+        bool open = false;
+        for(int i = x0; i <= x1; ++i){
+          bool passable = !reached[nrow + i] && costs[nrow + i] < GEN_INSCRIBED;
+          if(passable && !open)
+            stack.push_back(std::make_pair(i, ny2));
+          open = passable;
+        }
+      }
+    }
+    return count;
+  }
+
+  int MapGenerator::sampleProblems(const std::vector<unsigned char>& costs, int nx, int ny, int n, double min_distance,
+      std::vector<int>& problems){
+    problems.clear();
+    size_t free_cells = 0;
+    for(size_t i = 0; i < costs.size(); ++i)
+      if(costs[i] < GEN_INSCRIBED)
+        free_cells++;
+    if(free_cells == 0 || n <= 0)
+      return 0;
+
+    //fill from random free cells until an area holding a good share of the free space is found
+    std::vector<bool> reached, best;
+    int best_count = 0;
+    for(int attempt = 0; attempt < 16 && (size_t)best_count * 4 < free_cells; ++attempt){
+      int seed;
+      do
+        seed = uniform(nx * ny);
+      while(costs[seed] >= GEN_INSCRIBED);
+      int count = floodFill(costs, nx, ny, seed, reached);
+      if(count > best_count){
+        best_count = count;
+        best.swap(reached);
+      }
+    }
+
+    //rejection sampling, giving up on pairs that can't be found in a reasonable number of draws
+    int tries = 1000 * n;
+    while((int)problems.size() < 4 * n && tries-- > 0){
+      int s = uniform(nx * ny), g = uniform(nx * ny);
+      if(!best[s] || !best[g])
+        continue;
+      int sx = s % nx, sy = s / nx, gx = g % nx, gy = g / nx;
+      if(std::sqrt((double)(sx - gx) * (sx - gx) + (double)(sy - gy) * (sy - gy)) < min_distance)
+        continue;
+      problems.push_back(sx);
+      problems.push_back(sy);
+      problems.push_back(gx);
+      problems.push_back(gy);
+    }
+    return problems.size() / 4;
+  }
+
+};
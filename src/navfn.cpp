@@ -44,65 +44,16 @@
 
 
 #include <navfn/navfn.h>
+#include <navfn/trace.h>
 #include <ros/console.h>
+#include <algorithm>
+#include <vector>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 namespace navfn {
 
-  //
-  // function to perform nav fn calculation
-  // keeps track of internal buffers, will be more efficient
-  //   if the size of the environment does not change
-  //
-
-  int
-    create_nav_plan_astar(COSTTYPE *costmap, int nx, int ny,
-        int* goal, int* start,
-        float *plan, int nplan)
-    {
-      static NavFn *nav = NULL;
-
-      if (nav == NULL)
-        nav = new NavFn(nx,ny);
-
-      if (nav->nx != nx || nav->ny != ny) // check for compatibility with previous call
-      {
-        delete nav;
-        nav = new NavFn(nx,ny);      
-      }
-
-      nav->setGoal(goal);
-      nav->setStart(start);
-
-      nav->costarr = costmap;
-      nav->setupNavFn(true);
-
-      // calculate the nav fn and path
-      nav->priInc = 2*COST_NEUTRAL;
-      nav->propNavFnAstar(std::max(nx*ny/20,nx+ny));
-      ROS_DEBUG("asdsads\n");
-      // path
-      int len = nav->calcPath(nplan);
-
-      if (len > 0)			// found plan
-        ROS_DEBUG("[NavFn] Path found, %d steps\n", len);
-      else
-        ROS_DEBUG("[NavFn] No path found\n");
-
-      if (len > 0)
-      {
-        for (int i=0; i<len; i++)
-        {
-          plan[i*2] = nav->pathx[i];
-          plan[i*2+1] = nav->pathy[i];
-        }
-      }
-
-      return len;
-    }
-
-
-
-
   //
   // create nav fn buffers 
   //
@@ -111,6 +62,19 @@ namespace navfn {
   {  
     // create cell arrays
     costarr = NULL;
+    costarr_shared = false;
+    costview = false;
+    setupKeep = false;
+    tileHash = NULL;
+    dirtyTiles = NULL;
+    ndirty = tilesX = tilesY = 0;
+    tilesValid = false;
+    tilesUnknown = false;
+    ovlCells = NULL;
+    ovlSaved = NULL;
+    novl = novlbuf = 0;
+    ovlCosts = NULL;
+    ovlSparse = false;
     potarr = NULL;
     pending = NULL;
     gradx = grady = NULL;
@@ -132,17 +96,27 @@ namespace navfn {
     // display function
     displayFn = NULL;
     displayInt = 0;
+    traceInt = 16;
 
     // path buffers
     npathbuf = npath = 0;
     pathx = pathy = NULL;
     pathStep = 0.5;
+
+    // propagation counters
+    propCycles = propCells = propMaxBuf = 0;
+
+    // gradients are computed lazily per cell unless asked otherwise
+    denseGrad = false;
+    gradField = false;
+    gradLo = gradHi = 0;
+    visitLo = visitHi = 0;
   }
 
 
   NavFn::~NavFn()
   {
-    if(costarr)
+    if(costarr && !costarr_shared)
       delete[] costarr;
     if(potarr)
       delete[] potarr;
@@ -162,6 +136,16 @@ namespace navfn {
       delete[] pb2;
     if(pb3)
       delete[] pb3;
+    if(tileHash)
+      delete[] tileHash;
+    if(dirtyTiles)
+      delete[] dirtyTiles;
+    if(ovlCells)
+      delete[] ovlCells;
+    if(ovlSaved)
+      delete[] ovlSaved;
+    if(ovlCosts)
+      delete[] ovlCosts;
   }
 
 
@@ -198,7 +182,7 @@ namespace navfn {
       ny = ys;
       ns = nx*ny;
 
-      if(costarr)
+      if(costarr && !costarr_shared)
         delete[] costarr;
       if(potarr)
         delete[] potarr;
@@ -211,6 +195,14 @@ namespace navfn {
         delete[] grady;
 
       costarr = new COSTTYPE[ns]; // cost array, 2d config space
+      costarr_shared = false;
+      costview = false;
+      tilesValid = false;
+      novl = 0;			// nothing to restore in the new array
+      ovlSparse = false;
+      if (ovlCosts)		// sized for the old array
+        delete[] ovlCosts;
+      ovlCosts = NULL;
       memset(costarr, 0, ns*sizeof(COSTTYPE));
       potarr = new float[ns];	// navigation potential array
       pending = new bool[ns];
@@ -227,7 +219,256 @@ namespace navfn {
   void
     NavFn::setCostmap(const COSTTYPE *cmap, bool isROS, bool allow_unknown)
     {
-      COSTTYPE *cm = costarr;
+      clearOverlay();
+      if (costarr_shared)		// get our own buffer back
+      {
+        costarr = new COSTTYPE[ns];
+        costarr_shared = false;
+      }
+      costview = false;
+      tilesValid = false;
+      translateCostmap(cmap, costarr, nx, ny, isROS, allow_unknown);
+    }
+
+  void
+    NavFn::setCostArr(const COSTTYPE *cmap)
+    {
+      clearOverlay();
+      if (costarr && !costarr_shared)
+        delete[] costarr;
+      costarr = const_cast<COSTTYPE *>(cmap); // never written while shared
+      costarr_shared = true;
+      costview = false;
+      tilesValid = false;
+    }
+
+  void
+    NavFn::setCostmapView(const COSTTYPE *cmap, bool allow_unknown)
+    {
+      setCostLut(allow_unknown);
+      setCostArr(cmap);
+      costview = true;
+    }
+
+  //
+  // sparse overlay of dynamic costs, stamped into the cost array and restored afterwards;
+  //   a borrowed array keeps its owner's costs, the overlay is looked up next to it
+  //
+
+  void
+    NavFn::growOverlay(int n)
+    {
+      if (costarr_shared && !ovlCosts)
+      {
+        ovlCosts = new COSTTYPE[ns];
+        memset(ovlCosts, 0, ns*sizeof(COSTTYPE)); // planner costs are never 0
+      }
+
+      if (novl + n > novlbuf)
+      {
+        int nbuf = std::max(novl + n, 2*novlbuf);
+        int *nc = new int[nbuf];
+        COSTTYPE *nsv = new COSTTYPE[nbuf];
+        if (novl > 0)
+        {
+          memcpy(nc, ovlCells, novl*sizeof(int));
+          memcpy(nsv, ovlSaved, novl*sizeof(COSTTYPE));
+        }
+        if (ovlCells)
+          delete[] ovlCells;
+        if (ovlSaved)
+          delete[] ovlSaved;
+        ovlCells = nc;
+        ovlSaved = nsv;
+        novlbuf = nbuf;
+      }
+    }
+
+  void
+    NavFn::stampOverlay(const int *cells, const COSTTYPE *costs, int n)
+    {
+      growOverlay(n);
+      if (costarr_shared)
+      {
+        ovlSparse = true;
+        for (int i=0; i<n; i++)
+        {
+          int k = cells[i];
+          if (k < 0 || k >= ns || costs[i] <= cellCost(k))
+            continue;
+          if (!ovlCosts[k])	// listed once, however often it is stamped
+          {
+            ovlCells[novl] = k;
+            ovlSaved[novl++] = 0;
+          }
+          ovlCosts[k] = costs[i];
+        }
+        return;
+      }
+
+      for (int i=0; i<n; i++)
+      {
+        int k = cells[i];
+        if (k < 0 || k >= ns || costs[i] <= costarr[k])
+          continue;
+        ovlCells[novl] = k;
+        ovlSaved[novl++] = costarr[k];
+        costarr[k] = costs[i];
+      }
+    }
+
+  void
+    NavFn::stampFree(int k)
+    {
+      if (k < 0 || k >= ns || cellCost(k) <= COST_NEUTRAL)
+        return;
+      growOverlay(1);
+      if (costarr_shared)
+      {
+        ovlSparse = true;
+        if (!ovlCosts[k])
+        {
+          ovlCells[novl] = k;
+          ovlSaved[novl++] = 0;
+        }
+        ovlCosts[k] = COST_NEUTRAL;
+        return;
+      }
+      ovlCells[novl] = k;
+      ovlSaved[novl++] = costarr[k];
+      costarr[k] = COST_NEUTRAL;
+    }
+
+  void
+    NavFn::clearOverlay()
+    {
+      if (ovlSparse)
+      {
+        while (novl > 0)
+          ovlCosts[ovlCells[--novl]] = 0;
+        ovlSparse = false;
+        return;
+      }
+
+      // newest first, so a cell stamped twice gets its original cost back
+      while (novl > 0)
+      {
+        novl--;
+        costarr[ovlCells[novl]] = ovlSaved[novl];
+      }
+    }
+
+  // translate every possible cost once instead of every cell
+  void
+    NavFn::setCostLut(bool allow_unknown)
+    {
+      COSTTYPE vals[256];
+      for (int i=0; i<256; i++)
+        vals[i] = i;
+      translateCostmap(vals, costlut, 256, 1, true, allow_unknown);
+    }
+
+  // fingerprint of a rectangle, a word at a time; every step is invertible,
+  //   so rectangles differing in a single word always have different fingerprints
+  uint64_t
+    NavFn::hashCostmap(const COSTTYPE *cmap, int nx, int x0, int y0, int x1, int y1)
+    {
+      uint64_t h = 14695981039346656037ULL;
+      int len = (x1-x0)*sizeof(COSTTYPE);
+      for (int y=y0; y<y1; y++)
+      {
+        const unsigned char *p = (const unsigned char *)(cmap + y*nx + x0);
+        int i = 0;
+        for (; i+8 <= len; i+=8)
+        {
+          uint64_t w;
+          memcpy(&w, p+i, 8);
+          h = (h ^ w) * 1099511628211ULL;
+          h ^= h >> 32;
+        }
+        for (; i<len; i++)
+          h = (h ^ p[i]) * 1099511628211ULL;
+      }
+      return h;
+    }
+
+  void
+    NavFn::lutRegion(const COSTTYPE *cmap, int x0, int y0, int x1, int y1)
+    {
+      for (int y=y0; y<y1; y++)
+      {
+        const COSTTYPE *src = cmap + y*nx;
+        COSTTYPE *dst = costarr + y*nx;
+        for (int x=x0; x<x1; x++)
+          dst[x] = costlut[src[x]];
+      }
+    }
+
+  void
+    NavFn::translateRegion(const COSTTYPE *cmap, int x0, int y0, int x1, int y1, bool allow_unknown)
+    {
+      clearOverlay();
+      if (costarr_shared)
+      {
+        setCostmap(cmap, true, allow_unknown);
+        return;
+      }
+      setCostLut(allow_unknown);
+      lutRegion(cmap, std::max(x0,0), std::max(y0,0), std::min(x1,nx), std::min(y1,ny));
+    }
+
+  int
+    NavFn::updateCostmap(const COSTTYPE *cmap, bool allow_unknown)
+    {
+      int tx = (nx + COST_TILE-1)/COST_TILE;
+      int ty = (ny + COST_TILE-1)/COST_TILE;
+      bool full = !tilesValid || tilesUnknown != allow_unknown || tx != tilesX || ty != tilesY;
+      clearOverlay();		// tiles are compared with the costs under the overlay
+
+      if (costarr_shared)		// get our own buffer back
+      {
+        costarr = new COSTTYPE[ns];
+        costarr_shared = false;
+        full = true;
+      }
+      costview = false;
+
+      if (tx*ty != tilesX*tilesY || !tileHash)
+      {
+        if (tileHash)
+          delete[] tileHash;
+        if (dirtyTiles)
+          delete[] dirtyTiles;
+        tileHash = new uint64_t[tx*ty];
+        dirtyTiles = new int[tx*ty];
+      }
+      tilesX = tx;
+      tilesY = ty;
+      setCostLut(allow_unknown);
+
+      ndirty = 0;
+      for (int t=0; t<tx*ty; t++)
+      {
+        int x0 = (t%tx)*COST_TILE, y0 = (t/tx)*COST_TILE;
+        int x1 = std::min(x0+COST_TILE, nx), y1 = std::min(y0+COST_TILE, ny);
+        uint64_t h = hashCostmap(cmap, nx, x0, y0, x1, y1);
+        if (!full && h == tileHash[t])
+          continue;
+        tileHash[t] = h;
+        dirtyTiles[ndirty++] = t;
+        lutRegion(cmap, x0, y0, x1, y1);
+      }
+
+      tilesValid = true;
+      tilesUnknown = allow_unknown;
+      return ndirty;
+    }
+
+  void
+    NavFn::translateCostmap(const COSTTYPE *cmap, COSTTYPE *costs, int nx, int ny,
+        bool isROS, bool allow_unknown)
+    {
+      COSTTYPE *cm = costs;
       if (isROS)			// ROS-type cost array
       {
         for (int i=0; i<ny; i++)
@@ -286,6 +527,24 @@ namespace navfn {
       }
     }
 
+  void
+    NavFn::setObsBorder(COSTTYPE *costs, int nx, int ny)
+    {
+      COSTTYPE *pc;
+      pc = costs;
+      for (int i=0; i<nx; i++)
+        *pc++ = COST_OBS;
+      pc = costs + (ny-1)*nx;
+      for (int i=0; i<nx; i++)
+        *pc++ = COST_OBS;
+      pc = costs;
+      for (int i=0; i<ny; i++, pc+=nx)
+        *pc = COST_OBS;
+      pc = costs + nx - 1;
+      for (int i=0; i<ny; i++, pc+=nx)
+        *pc = COST_OBS;
+    }
+
   bool
     NavFn::calcNavFnDijkstra(bool atStart)
     {
@@ -295,13 +554,24 @@ namespace navfn {
       snprintf( costmap_filename, 1000, "navfn-dijkstra-costmap-%04d", file_number++ );
       savemap( costmap_filename );
 #endif
-      setupNavFn(true);
+      TraceScope trace("calcNavFnDijkstra");
+      {
+        TraceScope trace("setupNavFn");
+        setupNavFn(true);
+      }
 
       // calculate the nav fn and path
-      propNavFnDijkstra(std::max(nx*ny/20,nx+ny),atStart);
+      {
+        TraceScope trace("propNavFnDijkstra");
+        propNavFnDijkstra(std::max(nx*ny/20,nx+ny),atStart);
+      }
 
       // path
-      int len = calcPath(nx*ny/2);
+      int len;
+      {
+        TraceScope trace("calcPath");
+        len = calcPath(nx*ny/2);
+      }
 
       if (len > 0)			// found plan
       {
@@ -324,13 +594,24 @@ namespace navfn {
   bool
     NavFn::calcNavFnAstar()
     {
-      setupNavFn(true);
+      TraceScope trace("calcNavFnAstar");
+      {
+        TraceScope trace("setupNavFn");
+        setupNavFn(true);
+      }
 
       // calculate the nav fn and path
-      propNavFnAstar(std::max(nx*ny/20,nx+ny));
+      {
+        TraceScope trace("propNavFnAstar");
+        propNavFnAstar(std::max(nx*ny/20,nx+ny));
+      }
 
       // path
-      int len = calcPath(nx*4);
+      int len;
+      {
+        TraceScope trace("calcPath");
+        len = calcPath(nx*4);
+      }
 
       if (len > 0)			// found plan
       {
@@ -385,14 +666,17 @@ namespace navfn {
 
 
   // inserting onto the priority blocks
+// planner cost of cell n, <view> and <ovl> are template parameters in the update kernels
+#define COSTAT(n) (ovl && ovlCosts[n] ? ovlCosts[n] : view ? costlut[costarr[n]] : costarr[n])
+
 #define push_cur(n)  { if (n>=0 && n<ns && !pending[n] && \
-    costarr[n]<COST_OBS && curPe<PRIORITYBUFSIZE) \
+    COSTAT(n)<COST_OBS && curPe<PRIORITYBUFSIZE) \
   { curP[curPe++]=n; pending[n]=true; }}
 #define push_next(n) { if (n>=0 && n<ns && !pending[n] && \
-    costarr[n]<COST_OBS && nextPe<PRIORITYBUFSIZE) \
+    COSTAT(n)<COST_OBS && nextPe<PRIORITYBUFSIZE) \
   { nextP[nextPe++]=n; pending[n]=true; }}
 #define push_over(n) { if (n>=0 && n<ns && !pending[n] && \
-    costarr[n]<COST_OBS && overPe<PRIORITYBUFSIZE) \
+    COSTAT(n)<COST_OBS && overPe<PRIORITYBUFSIZE) \
   { overP[overPe++]=n; pending[n]=true; }}
 
 
@@ -401,29 +685,72 @@ namespace navfn {
   void
     NavFn::setupNavFn(bool keepit)
     {
-      // reset values in propagation arrays
-      for (int i=0; i<ns; i++)
+      setupNavFnBegin(keepit);
+      setupNavFnRows(0, ny);
+      setupNavFnEnd();
+    }
+
+  void
+    NavFn::setupNavFnBegin(bool keepit)
+    {
+      // a shared cost array is read-only, and already has its border
+      if (costarr_shared)
+        keepit = true;
+      setupKeep = keepit;
+      if (!keepit)
       {
-        potarr[i] = POT_HIGH;
-        if (!keepit) costarr[i] = COST_NEUTRAL;
-        gradx[i] = grady[i] = 0.0;
+        tilesValid = false;
+        novl = 0;
       }
+      gradField = false;
+      nobs = 0;
+    }
 
-      // outer bounds of cost array
-      COSTTYPE *pc;
-      pc = costarr;
-      for (int i=0; i<nx; i++)
-        *pc++ = COST_OBS;
-      pc = costarr + (ny-1)*nx;
-      for (int i=0; i<nx; i++)
-        *pc++ = COST_OBS;
-      pc = costarr;
-      for (int i=0; i<ny; i++, pc+=nx)
-        *pc = COST_OBS;
-      pc = costarr + nx - 1;
-      for (int i=0; i<ny; i++, pc+=nx)
-        *pc = COST_OBS;
+  void
+    NavFn::setupNavFnRows(int lo, int hi)
+    {
+      // reset values in propagation arrays
+      for (int j=lo; j<hi; j++)
+      {
+        int row = j*nx;
+        bool edge = j == 0 || j == ny-1;
+        for (int i=row; i<row+nx; i++)
+        {
+          potarr[i] = POT_HIGH;
+          if (!setupKeep) costarr[i] = COST_NEUTRAL;
+        }
+        // the dense gradient field doesn't use zero gradients as a "not computed" mark
+        if (!denseGrad)
+          for (int i=row; i<row+nx; i++)
+            gradx[i] = grady[i] = 0.0;
+
+        // outer bounds of cost array, as setObsBorder() writes them
+        if (!costarr_shared)
+        {
+          if (edge)
+            for (int i=row; i<row+nx; i++)
+              costarr[i] = COST_OBS;
+          else
+            costarr[row] = costarr[row+nx-1] = COST_OBS;
+        }
 
+        // a view can't be given an obstacle border, mark the border pending instead so it is never queued
+        memset(pending+row, costview && edge, nx*sizeof(bool));
+        if (costview)
+          pending[row] = pending[row+nx-1] = true;
+
+        // find # of obstacle cells
+        for (int i=row; i<row+nx; i++)
+        {
+          if (cellCost(i) >= COST_OBS)
+            nobs++;			// number of cells that are obstacles
+        }
+      }
+    }
+
+  void
+    NavFn::setupNavFnEnd()
+    {
       // priority buffers
       curT = COST_OBS;
       curP = pb1; 
@@ -432,21 +759,11 @@ namespace navfn {
       nextPe = 0;
       overP = pb3;
       overPe = 0;
-      memset(pending, 0, ns*sizeof(bool));
 
       // set goal
       int k = goal[0] + goal[1]*nx;
       initCost(k,0);
-
-      // find # of obstacle cells
-      pc = costarr;
-      int ntot = 0;
-      for (int i=0; i<ns; i++, pc++)
-      {
-        if (*pc >= COST_OBS)
-          ntot++;			// number of cells that are obstacles
-      }
-      nobs = ntot;
+      visitLo = visitHi = k;
     }
 
 
@@ -455,6 +772,8 @@ namespace navfn {
   void
     NavFn::initCost(int k, float v)
     {
+      const bool view = costview;
+      const bool ovl = ovlSparse;
       potarr[k] = v;
       push_cur(k+1);
       push_cur(k-1);
@@ -473,8 +792,24 @@ namespace navfn {
 
 #define INVSQRT2 0.707106781
 
-  inline void
+  void
     NavFn::updateCell(int n)
+    {
+      if (ovlSparse)
+      {
+        if (costview) updateCellT<true,true>(n);
+        else updateCellT<false,true>(n);
+      }
+      else
+      {
+        if (costview) updateCellT<true,false>(n);
+        else updateCellT<false,false>(n);
+      }
+    }
+
+  template <bool view, bool ovl>
+  inline void
+    NavFn::updateCellT(int n)
     {
       // get neighbors
       float u,d,l,r;
@@ -492,9 +827,9 @@ namespace navfn {
       if (u<d) ta=u; else ta=d;
 
       // do planar wave update
-      if (costarr[n] < COST_OBS)	// don't propagate into obstacles
+      float hf = (float)COSTAT(n); // traversability factor
+      if (hf < COST_OBS)	// don't propagate into obstacles
       {
-        float hf = (float)costarr[n]; // traversability factor
         float dc = tc-ta;		// relative cost between ta,tc
         if (dc < 0) 		// ta is lowest
         {
@@ -521,10 +856,10 @@ namespace navfn {
         // now add affected neighbors to priority blocks
         if (pot < potarr[n])
         {
-          float le = INVSQRT2*(float)costarr[n-1];
-          float re = INVSQRT2*(float)costarr[n+1];
-          float ue = INVSQRT2*(float)costarr[n-nx];
-          float de = INVSQRT2*(float)costarr[n+nx];
+          float le = INVSQRT2*(float)COSTAT(n-1);
+          float re = INVSQRT2*(float)COSTAT(n+1);
+          float ue = INVSQRT2*(float)COSTAT(n-nx);
+          float de = INVSQRT2*(float)COSTAT(n+nx);
           potarr[n] = pot;
           if (pot < curT)	// low-cost buffer block 
           {
@@ -558,8 +893,24 @@ namespace navfn {
 
 #define INVSQRT2 0.707106781
 
-  inline void
+  void
     NavFn::updateCellAstar(int n)
+    {
+      if (ovlSparse)
+      {
+        if (costview) updateCellAstarT<true,true>(n);
+        else updateCellAstarT<false,true>(n);
+      }
+      else
+      {
+        if (costview) updateCellAstarT<true,false>(n);
+        else updateCellAstarT<false,false>(n);
+      }
+    }
+
+  template <bool view, bool ovl>
+  inline void
+    NavFn::updateCellAstarT(int n)
     {
       // get neighbors
       float u,d,l,r;
@@ -577,9 +928,9 @@ namespace navfn {
       if (u<d) ta=u; else ta=d;
 
       // do planar wave update
-      if (costarr[n] < COST_OBS)	// don't propagate into obstacles
+      float hf = (float)COSTAT(n); // traversability factor
+      if (hf < COST_OBS)	// don't propagate into obstacles
       {
-        float hf = (float)costarr[n]; // traversability factor
         float dc = tc-ta;		// relative cost between ta,tc
         if (dc < 0) 		// ta is lowest
         {
@@ -606,10 +957,10 @@ namespace navfn {
         // now add affected neighbors to priority blocks
         if (pot < potarr[n])
         {
-          float le = INVSQRT2*(float)costarr[n-1];
-          float re = INVSQRT2*(float)costarr[n+1];
-          float ue = INVSQRT2*(float)costarr[n-nx];
-          float de = INVSQRT2*(float)costarr[n+nx];
+          float le = INVSQRT2*(float)COSTAT(n-1);
+          float re = INVSQRT2*(float)COSTAT(n+1);
+          float ue = INVSQRT2*(float)COSTAT(n-nx);
+          float de = INVSQRT2*(float)COSTAT(n+nx);
 
           // calculate distance
           int x = n%nx;
@@ -640,6 +991,41 @@ namespace navfn {
 
 
 
+  //
+  // update a priority block, choosing the kernel once per block
+  //
+
+  void
+    NavFn::updateBlock(const int *pb, int cnt, bool astar)
+    {
+#define UPDATE_BLOCK(kernel) \
+      for (const int *pe = pb + cnt; pb < pe; pb++) \
+      { \
+        int n = *pb; \
+        if (n < visitLo) visitLo = n; \
+        if (n > visitHi) visitHi = n; \
+        kernel(n); \
+      }
+
+#define UPDATE_BLOCK_OVL(kernel, view) \
+      if (ovlSparse) UPDATE_BLOCK((kernel<view,true>)) \
+      else UPDATE_BLOCK((kernel<view,false>))
+
+      if (astar)
+      {
+        if (costview) { UPDATE_BLOCK_OVL(updateCellAstarT, true) }
+        else { UPDATE_BLOCK_OVL(updateCellAstarT, false) }
+      }
+      else
+      {
+        if (costview) { UPDATE_BLOCK_OVL(updateCellT, true) }
+        else { UPDATE_BLOCK_OVL(updateCellT, false) }
+      }
+#undef UPDATE_BLOCK_OVL
+#undef UPDATE_BLOCK
+    }
+
+
   //
   // main propagation function
   // Dijkstra method, breadth-first
@@ -654,6 +1040,7 @@ namespace navfn {
       int nwv = 0;			// max priority block size
       int nc = 0;			// number of cells put into priority blocks
       int cycle = 0;		// which cycle we're on
+      bool tracing = traceInt > 0 && Tracer::instance().enabled();
 
       // set up start cell
       int startCell = start[1]*nx + start[0];
@@ -676,13 +1063,12 @@ namespace navfn {
           pending[*(pb++)] = false;
 
         // process current priority buffer
-        pb = curP; 
-        i = curPe;
-        while (i-- > 0)		
-          updateCell(*pb++);
+        updateBlock(curP, curPe, false);
 
         if (displayInt > 0 &&  (cycle % displayInt) == 0)
           displayFn(this);
+        if (tracing && (cycle % traceInt) == 0)
+          traceProgress(nc);
 
         // swap priority blocks curP <=> nextP
         curPe = nextPe;
@@ -710,6 +1096,9 @@ namespace navfn {
 
       ROS_DEBUG("[NavFn] Used %d cycles, %d cells visited (%d%%), priority buf max %d\n", 
           cycle,nc,(int)((nc*100.0)/(ns-nobs)),nwv);
+      propCycles = cycle;
+      propCells = nc;
+      propMaxBuf = nwv;
 
       if (cycle < cycles) return true; // finished up here
       else return false;
@@ -726,15 +1115,19 @@ namespace navfn {
   //
 
   bool
-    NavFn::propNavFnAstar(int cycles)	
+    NavFn::propNavFnAstar(int cycles, bool resume)
     {
       int nwv = 0;			// max priority block size
       int nc = 0;			// number of cells put into priority blocks
       int cycle = 0;		// which cycle we're on
+      bool tracing = traceInt > 0 && Tracer::instance().enabled();
 
       // set initial threshold, based on distance
-      float dist = hypot(goal[0]-start[0], goal[1]-start[1])*(float)COST_NEUTRAL;
-      curT = dist + curT;
+      if (!resume)
+      {
+        float dist = hypot(goal[0]-start[0], goal[1]-start[1])*(float)COST_NEUTRAL;
+        curT = dist + curT;
+      }
 
       // set up start cell
       int startCell = start[1]*nx + start[0];
@@ -758,13 +1151,12 @@ namespace navfn {
           pending[*(pb++)] = false;
 
         // process current priority buffer
-        pb = curP; 
-        i = curPe;
-        while (i-- > 0)		
-          updateCellAstar(*pb++);
+        updateBlock(curP, curPe, true);
 
         if (displayInt > 0 &&  (cycle % displayInt) == 0)
           displayFn(this);
+        if (tracing && (cycle % traceInt) == 0)
+          traceProgress(nc);
 
         // swap priority blocks curP <=> nextP
         curPe = nextPe;
@@ -794,6 +1186,9 @@ namespace navfn {
 
       ROS_DEBUG("[NavFn] Used %d cycles, %d cells visited (%d%%), priority buf max %d\n", 
           cycle,nc,(int)((nc*100.0)/(ns-nobs)),nwv);
+      propCycles = cycle;
+      propCells = nc;
+      propMaxBuf = nwv;
 
 
       if (potarr[startCell] < POT_HIGH) return true; // finished up here
@@ -807,6 +1202,15 @@ namespace navfn {
   }
 
 
+  void
+    NavFn::traceProgress(int cells)
+    {
+      static const char *keys[] = { "curPe", "nextPe", "overPe", "curT", "cells" };
+      double values[] = { (double)curPe, (double)nextPe, (double)overPe, curT, (double)cells };
+      Tracer::instance().counter("propagation", 5, keys, values);
+    }
+
+
   //
   // Path construction
   // Find gradient at array points, interpolate path
@@ -834,6 +1238,10 @@ namespace navfn {
         npathbuf = n;
       }
 
+      // dense gradients are computed once for the whole propagated area
+      if (denseGrad && !gradField)
+        computeGradientField();
+
       // set up start position at cell
       // st is always upper left corner for 4-point bilinear interpolation 
       if (st == NULL) st = start;
@@ -931,10 +1339,13 @@ namespace navfn {
         {
 
           // get grad at four positions near cell
-          gradCell(stc);
-          gradCell(stc+1);
-          gradCell(stcnx);
-          gradCell(stcnx+1);
+          if (!denseGrad)
+          {
+            gradCell(stc);
+            gradCell(stc+1);
+            gradCell(stcnx);
+            gradCell(stcnx+1);
+          }
 
 
           // get interpolated gradient
@@ -959,7 +1370,7 @@ namespace navfn {
           }
 
           // move in the right direction
-          float ss = pathStep/hypot(x, y);
+          float ss = denseGrad ? pathStep/sqrtf(x*x + y*y) : pathStep/hypot(x, y);
           dx += x*ss;
           dy += y*ss;
 
@@ -1042,6 +1453,297 @@ namespace navfn {
     }
 
 
+  //
+  // path simplification
+  // shortcuts the gradient path along lines of sight, accepting a shortcut
+  //   only if it crosses no cell costlier than the worst one on the stretch
+  //   of path it replaces, so paths keep their clearance from obstacles
+  //
+
+  bool
+    NavFn::lineOfSight(float x0, float y0, float x1, float y1, int maxcost)
+    {
+      // walk every cell the line passes through; cell centers are at
+      //   integer coordinates, so shift by half a cell to get cell corners
+      x0 += 0.5; y0 += 0.5; x1 += 0.5; y1 += 0.5;
+      int x = (int)floor(x0);
+      int y = (int)floor(y0);
+      int xe = (int)floor(x1);
+      int ye = (int)floor(y1);
+      float dx = x1-x0;
+      float dy = y1-y0;
+      int sx = dx > 0 ? 1 : -1;
+      int sy = dy > 0 ? 1 : -1;
+      float tdx = dx != 0 ? fabs(1.0/dx) : POT_HIGH; // line parameter per cell
+      float tdy = dy != 0 ? fabs(1.0/dy) : POT_HIGH;
+      float tx = dx != 0 ? (dx > 0 ? x+1-x0 : x0-x)*tdx : POT_HIGH; // next cell boundary
+      float ty = dy != 0 ? (dy > 0 ? y+1-y0 : y0-y)*tdy : POT_HIGH;
+      int n = abs(xe-x) + abs(ye-y);
+
+      for (int i=0; i<=n; i++)
+      {
+        if (x < 0 || x >= nx || y < 0 || y >= ny)
+          return false;
+        int c = cellCost(y*nx+x);
+        if (c >= COST_OBS || c > maxcost)
+          return false;
+        if (tx < ty)
+        {
+          x += sx;
+          tx += tdx;
+        }
+        else
+        {
+          y += sy;
+          ty += tdy;
+        }
+      }
+      return true;
+    }
+
+  int
+    NavFn::simplifyPath(float spacing)
+    {
+      if (npath < 3)
+        return npath;
+
+      // cost of the cell under each path point
+      std::vector<int> cost(npath);
+      for (int i=0; i<npath; i++)
+      {
+        int x = std::max(0, std::min(nx-1, (int)(pathx[i]+0.5)));
+        int y = std::max(0, std::min(ny-1, (int)(pathy[i]+0.5)));
+        cost[i] = cellCost(y*nx+x);
+      }
+
+      // greedy shortcutting: from each vertex, find a far point in sight by
+      //   doubling the lookahead, then narrow it down by bisection
+      std::vector<int> verts;
+      verts.push_back(0);
+      int a = 0;
+      while (a < npath-1)
+      {
+        int good = a+1;
+        int bad = npath;
+        int step = 2;
+        while (true)
+        {
+          int j = std::min(a+step, npath-1);
+          int maxc = *std::max_element(cost.begin()+a, cost.begin()+j+1);
+          if (!lineOfSight(pathx[a], pathy[a], pathx[j], pathy[j], maxc))
+          {
+            bad = j;
+            break;
+          }
+          good = j;
+          if (j == npath-1)
+            break;
+          step *= 2;
+        }
+        while (bad-good > 1)
+        {
+          int j = (good+bad)/2;
+          int maxc = *std::max_element(cost.begin()+a, cost.begin()+j+1);
+          if (lineOfSight(pathx[a], pathy[a], pathx[j], pathy[j], maxc))
+            good = j;
+          else
+            bad = j;
+        }
+        verts.push_back(good);
+        a = good;
+      }
+
+      // resample each shortcut at no more than <spacing>, keeping the
+      //   vertices so that the resampled path stays on the lines of sight
+      std::vector<float> sx, sy;
+      sx.push_back(pathx[0]);
+      sy.push_back(pathy[0]);
+      for (unsigned int k=1; k<verts.size(); k++)
+      {
+        float x0 = pathx[verts[k-1]];
+        float y0 = pathy[verts[k-1]];
+        float x1 = pathx[verts[k]];
+        float y1 = pathy[verts[k]];
+        int nseg = 1;
+        if (spacing > 0)
+          nseg = std::max(1, (int)ceil(hypot(x1-x0, y1-y0)/spacing));
+        for (int i=1; i<=nseg; i++)
+        {
+          sx.push_back(x0 + (x1-x0)*i/nseg);
+          sy.push_back(y0 + (y1-y0)*i/nseg);
+        }
+      }
+
+      int n = sx.size();
+      if (npathbuf < n)
+      {
+        if (pathx) delete [] pathx;
+        if (pathy) delete [] pathy;
+        pathx = new float[n];
+        pathy = new float[n];
+        npathbuf = n;
+      }
+      std::copy(sx.begin(), sx.end(), pathx);
+      std::copy(sy.begin(), sy.end(), pathy);
+      npath = n;
+
+      ROS_DEBUG("[NavFn] Simplified path to %d vertices, %d points", (int)verts.size(), npath);
+      return npath;
+    }
+
+
+  //
+  // dense gradient field
+  // same values as gradCell(), computed without branches over the rows
+  //   touched by the last propagation, four cells at a time with SSE
+  //
+
+  void
+    NavFn::computeGradientField()
+    {
+      // one row of margin around the propagated area, never the outer rows
+      gradLo = std::max(1, visitLo/nx - 1);
+      gradHi = std::min(ny-2, visitHi/nx + 1);
+      gradField = true;
+      if (gradLo > gradHi)
+        return;
+
+      int n = gradLo*nx;
+      int ne = (gradHi+1)*nx;
+      const float *p = potarr;
+
+#ifdef __SSE2__
+      const __m128 high = _mm_set1_ps(POT_HIGH);
+      const __m128 obs = _mm_set1_ps(COST_OBS);
+      const __m128 zero = _mm_setzero_ps();
+      for (; n+4 <= ne; n += 4)
+      {
+        __m128 c = _mm_loadu_ps(p+n);
+        __m128 l = _mm_loadu_ps(p+n-1);
+        __m128 r = _mm_loadu_ps(p+n+1);
+        __m128 u = _mm_loadu_ps(p+n-nx);
+        __m128 d = _mm_loadu_ps(p+n+nx);
+        __m128 lv = _mm_cmplt_ps(l, high);
+        __m128 rv = _mm_cmplt_ps(r, high);
+        __m128 uv = _mm_cmplt_ps(u, high);
+        __m128 dv = _mm_cmplt_ps(d, high);
+        __m128 cv = _mm_cmplt_ps(c, high);
+
+        // free cell: average of the differences to the valid sides
+        __m128 fx = _mm_add_ps(_mm_and_ps(lv, _mm_sub_ps(l, c)), _mm_and_ps(rv, _mm_sub_ps(c, r)));
+        __m128 fy = _mm_add_ps(_mm_and_ps(uv, _mm_sub_ps(u, c)), _mm_and_ps(dv, _mm_sub_ps(c, d)));
+
+        // obstacle cell: point towards the first valid side, left and up first
+        __m128 ox = _mm_or_ps(_mm_and_ps(lv, _mm_sub_ps(zero, obs)), _mm_andnot_ps(lv, _mm_and_ps(rv, obs)));
+        __m128 oy = _mm_or_ps(_mm_and_ps(uv, _mm_sub_ps(zero, obs)), _mm_andnot_ps(uv, _mm_and_ps(dv, obs)));
+
+        __m128 gx = _mm_or_ps(_mm_and_ps(cv, fx), _mm_andnot_ps(cv, ox));
+        __m128 gy = _mm_or_ps(_mm_and_ps(cv, fy), _mm_andnot_ps(cv, oy));
+
+        // normalize, leaving zero gradients at zero
+        __m128 norm = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(gx, gx), _mm_mul_ps(gy, gy)));
+        __m128 nz = _mm_cmpgt_ps(norm, zero);
+        __m128 inv = _mm_and_ps(nz, _mm_div_ps(_mm_set1_ps(1.0f), _mm_or_ps(norm, _mm_andnot_ps(nz, _mm_set1_ps(1.0f)))));
+        _mm_storeu_ps(gradx+n, _mm_mul_ps(gx, inv));
+        _mm_storeu_ps(grady+n, _mm_mul_ps(gy, inv));
+      }
+#endif
+
+      for (; n < ne; n++)
+      {
+        float c = p[n], l = p[n-1], r = p[n+1], u = p[n-nx], d = p[n+nx];
+        bool lv = l < POT_HIGH, rv = r < POT_HIGH, uv = u < POT_HIGH, dv = d < POT_HIGH;
+        float dx, dy;
+        if (c < POT_HIGH)
+        {
+          dx = (lv ? l-c : 0.0f) + (rv ? c-r : 0.0f);
+          dy = (uv ? u-c : 0.0f) + (dv ? c-d : 0.0f);
+        }
+        else
+        {
+          dx = lv ? -COST_OBS : (rv ? COST_OBS : 0.0f);
+          dy = uv ? -COST_OBS : (dv ? COST_OBS : 0.0f);
+        }
+        float norm = sqrtf(dx*dx + dy*dy);
+        float inv = norm > 0 ? 1.0f/norm : 0.0f;
+        gradx[n] = dx*inv;
+        grady[n] = dy*inv;
+      }
+    }
+
+
+  //
+  // nearest reachable cell
+  // rings of growing Chebyshev radius around a cell, until no ring can hold a closer cell
+  //   than the best one found; ties go to the first cell in row order
+  //
+
+  static inline void
+    closerCell(int x, int y, int cx, int cy, long *bd2, int *best)
+    {
+      long d2 = (long)(cx-x)*(cx-x) + (long)(cy-y)*(cy-y);
+      if (*bd2 < 0 || d2 < *bd2 || (d2 == *bd2 && (cy < best[1] || (cy == best[1] && cx < best[0]))))
+      {
+        *bd2 = d2;
+        best[0] = cx;
+        best[1] = cy;
+      }
+    }
+
+  bool
+    NavFn::nearestReachable(int x, int y, int radius, int *best) const
+    {
+      long bd2 = -1;
+      const float high = POT_HIGH;
+
+      for (int d=0; d<=radius; d++)
+      {
+        if (bd2 >= 0 && (long)d*d > bd2)
+          break;			// every cell further out is further away
+        if (x-d < 0 && x+d >= nx && y-d < 0 && y+d >= ny)
+          break;			// the ring is off the map
+
+        // top and bottom rows of the ring, a span at a time
+        int xa = std::max(x-d, 0), xb = std::min(x+d, nx-1);
+        for (int side=0; side<(d ? 2 : 1); side++)
+        {
+          int yy = side ? y+d : y-d;
+          if (yy < 0 || yy >= ny || xa > xb)
+            continue;
+          const float *row = potarr + yy*nx;
+          int xx = xa;
+#ifdef __SSE2__
+          const __m128 vhigh = _mm_set1_ps(high);
+          for (; xx+4 <= xb+1; xx += 4)
+          {
+            int mask = _mm_movemask_ps(_mm_cmplt_ps(_mm_loadu_ps(row+xx), vhigh));
+            for (int b=0; mask; b++, mask >>= 1)
+              if (mask & 1)
+                closerCell(x, y, xx+b, yy, &bd2, best);
+          }
+#endif
+          for (; xx <= xb; xx++)
+            if (row[xx] < high)
+              closerCell(x, y, xx, yy, &bd2, best);
+        }
+
+        // left and right columns, between those rows
+        if (d == 0)
+          continue;
+        int ya = std::max(y-d+1, 0), yb = std::min(y+d-1, ny-1);
+        for (int yy=ya; yy<=yb; yy++)
+        {
+          if (x-d >= 0 && x-d < nx && potarr[yy*nx + x-d] < high)
+            closerCell(x, y, x-d, yy, &bd2, best);
+          if (x+d >= 0 && x+d < nx && potarr[yy*nx + x+d] < high)
+            closerCell(x, y, x+d, yy, &bd2, best);
+        }
+      }
+
+      return bd2 >= 0;
+    }
+
+
   //
   // display function setup
   // <n> is the number of cycles to wait before displaying,
@@ -1087,7 +1789,11 @@ namespace navfn {
         return;
       }
       fprintf(fp,"P5\n%d\n%d\n%d\n", nx, ny, 0xff);
-      fwrite(costarr,1,nx*ny,fp);
+      if (costview || ovlSparse)	// write the costs the planner sees, as a copied costmap would hold them
+        for (int i=0; i<ns; i++)
+          fputc(cellCost(i),fp);
+      else
+        fwrite(costarr,1,nx*ny,fp);
       fclose(fp);
     }
 };
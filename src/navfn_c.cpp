@@ -0,0 +1,180 @@
+/*********************************************************************
+*
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2008, Willow Garage, Inc.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*
+*********************************************************************/
+#include <navfn/navfn_c.h>
+#include <navfn/navfn.h>
+#include <navfn/navfn_pool.h>
+#include <navfn/planner_engine.h>
+#include <boost/shared_ptr.hpp>
+#include <exception>
+#include <new>
+#include <string.h>
+
+using namespace navfn;
+
+struct navfn_context {
+  boost::shared_ptr<NavFn> planner; /**< owned, or leased from a pool and given back when the context is freed */
+  boost::shared_ptr<const PlannerEngine> engine;
+};
+
+struct navfn_pool {
+  explicit navfn_pool(int size, int queue_depth, double wait_time) : planners(size, queue_depth, wait_time) {}
+  NavFnPool planners;
+};
+
+static navfn_context *makeContext(const boost::shared_ptr<NavFn>& planner){
+  navfn_context *ctx = new (std::nothrow) navfn_context;
+  if(!ctx)
+    return NULL;
+  ctx->planner = planner;
+  ctx->engine = EngineRegistry::instance().get("astar");
+  return ctx;
+}
+
+extern "C" {
+
+navfn_context *navfn_create(void){
+  try {
+    return makeContext(boost::shared_ptr<NavFn>(new NavFn(0, 0)));
+  }
+  catch(const std::bad_alloc&){
+    return NULL;
+  }
+}
+
+void navfn_destroy(navfn_context *ctx){
+  delete ctx;
+}
+
+int navfn_set_engine(navfn_context *ctx, const char *engine){
+  if(!ctx || !engine)
+    return NAVFN_INVALID;
+  boost::shared_ptr<const PlannerEngine> e = EngineRegistry::instance().get(engine);
+  if(!e)
+    return NAVFN_INVALID;
+  ctx->engine = e;
+  return NAVFN_OK;
+}
+
+int navfn_plan(navfn_context *ctx, const unsigned char *costs, int nx, int ny, int flags,
+    const int goal[2], const int start[2], float *plan, int nplan){
+  if(!ctx || !costs || !goal || !start || !plan || nplan <= 0 || nx < 3 || ny < 3)
+    return NAVFN_INVALID;
+  if(goal[0] < 0 || goal[0] >= nx || goal[1] < 0 || goal[1] >= ny ||
+      start[0] < 0 || start[0] >= nx || start[1] < 0 || start[1] >= ny)
+    return NAVFN_INVALID;
+
+  NavFn& nav = *ctx->planner;
+  try {
+    if(nav.nx != nx || nav.ny != ny)
+      nav.setNavArr(nx, ny);
+  }
+  catch(const std::bad_alloc&){
+    return NAVFN_NO_MEMORY;
+  }
+
+  //the planner's own buffer gets the obstacle border, the caller's array is only read; a context's planner is
+  //only ever given costs here, so its cost array is never borrowed or a view
+  if(flags & NAVFN_ROS_COSTS)
+    nav.setCostmap(costs, true, (flags & NAVFN_ALLOW_UNKNOWN) != 0);
+  else
+    memcpy(nav.costarr, costs, (size_t)nx * ny * sizeof(COSTTYPE));
+  int g[2] = { goal[0], goal[1] };
+  int s[2] = { start[0], start[1] };
+  nav.setGoal(g);
+  nav.setStart(s);
+  nav.priInc = 2*COST_NEUTRAL;
+
+  nav.setupNavFn(true);
+  ctx->engine->propagate(nav);
+  int len = nav.calcPath(nplan);
+  if(len <= 0)
+    return NAVFN_NO_PATH;
+  for(int i = 0; i < len; ++i){
+    plan[i*2] = nav.pathx[i];
+    plan[i*2+1] = nav.pathy[i];
+  }
+  return len;
+}
+
+navfn_pool *navfn_pool_create(int size, int queue_depth, double wait_time){
+  if(size <= 0 || queue_depth < 0)
+    return NULL;
+  //the pool allocates its planners and their locks up front, nothing may throw through the C interface
+  try {
+    return new navfn_pool(size, queue_depth, wait_time);
+  }
+  catch(const std::exception&){
+    return NULL;
+  }
+}
+
+void navfn_pool_destroy(navfn_pool *pool){
+  delete pool;
+}
+
+navfn_context *navfn_pool_acquire(navfn_pool *pool){
+  if(!pool)
+    return NULL;
+  boost::shared_ptr<NavFn> planner = pool->planners.acquire();
+  return planner ? makeContext(planner) : NULL;
+}
+
+}
+
+namespace navfn {
+
+  namespace {
+    //the context of a thread, freed when the thread exits
+    struct ThreadContext {
+      ThreadContext() : ctx(NULL) {}
+      ~ThreadContext() { navfn_destroy(ctx); }
+      navfn_context *ctx;
+    };
+  }
+
+  int
+    create_nav_plan_astar(const COSTTYPE *costmap, int nx, int ny,
+        int* goal, int* start,
+        float *plan, int nplan)
+    {
+      static thread_local ThreadContext local;
+      if (local.ctx == NULL)
+        local.ctx = navfn_create();
+      int len = navfn_plan(local.ctx, costmap, nx, ny, 0, goal, start, plan, nplan);
+      return len > 0 ? len : 0;
+    }
+
+};
@@ -0,0 +1,163 @@
+/*********************************************************************
+*
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2008, Willow Garage, Inc.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*
+*********************************************************************/
+//
+// Writes a synthetic costmap, in the ROS convention, as <prefix>.pgm and start/goal
+// pairs connected through it as <prefix>.txt, one "start_x start_y goal_x goal_y"
+// per line like bench/willow_corpus.txt.
+//
+
+#include <navfn/map_generator.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+static void usage()
+{
+  fprintf( stderr,
+      "usage: navfn_mapgen [options] <prefix>\n"
+      "  --layout hall|aisles|maze|random   (random)\n"
+      "  --size <width>x<height>            (1000x1000)\n"
+      "  --density <share>                  (0.1)\n"
+      "  --feature <cells>                  (8)\n"
+      "  --inscribed <cells>                (3)\n"
+      "  --inflation <cells>                (10)\n"
+      "  --problems <n>                     (16)\n"
+      "  --min-distance <cells>             (a quarter of the smaller side)\n"
+      "  --seed <n>                         (1)\n" );
+}
+
+int main(int argc, char **argv)
+{
+  navfn::MapGenerator::Options opts;
+  unsigned long long seed = 1;
+  int problems = 16;
+  double min_distance = -1.0;
+  std::string prefix;
+
+  for( int i = 1; i < argc; i++ )
+  {
+    std::string arg = argv[ i ];
+    if( arg.compare( 0, 2, "--" ) != 0 )
+    {
+      prefix = arg;
+      continue;
+    }
+    if( i + 1 >= argc )
+    {
+      usage();
+      return 1;
+    }
+    const char *value = argv[ ++i ];
+    if( arg == "--layout" )
+    {
+      if( !navfn::MapGenerator::parseLayout( value, opts.layout ))
+      {
+        fprintf( stderr, "Unknown layout %s\n", value );
+        return 1;
+      }
+    }
+    else if( arg == "--size" )
+    {
+      if( sscanf( value, "%dx%d", &opts.width, &opts.height ) != 2 || opts.width < 3 || opts.height < 3 )
+      {
+        fprintf( stderr, "Bad size %s\n", value );
+        return 1;
+      }
+    }
+    else if( arg == "--density" )
+      opts.density = atof( value );
+    else if( arg == "--feature" )
+      opts.feature_size = atoi( value );
+    else if( arg == "--inscribed" )
+      opts.inscribed_radius = atof( value );
+    else if( arg == "--inflation" )
+      opts.inflation_radius = atof( value );
+    else if( arg == "--problems" )
+      problems = atoi( value );
+    else if( arg == "--min-distance" )
+      min_distance = atof( value );
+    else if( arg == "--seed" )
+      seed = strtoull( value, NULL, 10 );
+    else
+    {
+      usage();
+      return 1;
+    }
+  }
+  if( prefix.empty() )
+  {
+    usage();
+    return 1;
+  }
+  if( min_distance < 0.0 )
+    min_distance = std::min( opts.width, opts.height ) / 4.0;
+
+  navfn::MapGenerator gen( seed );
+  std::vector<unsigned char> costs;
+  gen.generate( opts, costs );
+  std::vector<int> pairs;
+  int found = gen.sampleProblems( costs, opts.width, opts.height, problems, min_distance, pairs );
+
+  std::string pgm = prefix + ".pgm";
+  FILE *f = fopen( pgm.c_str(), "wb" );
+  if( f == NULL )
+  {
+    fprintf( stderr, "Can't write %s\n", pgm.c_str() );
+    return 1;
+  }
+  fprintf( f, "P5\n# navfn_mapgen %s seed %llu density %g feature %d\n%d %d\n255\n",
+      navfn::MapGenerator::layoutName( opts.layout ), seed, opts.density, opts.feature_size, opts.width, opts.height );
+  fwrite( &costs[0], 1, costs.size(), f );
+  fclose( f );
+
+  std::string txt = prefix + ".txt";
+  f = fopen( txt.c_str(), "w" );
+  if( f == NULL )
+  {
+    fprintf( stderr, "Can't write %s\n", txt.c_str() );
+    return 1;
+  }
+  fprintf( f, "# start_x start_y goal_x goal_y, in cells of %s\n", pgm.c_str() );
+  for( int i = 0; i < found; i++ )
+    fprintf( f, "%d %d %d %d\n", pairs[ 4*i ], pairs[ 4*i+1 ], pairs[ 4*i+2 ], pairs[ 4*i+3 ] );
+  fclose( f );
+
+  printf( "Wrote %s (%d x %d) and %d of %d problems to %s\n", pgm.c_str(), opts.width, opts.height, found, problems, txt.c_str() );
+  return found == problems ? 0 : 2;
+}
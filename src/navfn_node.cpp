@@ -38,6 +38,9 @@
 #include <navfn/MakeNavPlan.h>
 #include <boost/shared_ptr.hpp>
 #include <costmap_2d/costmap_2d_ros.h>
+#include <costmap_2d/cost_values.h>
+#include <nav_msgs/OccupancyGrid.h>
+#include <map_msgs/OccupancyGridUpdate.h>
 namespace cm=costmap_2d;
 namespace rm=geometry_msgs;
 
@@ -107,12 +110,135 @@ NavfnWithCostmap::NavfnWithCostmap(string name, Costmap2DROS* cmap) :
   pose_sub_ = private_nh.subscribe<rm::PoseStamped>("goal", 1, &NavfnWithCostmap::poseCallback, this);
 }
 
+// Plans on a costmap published elsewhere, e.g. by the robot's own move_base, instead of running a costmap stack:
+// the full costmap comes in on "map" and its changes on "map_updates", and only the changed rectangles
+// are translated for the planner.
+class NavfnWithStreamedCostmap : public NavfnROS
+{
+public:
+  NavfnWithStreamedCostmap(string name);
+  bool makePlanService(MakeNavPlan::Request& req, MakeNavPlan::Response& resp);
+
+private:
+  void mapCallback(const nav_msgs::OccupancyGrid::ConstPtr& map);
+  void updateCallback(const map_msgs::OccupancyGridUpdate::ConstPtr& update);
+  string name_;
+  Costmap2D map_;
+  unsigned char cost_lut_[256]; // published occupancy value -> costmap cost
+  ros::ServiceServer make_plan_service_;
+  ros::Subscriber map_sub_, update_sub_;
+};
+
+
+NavfnWithStreamedCostmap::NavfnWithStreamedCostmap(string name) :
+  NavfnROS(), name_(name)
+{
+  // undo the cost -> occupancy scaling costmap_2d publishes with
+  for (int i = 0; i < 256; i++)
+    cost_lut_[i] = cm::NO_INFORMATION;
+  cost_lut_[0] = cm::FREE_SPACE;
+  for (int i = 1; i < 99; i++)
+    cost_lut_[i] = 1 + ((i - 1) * 251 + 48) / 97;
+  cost_lut_[99] = cm::INSCRIBED_INFLATED_OBSTACLE;
+  cost_lut_[100] = cm::LETHAL_OBSTACLE;
+
+  ros::NodeHandle private_nh("~");
+  make_plan_service_ = private_nh.advertiseService("make_plan", &NavfnWithStreamedCostmap::makePlanService, this);
+  map_sub_ = private_nh.subscribe("map", 1, &NavfnWithStreamedCostmap::mapCallback, this);
+  update_sub_ = private_nh.subscribe("map_updates", 10, &NavfnWithStreamedCostmap::updateCallback, this);
+}
+
+bool NavfnWithStreamedCostmap::makePlanService(MakeNavPlan::Request& req, MakeNavPlan::Response& resp)
+{
+  if (!initialized_) {
+    ROS_WARN("No costmap received yet, can't plan");
+    resp.plan_found = false;
+    return true;
+  }
+
+  vector<PoseStamped> path;
+
+  req.start.header.frame_id = "/map";
+  req.goal.header.frame_id = "/map";
+  bool success = makePlan(req.start, req.goal, path);
+  resp.plan_found = success;
+  if (success) {
+    resp.path = path;
+  }
+
+  return true;
+}
+
+void NavfnWithStreamedCostmap::mapCallback(const nav_msgs::OccupancyGrid::ConstPtr& map)
+{
+  unsigned int nx = map->info.width, ny = map->info.height;
+  if (map->data.size() != (size_t)nx * ny) {
+    ROS_WARN("Costmap of %ux%u cells came with %lu values, ignoring it", nx, ny, (unsigned long)map->data.size());
+    return;
+  }
+
+  {
+    boost::unique_lock<Costmap2D::mutex_t> lock(*(map_.getMutex()));
+    if (map_.getSizeInCellsX() != nx || map_.getSizeInCellsY() != ny ||
+        map_.getResolution() != map->info.resolution ||
+        map_.getOriginX() != map->info.origin.position.x || map_.getOriginY() != map->info.origin.position.y)
+      map_.resizeMap(nx, ny, map->info.resolution, map->info.origin.position.x, map->info.origin.position.y);
+
+    unsigned char* costs = map_.getCharMap();
+    for (unsigned int i = 0; i < nx * ny; i++)
+      costs[i] = cost_lut_[(unsigned char)map->data[i]];
+  }
+
+  if (!initialized_)
+    initialize(name_, &map_, map->header.frame_id);
+  costmapRegionUpdated(0, 0, nx, ny);
+}
+
+void NavfnWithStreamedCostmap::updateCallback(const map_msgs::OccupancyGridUpdate::ConstPtr& update)
+{
+  if (!initialized_)
+    return;
+
+  unsigned int nx, ny;
+  {
+    boost::unique_lock<Costmap2D::mutex_t> lock(*(map_.getMutex()));
+    nx = map_.getSizeInCellsX();
+    ny = map_.getSizeInCellsY();
+    if (update->x < 0 || update->y < 0 || update->x + update->width > nx || update->y + update->height > ny) {
+      ROS_WARN("Costmap update %ux%u at (%d, %d) doesn't fit in the %ux%u costmap, waiting for the next full map",
+          update->width, update->height, update->x, update->y, nx, ny);
+      return;
+    }
+
+    if (update->data.size() < update->width * update->height)
+      return;
+    const int8_t* src = update->data.empty() ? NULL : &update->data[0];
+    for (unsigned int y = 0; y < update->height; y++) {
+      unsigned char* dst = map_.getCharMap() + (update->y + y) * nx + update->x;
+      for (unsigned int x = 0; x < update->width; x++)
+        dst[x] = cost_lut_[(unsigned char)*src++];
+    }
+  }
+
+  costmapRegionUpdated(update->x, update->y, update->width, update->height);
+}
+
 } // namespace
 
 int main (int argc, char** argv)
 {
   ros::init(argc, argv, "global_planner");
 
+  // subscribe to a published costmap instead of building one here
+  ros::NodeHandle private_nh("~");
+  bool stream_costmap;
+  private_nh.param("stream_costmap", stream_costmap, false);
+  if (stream_costmap) {
+    navfn::NavfnWithStreamedCostmap navfn("navfn_planner");
+    ros::spin();
+    return 0;
+  }
+
   tf::TransformListener tf(ros::Duration(10));
 
   costmap_2d::Costmap2DROS lcr("costmap", tf);
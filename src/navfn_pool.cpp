@@ -0,0 +1,108 @@
+/*********************************************************************
+*
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2008, Willow Garage, Inc.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*
+*********************************************************************/
+#include <navfn/navfn_pool.h>
+#include <ros/console.h>
+#include <boost/bind.hpp>
+
+namespace navfn {
+
+  NavFnPool::NavFnPool(int size, int queue_depth, double wait_time)
+    : size_(size), queue_depth_(queue_depth), wait_time_(wait_time), waiting_(0), rejected_(0) {
+    //planners are sized on first use, so they all follow the costmap
+    for(int i = 0; i < size_; ++i)
+      free_.push_back(new NavFn(0, 0));
+  }
+
+  NavFnPool::~NavFnPool(){
+    //all leases have to be returned by now
+    for(unsigned int i = 0; i < free_.size(); ++i)
+      delete free_[i];
+  }
+
+  boost::shared_ptr<NavFn> NavFnPool::acquire(){
+    boost::mutex::scoped_lock lock(mutex_);
+
+    if(free_.empty()){
+      if(waiting_ >= queue_depth_){
+        ++rejected_;
+        ROS_WARN_THROTTLE(1.0, "[NavFnPool] All %d planners are busy and %d requests are already waiting, rejecting request",
+            size_, waiting_);
+        return boost::shared_ptr<NavFn>();
+      }
+
+      ++waiting_;
+      boost::system_time deadline = boost::get_system_time() + boost::posix_time::microseconds((int64_t)(wait_time_ * 1e6));
+      while(free_.empty()){
+        if(!cond_.timed_wait(lock, deadline) && free_.empty())
+          break;
+      }
+      --waiting_;
+
+      if(free_.empty()){
+        ++rejected_;
+        ROS_WARN_THROTTLE(1.0, "[NavFnPool] Timed out after %.2f seconds waiting for a planner", wait_time_);
+        return boost::shared_ptr<NavFn>();
+      }
+    }
+
+    NavFn* planner = free_.back();
+    free_.pop_back();
+    return boost::shared_ptr<NavFn>(planner, boost::bind(&NavFnPool::release, this, _1));
+  }
+
+  void NavFnPool::release(NavFn* planner){
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      free_.push_back(planner);
+    }
+    cond_.notify_one();
+  }
+
+  int NavFnPool::busy(){
+    boost::mutex::scoped_lock lock(mutex_);
+    return size_ - free_.size();
+  }
+
+  int NavFnPool::waiting(){
+    boost::mutex::scoped_lock lock(mutex_);
+    return waiting_;
+  }
+
+  unsigned int NavFnPool::rejected(){
+    boost::mutex::scoped_lock lock(mutex_);
+    return rejected_;
+  }
+};
@@ -0,0 +1,260 @@
+/*********************************************************************
+*
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2008, Willow Garage, Inc.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*
+*********************************************************************/
+//
+// Replays planning snapshots, such as the ones NavfnROS records with record_every or
+// record_latency, through the planner without a display or a ROS master. Reports the
+// latency distribution of each engine, and how the cost of the replayed paths differs
+// from the recorded ones.
+//
+
+#include <navfn/navfn.h>
+#include <navfn/planner_engine.h>
+#include <navfn/planning_snapshot.h>
+#include <navfn/plan_stats.h>
+#include <navfn/trace.h>
+#include <dirent.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+static void usage()
+{
+  fprintf( stderr,
+      "usage: navfn_replay [options] <snapshot or directory>...\n"
+      "  --engine <name>|all                (dijkstra), may be repeated\n"
+      "  --repeat <n>                       (1)\n"
+      "  --verbose                          one line per snapshot and engine\n" );
+}
+
+struct Engine
+{
+  Engine( const boost::shared_ptr<const navfn::PlannerEngine>& e )
+    : engine( e ), name( e->name() ), plans( 0 ), found( 0 ), missing( 0 ), compared( 0 ), worse( 0 ),
+      cost_diff( 0.0 ), max_cost_diff( 0.0 ) {}
+
+  // a full plan the way NavfnROS makes one, with the path followed back from the start
+  bool plan( navfn::NavFn& nav ) const
+  {
+    nav.setupNavFn( true );
+    engine->propagate( nav );
+    return nav.calcPath( nav.nx * nav.ny / 2 ) > 0;
+  }
+
+  boost::shared_ptr<const navfn::PlannerEngine> engine;
+  const char *name;
+  navfn::LatencyHistogram latency;
+  int plans, found, missing, compared, worse;
+  double cost_diff, max_cost_diff;
+};
+
+// Cost of a path: its length in cells weighted by the planner cost under each segment
+static double pathCost( const COSTTYPE *costs, int nx, int ny, const float *x, const float *y, int n )
+{
+  double cost = 0.0;
+  if( costs == NULL )
+    return cost;
+  for( int i = 1; i < n; i++ )
+  {
+    int cx = std::min( nx - 1, std::max( 0, (int)( 0.5f * ( x[ i-1 ] + x[ i ] ))));
+    int cy = std::min( ny - 1, std::max( 0, (int)( 0.5f * ( y[ i-1 ] + y[ i ] ))));
+    cost += hypot( x[ i ] - x[ i-1 ], y[ i ] - y[ i-1 ] ) * costs[ cy * nx + cx ];
+  }
+  return cost;
+}
+
+// Snapshots named on the command line, and the ones in directories named on it, in name order
+static void collect( const std::string& path, std::vector<std::string>& files )
+{
+  struct stat st;
+  if( stat( path.c_str(), &st ) != 0 )
+  {
+    fprintf( stderr, "Can't read %s\n", path.c_str() );
+    return;
+  }
+  if( !S_ISDIR( st.st_mode ))
+  {
+    files.push_back( path );
+    return;
+  }
+  DIR *dir = opendir( path.c_str() );
+  if( dir == NULL )
+    return;
+  std::vector<std::string> names;
+  struct dirent *entry;
+  while(( entry = readdir( dir )) != NULL )
+  {
+    std::string name = entry->d_name;
+    if( name.size() > 6 && name.compare( name.size() - 6, 6, ".navfn" ) == 0 )
+      names.push_back( path + "/" + name );
+  }
+  closedir( dir );
+  std::sort( names.begin(), names.end() );
+  files.insert( files.end(), names.begin(), names.end() );
+}
+
+int main(int argc, char **argv)
+{
+  navfn::EngineRegistry& registry = navfn::EngineRegistry::instance();
+  std::vector<std::string> names = registry.names();
+  std::vector<Engine> run;
+  int repeat = 1;
+  bool verbose = false;
+  std::vector<std::string> files;
+
+  for( int i = 1; i < argc; i++ )
+  {
+    std::string arg = argv[ i ];
+    if( arg == "--verbose" )
+    {
+      verbose = true;
+      continue;
+    }
+    if( arg.compare( 0, 2, "--" ) != 0 )
+    {
+      collect( arg, files );
+      continue;
+    }
+    if( i + 1 >= argc )
+    {
+      usage();
+      return 1;
+    }
+    std::string value = argv[ ++i ];
+    if( arg == "--engine" )
+    {
+      size_t before = run.size();
+      for( size_t e = 0; e < names.size(); e++ )
+        if( value == "all" || value == names[ e ] )
+          run.push_back( Engine( registry.get( names[ e ] )));
+      if( run.size() == before )
+      {
+        fprintf( stderr, "Unknown engine %s\n", value.c_str() );
+        return 1;
+      }
+    }
+    else if( arg == "--repeat" )
+      repeat = std::max( 1, atoi( value.c_str() ));
+    else
+    {
+      usage();
+      return 1;
+    }
+  }
+  if( files.empty() )
+  {
+    usage();
+    return 1;
+  }
+  if( run.empty() )
+    run.push_back( Engine( registry.get( "dijkstra" )));
+
+  navfn::NavFn nav( 1, 1 );
+  int replayed = 0;
+  for( size_t f = 0; f < files.size(); f++ )
+  {
+    navfn::PlanningSnapshot snap;
+    if( !snap.open( files[ f ] ))
+    {
+      fprintf( stderr, "Skipping %s, it is not a planning snapshot\n", files[ f ].c_str() );
+      continue;
+    }
+    const navfn::SnapshotInfo& info = snap.info();
+    if( nav.nx != info.nx || nav.ny != info.ny )
+      nav.setNavArr( info.nx, info.ny );
+    if( !snap.restore( nav ))
+    {
+      fprintf( stderr, "Skipping %s, it has no costs that can be planned on\n", files[ f ].c_str() );
+      continue;
+    }
+    const float *rx = snap.pathX(), *ry = snap.pathY();
+    double recorded = rx ? pathCost( snap.costs(), info.nx, info.ny, rx, ry, info.path_len ) : 0.0;
+    replayed++;
+
+    for( size_t e = 0; e < run.size(); e++ )
+    {
+      Engine& engine = run[ e ];
+      bool found = false;
+      for( int r = 0; r < repeat; r++ )
+      {
+        if( !snap.restore( nav ))
+          break;
+        uint64_t t0 = navfn::Tracer::now();
+        found = engine.plan( nav );
+        engine.latency.record(( navfn::Tracer::now() - t0 ) * 1e-9 );
+        engine.plans++;
+      }
+      if( found )
+        engine.found++;
+
+      // a plan the robot had that the replay doesn't find, or the other way round
+      if( found != ( rx != NULL ))
+        engine.missing++;
+      double diff = 0.0;
+      if( found && rx )
+      {
+        double cost = pathCost( snap.costs(), info.nx, info.ny, nav.getPathX(), nav.getPathY(), nav.getPathLen() );
+        diff = recorded > 0.0 ? ( cost - recorded ) / recorded : 0.0;
+        engine.compared++;
+        engine.cost_diff += diff;
+        engine.max_cost_diff = std::max( engine.max_cost_diff, fabs( diff ));
+        if( diff > 1e-3 )
+          engine.worse++;
+      }
+      if( verbose )
+        printf( "%s %s: %s, %d x %d, path %d, cost %+.2f%%\n", files[ f ].c_str(), engine.name,
+            found ? "found" : "no plan", info.nx, info.ny, found ? nav.getPathLen() : 0, 100.0 * diff );
+    }
+  }
+
+  printf( "%d snapshots, %d runs each\n", replayed, repeat );
+  printf( "%-10s %6s %6s %9s %9s %9s %9s %9s %8s %10s %10s %6s\n", "engine", "plans", "found", "p50 ms", "p90 ms",
+      "p99 ms", "max ms", "mean ms", "differ", "cost mean", "cost max", "worse" );
+  for( size_t e = 0; e < run.size(); e++ )
+  {
+    const Engine& engine = run[ e ];
+    const navfn::LatencyHistogram& h = engine.latency;
+    printf( "%-10s %6d %6d %9.2f %9.2f %9.2f %9.2f %9.2f %8d %+9.2f%% %9.2f%% %6d\n", engine.name, engine.plans,
+        engine.found, 1e3 * h.percentile( 0.5 ), 1e3 * h.percentile( 0.9 ), 1e3 * h.percentile( 0.99 ),
+        1e3 * h.max(), 1e3 * h.mean(), engine.missing,
+        engine.compared ? 100.0 * engine.cost_diff / engine.compared : 0.0, 100.0 * engine.max_cost_diff,
+        engine.worse );
+  }
+  return replayed > 0 ? 0 : 1;
+}
@@ -36,28 +36,48 @@
 *********************************************************************/
 #include <navfn/navfn_ros.h>
 #include <pluginlib/class_list_macros.h>
+#include <boost/bind.hpp>
 #include <tf/transform_listener.h>
 #include <costmap_2d/cost_values.h>
 #include <costmap_2d/costmap_2d.h>
 
 #include <pcl_conversions/pcl_conversions.h>
+#include <signal.h>
+#include <string.h>
 
 //register this planner as a BaseGlobalPlanner plugin
 PLUGINLIB_EXPORT_CLASS(navfn::NavfnROS, nav_core::BaseGlobalPlanner)
 
 namespace navfn {
 
+  //set by SIGUSR1, the trace is written by a timer, outside of the handler
+  static volatile sig_atomic_t trace_dump_requested = 0;
+
+  static void traceSignalHandler(int){
+    trace_dump_requested = 1;
+  }
+
+  //seconds since t, which is moved on to now, recorded in the trace as the phase that just ended unless it is NULL
+  static double lap(uint64_t& t, const char* phase){
+    uint64_t now = Tracer::now();
+    if(phase)
+      Tracer::instance().complete(phase, t, now - t);
+    double elapsed = (now - t) * 1e-9;
+    t = now;
+    return elapsed;
+  }
+
   NavfnROS::NavfnROS() 
-    : costmap_(NULL),  planner_(), initialized_(false), allow_unknown_(true) {}
+    : costmap_(NULL),  planner_(), initialized_(false), allow_unknown_(true), planner_potential_(false) {}
 
   NavfnROS::NavfnROS(std::string name, costmap_2d::Costmap2DROS* costmap_ros)
-    : costmap_(NULL),  planner_(), initialized_(false), allow_unknown_(true) {
+    : costmap_(NULL),  planner_(), initialized_(false), allow_unknown_(true), planner_potential_(false) {
       //initialize the planner
       initialize(name, costmap_ros);
   }
 
   NavfnROS::NavfnROS(std::string name, costmap_2d::Costmap2D* costmap, std::string global_frame)
-    : costmap_(NULL),  planner_(), initialized_(false), allow_unknown_(true) {
+    : costmap_(NULL),  planner_(), initialized_(false), allow_unknown_(true), planner_potential_(false) {
       //initialize the planner
       initialize(name, costmap, global_frame);
   }
@@ -73,11 +93,88 @@ namespace navfn {
 
       plan_pub_ = private_nh.advertise<nav_msgs::Path>("plan", 5);
 
+      //messages are built and published on a separate thread, when it falls this many behind
+      //visualization is dropped and plans are published by the planning thread itself
+      int publish_queue_size;
+      private_nh.param("publish_queue_size", publish_queue_size, 16);
+      publish_queue_.reset(new PublishQueue(std::max(1, publish_queue_size)));
+
+      //latency percentiles of the plans of each period, in seconds, are published as diagnostics, 0 disables this
+      double diagnostics_period;
+      private_nh.param("diagnostics_period", diagnostics_period, 10.0);
+      diagnostics_name_ = name + ": planning";
+
+      //record plan phases and propagation progress into a ring of trace_capacity events, written as Chrome trace
+      //JSON to trace_file by the dump_trace service, or on SIGUSR1 if trace_dump_on_signal is set
+      bool trace;
+      private_nh.param("trace", trace, false);
+      if(trace){
+        int trace_capacity;
+        bool trace_dump_on_signal;
+        private_nh.param("trace_capacity", trace_capacity, 65536);
+        private_nh.param("trace_file", trace_file_, std::string("/tmp/navfn_trace.json"));
+        private_nh.param("trace_dump_on_signal", trace_dump_on_signal, false);
+        //the tracer is shared by the whole process, the first planner asking for it sets it up
+        if(!Tracer::instance().enabled())
+          Tracer::instance().enable(std::max(1, trace_capacity));
+        dump_trace_srv_ = private_nh.advertiseService("dump_trace", &NavfnROS::dumpTraceService, this);
+        if(trace_dump_on_signal){
+          signal(SIGUSR1, traceSignalHandler);
+          trace_timer_ = private_nh.createTimer(ros::Duration(0.5), &NavfnROS::checkTraceSignal, this);
+        }
+      }
+      //record every record_every-th plan, and plans slower than record_latency seconds, as planning snapshots in a
+      //ring of record_ring files in record_dir, to be replayed with navfn_replay
+      int record_every;
+      double record_latency;
+      private_nh.param("record_every", record_every, 0);
+      private_nh.param("record_latency", record_latency, 0.0);
+      if(record_every > 0 || record_latency > 0.0){
+        std::string record_dir;
+        int record_ring;
+        bool record_compress;
+        private_nh.param("record_dir", record_dir, std::string("/tmp/navfn_recordings"));
+        private_nh.param("record_ring", record_ring, 100);
+        private_nh.param("record_compress", record_compress, true);
+        recorder_.reset(new PlanRecorder(record_dir, record_ring, record_every, record_latency,
+              SNAPSHOT_POTENTIAL | SNAPSHOT_PATH | (record_compress ? SNAPSHOT_LZ4 : 0)));
+      }
+
+      if(diagnostics_period > 0.0){
+        diagnostics_pub_ = private_nh.advertise<diagnostic_msgs::DiagnosticArray>("/diagnostics", 1);
+        diagnostics_timer_ = private_nh.createTimer(ros::Duration(diagnostics_period), &NavfnROS::publishDiagnostics, this);
+      }
+
+      //the engine propagating the potential, any name in the EngineRegistry, also settable through dynamic reconfigure
+      std::string engine;
+      private_nh.param("engine", engine, std::string("dijkstra"));
+      engine_ = EngineRegistry::instance().get("dijkstra");
+      setEngine(engine);
+
       private_nh.param("visualize_potential", visualize_potential_, false);
 
+      //"cloud" publishes a point per reached cell, "grid" a compact PotentialGrid; decimation keeps every n-th
+      //cell in both directions and the rate, in Hz, limits how often either is published, 0 for every plan
+      private_nh.param("potential_encoding", potential_encoding_, std::string("cloud"));
+      private_nh.param("potential_decimation", potential_decimation_, 1);
+      private_nh.param("potential_rate", potential_rate_, 0.0);
+
       //if we're going to visualize the potential array we need to advertise
-      if(visualize_potential_)
-        potarr_pub_.advertise(private_nh, "potential", 1);
+      if(visualize_potential_){
+        if(potential_encoding_ == "grid")
+          potential_grid_pub_ = private_nh.advertise<PotentialGrid>("potential_grid", 1);
+        else
+          potarr_pub_.advertise(private_nh, "potential", 1);
+      }
+
+      //export every computed potential into the POSIX shared memory segment of this name, for readers on this host
+      std::string potential_shm;
+      private_nh.param("potential_shm", potential_shm, std::string(""));
+      if(!potential_shm.empty()){
+        potential_shm_.reset(new PotentialShmWriter);
+        if(!potential_shm_->open(potential_shm, costmap_->getSizeInCellsX() * costmap_->getSizeInCellsY()))
+          potential_shm_.reset();
+      }
 
       private_nh.param("allow_unknown", allow_unknown_, true);
       private_nh.param("planner_window_x", planner_window_x_, 0.0);
@@ -86,11 +183,65 @@ namespace navfn {
 
       private_nh.param("subgoal_tolerance", subgoal_tolerance_, 1.0);
 
+      //optionally shortcut plans along lines of sight and resample them, spacing in meters, 0 keeps only the corners
+      private_nh.param("simplify_path", simplify_path_, false);
+      private_nh.param("path_spacing", path_spacing_, costmap_->getResolution());
+
+      //compute the gradient field in one pass after propagation instead of per cell while following it
+      private_nh.param("dense_gradient", dense_gradient_, false);
+
+      //plan on the costmap in place instead of on a translated copy, the costmap stays locked while planning
+      private_nh.param("costmap_view", costmap_view_, false);
+
+      //keep the translated costmap between plans and only translate the tiles that changed
+      private_nh.param("incremental_costmap", incremental_costmap_, false);
+      streamed_costs_ = false;
+
+      //keep the first translation of a static costmap and stamp moving obstacles over it for each plan instead
+      private_nh.param("static_costmap", static_costmap_, false);
+      private_nh.param("dynamic_obstacle_radius", dynamic_obstacle_radius_, 0.3);
+      static_loaded_ = false;
+      dynamic_obstacles_sub_ = private_nh.subscribe("dynamic_obstacles", 1, &NavfnROS::dynamicObstaclesCallback, this);
+
+      //serve concurrent requests from a pool of planners sharing one translated costmap, 0 keeps a single planner
+      int planner_pool_size, planner_pool_queue_depth;
+      double planner_pool_wait_time;
+      private_nh.param("planner_pool_size", planner_pool_size, 0);
+      private_nh.param("planner_pool_queue_depth", planner_pool_queue_depth, 8);
+      private_nh.param("planner_pool_wait_time", planner_pool_wait_time, 1.0);
+      private_nh.param("costmap_snapshot_max_age", snapshot_max_age_, 0.1);
+
+      //share one translation of the costmap with every other planner of the process planning on the same map,
+      //the cache keeps the shared_costmap_cache_size most recently used ones for planners planning later; it is
+      //keyed on shared_costmap_id and the load time of the static map, so the costmap must only change with that
+      //map, moving obstacles come from dynamic_obstacles
+      private_nh.param("shared_costmap_cache", shared_costmap_cache_, false);
+      private_nh.param("shared_costmap_id", shared_costmap_id_, global_frame_);
+      int shared_costmap_cache_size;
+      private_nh.param("shared_costmap_cache_size", shared_costmap_cache_size, 4);
+      map_version_ = 0;
+      if(shared_costmap_cache_){
+        CostTranslationCache::instance().setCapacity(std::max(0, shared_costmap_cache_size));
+        ros::NodeHandle nh;
+        map_metadata_sub_ = nh.subscribe("map_metadata", 1, &NavfnROS::mapMetaDataCallback, this);
+      }
+      if(planner_pool_size > 0)
+        planner_pool_.reset(new NavFnPool(planner_pool_size, planner_pool_queue_depth, planner_pool_wait_time));
+
+      //plan the legs between queued subgoals in the background, 0 disables this
+      int subgoal_segment_workers;
+      private_nh.param("subgoal_segment_workers", subgoal_segment_workers, 0);
+      if(subgoal_segment_workers > 0)
+        segment_cache_.reset(new SubgoalSegmentCache(costmap_, subgoal_segment_workers, allow_unknown_));
+
       //get the tf prefix
       ros::NodeHandle prefix_nh;
       tf_prefix_ = tf::getPrefixParam(prefix_nh);
 
       make_plan_srv_ =  private_nh.advertiseService("make_plan", &NavfnROS::makePlanService, this);
+
+      dsrv_.reset(new dynamic_reconfigure::Server<NavFnConfig>(private_nh));
+      dsrv_->setCallback(boost::bind(&NavfnROS::reconfigureCB, this, _1, _2));
       subgoal_pose_sub_ = private_nh.subscribe("/initialpose",1, &NavfnROS::subgoalCallback, this); // loop up how to do this properly, use this?
 
       subgoal_pub_ = private_nh.advertise<geometry_msgs::PoseArray>("/planned_subgoals", 1);
@@ -117,25 +268,12 @@ namespace navfn {
       return false;
     }
 
-    double resolution = costmap_->getResolution();
-    geometry_msgs::Point p;
-    p = world_point;
-
-    p.y = world_point.y - tolerance;
-
-    while(p.y <= world_point.y + tolerance){
-      p.x = world_point.x - tolerance;
-      while(p.x <= world_point.x + tolerance){
-        double potential = getPointPotential(p);
-        if(potential < POT_HIGH){
-          return true;
-        }
-        p.x += resolution;
-      }
-      p.y += resolution;
-    }
+    if(!hasPotential())
+      return false;
 
-    return false;
+    int cell[2], best[2];
+    costmap_->worldToMapNoBounds(world_point.x, world_point.y, cell[0], cell[1]);
+    return planner_->nearestReachable(cell[0], cell[1], std::max(0, (int)(tolerance / costmap_->getResolution())), best);
   }
 
   double NavfnROS::getPointPotential(const geometry_msgs::Point& world_point){
@@ -144,12 +282,53 @@ namespace navfn {
       return -1.0;
     }
 
+    if(!hasPotential())
+      return DBL_MAX;
+    return getPointPotential(*planner_, world_point);
+  }
+
+  bool NavfnROS::hasPotential(){
+    if(planner_potential_)
+      return true;
+    //pooled requests plan on leased planners, planner_ only ever holds the potential of computePotential()
+    if(planner_pool_)
+      ROS_ERROR("With a planner pool only computePotential() leaves a potential to query, and it hasn't been called yet");
+    else
+      ROS_ERROR("No potential has been computed yet, call computePotential() or makePlan() first");
+    return false;
+  }
+
+  double NavfnROS::getPointPotential(const NavFn& planner, const geometry_msgs::Point& world_point){
     unsigned int mx, my;
     if(!costmap_->worldToMap(world_point.x, world_point.y, mx, my))
       return DBL_MAX;
 
-    unsigned int index = my * planner_->nx + mx;
-    return planner_->potarr[index];
+    unsigned int index = my * planner.nx + mx;
+    return planner.potarr[index];
+  }
+
+  bool NavfnROS::getGradientField(std::vector<float>& gradx, std::vector<float>& grady){
+    if(!initialized_){
+      ROS_ERROR("This planner has not been initialized yet, but it is being used, please call initialize() before use");
+      return false;
+    }
+
+    if(!hasPotential())
+      return false;
+
+    if(!planner_->gradField)
+      planner_->computeGradientField();
+
+    //rows outside the propagated area have no gradient
+    gradx.assign(planner_->ns, 0.0);
+    grady.assign(planner_->ns, 0.0);
+    int lo = planner_->gradLo * planner_->nx;
+    int hi = (planner_->gradHi + 1) * planner_->nx;
+    if(hi > lo){
+      std::copy(planner_->gradx + lo, planner_->gradx + hi, gradx.begin() + lo);
+      std::copy(planner_->grady + lo, planner_->grady + hi, grady.begin() + lo);
+    }
+    return true;
   }
 
   bool NavfnROS::computePotential(const geometry_msgs::Point& world_point){
@@ -161,6 +340,7 @@ namespace navfn {
     //make sure to resize the underlying array that Navfn uses
     planner_->setNavArr(costmap_->getSizeInCellsX(), costmap_->getSizeInCellsY());
     planner_->setCostmap(costmap_->getCharMap(), true, allow_unknown_);
+    planner_->denseGrad = dense_gradient_;
 
     unsigned int mx, my;
     if(!costmap_->worldToMap(world_point.x, world_point.y, mx, my))
@@ -177,7 +357,43 @@ namespace navfn {
     planner_->setStart(map_start);
     planner_->setGoal(map_goal);
 
-    return planner_->calcNavFnDijkstra();
+    bool found = planner_->calcNavFnDijkstra();
+    planner_potential_ = true;
+
+    //hand a copy to the readers of getPotentialField(), they never wait for the planner
+    publishPotentialField(*planner_);
+    return found;
+  }
+
+  void NavfnROS::publishPotentialField(const NavFn& planner){
+    boost::shared_ptr<PotentialField> field(new PotentialField);
+    {
+      boost::mutex::scoped_lock lock(field_mutex_);
+      field->pot.swap(spare_potential_);
+    }
+    field->copyFrom(planner, costmap_->getOriginX(), costmap_->getOriginY(), costmap_->getResolution());
+
+    boost::shared_ptr<const PotentialField> old = boost::atomic_exchange(&potential_field_,
+        boost::shared_ptr<const PotentialField>(field));
+
+    //no reader can pick the old field up anymore, so if no one holds it its buffer can take the next copy
+    if(old && old.unique()){
+      boost::mutex::scoped_lock lock(field_mutex_);
+      spare_potential_.swap(const_cast<PotentialField&>(*old).pot);
+    }
+  }
+
+  boost::shared_ptr<const PotentialField> NavfnROS::getPotentialField(){
+    return boost::atomic_load(&potential_field_);
+  }
+
+  bool NavfnROS::getPotentials(const float* wx, const float* wy, unsigned int n, float* potentials,
+      bool interpolate, float* gradx, float* grady){
+    boost::shared_ptr<const PotentialField> field = getPotentialField();
+    if(!field)
+      return false;
+    field->sample(wx, wy, n, potentials, interpolate, gradx, grady);
+    return true;
   }
 
   void NavfnROS::clearRobotCell(const tf::Stamped<tf::Pose>& global_pose, unsigned int mx, unsigned int my){
@@ -186,10 +402,27 @@ namespace navfn {
       return;
     }
 
-    //set the associated costs in the cost map to be free
+    //set the associated costs in the cost map to be free, the costmap's updates and pooled requests write it too
+    boost::unique_lock<costmap_2d::Costmap2D::mutex_t> lock(*(costmap_->getMutex()));
     costmap_->setCost(mx, my, costmap_2d::FREE_SPACE);
   }
 
+  bool NavfnROS::setEngine(const std::string& name){
+    boost::shared_ptr<const PlannerEngine> engine = EngineRegistry::instance().get(name);
+    if(!engine){
+      ROS_ERROR("There is no planner engine called %s, keeping %s", name.c_str(), boost::atomic_load(&engine_)->name());
+      return false;
+    }
+    boost::atomic_store(&engine_, engine);
+    ROS_INFO("Planning with the %s engine", engine->name());
+    return true;
+  }
+
+  void NavfnROS::reconfigureCB(NavFnConfig& config, uint32_t level){
+    if(!setEngine(config.engine))
+      config.engine = boost::atomic_load(&engine_)->name();
+  }
+
   bool NavfnROS::makePlanService(nav_msgs::GetPlan::Request& req, nav_msgs::GetPlan::Response& resp){
     makePlan(req.start, req.goal, resp.plan.poses);
 
@@ -199,6 +432,159 @@ namespace navfn {
     return true;
   } 
 
+  void NavfnROS::publishPotential(const NavFn& planner){
+    boost::shared_ptr<PotentialField> field;
+    {
+      boost::mutex::scoped_lock lock(potential_viz_mutex_);
+      ros::WallTime now = ros::WallTime::now();
+      if(potential_rate_ > 0.0 && (now - last_potential_pub_).toSec() < 1.0 / potential_rate_)
+        return;
+      last_potential_pub_ = now;
+      field.swap(spare_viz_field_);
+    }
+
+    //only the decimated cells are copied here, the message is built on the publisher thread, which hands the
+    //field back for the next frame
+    int step = std::max(1, potential_decimation_);
+    if(!field)
+      field.reset(new PotentialField);
+    field->nx = (planner.nx + step - 1) / step;
+    field->ny = (planner.ny + step - 1) / step;
+    field->origin_x = costmap_->getOriginX();
+    field->origin_y = costmap_->getOriginY();
+    field->resolution = costmap_->getResolution() * step;
+    field->pot.resize(field->nx * field->ny);
+
+    float *out = field->pot.empty() ? NULL : &field->pot[0];
+    for(int y = 0; y < planner.ny; y += step){
+      const float *row = planner.potarr + y * planner.nx;
+      for(int x = 0; x < planner.nx; x += step)
+        *out++ = row[x];
+    }
+    float start_pot = planner.potarr[planner.start[1] * planner.nx + planner.start[0]];
+
+    publish_queue_->post(boost::bind(&NavfnROS::buildPotentialMessage, this, field, start_pot, ros::Time::now()), true);
+  }
+
+  void NavfnROS::buildPotentialMessage(const boost::shared_ptr<PotentialField>& field, float start_pot, const ros::Time& stamp){
+    const float *pp = field->pot.empty() ? NULL : &field->pot[0];
+    double ox = field->origin_x, oy = field->origin_y, res = field->resolution;
+
+    if(potential_encoding_ == "grid"){
+      //quantize to 16 bits over the largest reached potential, cells are sampled rather than averaged
+      float max_pot = 0.0;
+      for(size_t i = 0; i < field->pot.size(); ++i)
+        if(pp[i] < POT_HIGH)
+          max_pot = std::max(max_pot, pp[i]);
+
+      PotentialGrid& grid = potential_grid_;
+      grid.header.frame_id = global_frame_;
+      grid.header.stamp = stamp;
+      grid.info.resolution = res;
+      grid.info.width = field->nx;
+      grid.info.height = field->ny;
+      grid.info.origin.position.x = ox;
+      grid.info.origin.position.y = oy;
+      grid.info.origin.orientation.w = 1.0;
+      grid.scale = max_pot > 0.0 ? max_pot / 65534.0 : 1.0;
+      grid.data.resize(field->pot.size());
+
+      float inv = 1.0 / grid.scale;
+      for(size_t i = 0; i < field->pot.size(); ++i)
+        grid.data[i] = pp[i] < POT_HIGH ? (uint16_t)(pp[i] * inv + 0.5f) : 65535;
+      potential_grid_pub_.publish(grid);
+      recyclePotential(field);
+      return;
+    }
+
+    //legacy point cloud, one point per reached cell
+    pcl::PointCloud<PotarrPoint>& pot_area = potential_cloud_;
+    pot_area.points.clear();
+    pot_area.header.frame_id = global_frame_;
+    std_msgs::Header header;
+    pcl_conversions::fromPCL(pot_area.header, header);
+    header.stamp = stamp;
+    pot_area.header = pcl_conversions::toPCL(header);
+
+    PotarrPoint pt;
+    float z_scale = 20.0 / start_pot;
+    for(int y = 0; y < field->ny; ++y){
+      const float *row = pp + y * field->nx;
+      for(int x = 0; x < field->nx; ++x){
+        if(row[x] < 10e7){
+          pt.x = ox + x * res;
+          pt.y = oy + y * res;
+          pt.z = row[x] * z_scale;
+          pt.pot_value = row[x];
+          pot_area.push_back(pt);
+        }
+      }
+    }
+    potarr_pub_.publish(pot_area);
+    recyclePotential(field);
+  }
+
+  void NavfnROS::recyclePotential(const boost::shared_ptr<PotentialField>& field){
+    boost::mutex::scoped_lock lock(potential_viz_mutex_);
+    spare_viz_field_ = field;
+  }
+
+  void NavfnROS::publishDiagnostics(const ros::TimerEvent& event){
+    diagnostic_msgs::DiagnosticArray array;
+    array.header.stamp = ros::Time::now();
+    array.status.resize(1);
+    diagnostic_msgs::DiagnosticStatus& status = array.status[0];
+    status.name = diagnostics_name_;
+    status.hardware_id = "none";
+    status.level = diagnostic_msgs::DiagnosticStatus::OK;
+    {
+      boost::mutex::scoped_lock lock(stats_mutex_);
+      plan_stats_.summarize(status);
+      plan_stats_.reset();
+    }
+    status.message = status.values[0].value + " plans";
+    {
+      //and one status per engine that planned in this period, to compare engines side by side
+      boost::mutex::scoped_lock lock(stats_mutex_);
+      for(std::map<std::string, PlanStatsAggregator>::iterator it = engine_stats_.begin(); it != engine_stats_.end(); ++it){
+        if(it->second.plans() == 0)
+          continue;
+        array.status.push_back(diagnostic_msgs::DiagnosticStatus());
+        diagnostic_msgs::DiagnosticStatus& engine_status = array.status.back();
+        engine_status.name = diagnostics_name_ + " (" + it->first + ")";
+        engine_status.hardware_id = "none";
+        engine_status.level = diagnostic_msgs::DiagnosticStatus::OK;
+        it->second.summarize(engine_status);
+        it->second.reset();
+        engine_status.message = engine_status.values[0].value + " plans";
+      }
+    }
+    publish_queue_->publish(diagnostics_pub_, array, true);
+  }
+
+  bool NavfnROS::dumpTraceService(std_srvs::Empty::Request& req, std_srvs::Empty::Response& resp){
+    if(!Tracer::instance().dump(trace_file_)){
+      ROS_ERROR("Could not write the planner trace to %s", trace_file_.c_str());
+      return false;
+    }
+    ROS_INFO("Wrote the planner trace to %s", trace_file_.c_str());
+    return true;
+  }
+
+  void NavfnROS::checkTraceSignal(const ros::TimerEvent& event){
+    if(!trace_dump_requested)
+      return;
+    trace_dump_requested = 0;
+    std_srvs::Empty::Request req;
+    std_srvs::Empty::Response resp;
+    dumpTraceService(req, resp);
+  }
+
+  void NavfnROS::publishSubgoals(){
+    geometry_msgs::PoseArray subgoals = v_subgoals_;
+    publish_queue_->publish(subgoal_pub_, subgoals, false);
+  }
+
   void NavfnROS::mapToWorld(double mx, double my, double& wx, double& wy) {
     wx = costmap_->getOriginX() + mx * costmap_->getResolution();
     wy = costmap_->getOriginY() + my * costmap_->getResolution();
@@ -230,7 +616,36 @@ namespace navfn {
   }*/
 
   bool NavfnROS::makePlan(const geometry_msgs::PoseStamped& start, const geometry_msgs::PoseStamped& goal, double tolerance, std::vector<geometry_msgs::PoseStamped>& plan){
-    boost::mutex::scoped_lock lock(mutex_);
+    PlanStats stats;
+    return makePlan(start, goal, tolerance, plan, stats);
+  }
+
+  bool NavfnROS::makePlan(const geometry_msgs::PoseStamped& start, const geometry_msgs::PoseStamped& goal, double tolerance,
+      std::vector<geometry_msgs::PoseStamped>& plan, PlanStats& stats){
+    TraceScope trace("makePlan");
+    ros::WallTime begin = ros::WallTime::now();
+    stats = PlanStats();
+    bool found = planRequest(start, goal, tolerance, plan, stats);
+
+    stats.total = (ros::WallTime::now() - begin).toSec();
+    stats.found = found;
+    stats.path_len = plan.size();
+    if(initialized_){
+      boost::mutex::scoped_lock lock(stats_mutex_);
+      plan_stats_.record(stats);
+      if(stats.engine)
+        engine_stats_[stats.engine].record(stats);
+    }
+    return found;
+  }
+
+  bool NavfnROS::planRequest(const geometry_msgs::PoseStamped& start, const geometry_msgs::PoseStamped& goal, double tolerance,
+      std::vector<geometry_msgs::PoseStamped>& plan, PlanStats& stats){
+    //without a pool all requests share planner_ and run one at a time
+    boost::mutex::scoped_lock lock(mutex_, boost::defer_lock);
+    if(!planner_pool_)
+      lock.lock();
+
     if(!initialized_){
       ROS_ERROR("This planner has not been initialized yet, but it is being used, please call initialize() before use");
       return false;
@@ -240,223 +655,329 @@ namespace navfn {
     //clear the plan, just in case
     plan.clear();
 
-    ros::NodeHandle n;
+    //until tf can handle transforming things that are way in the past... we'll require the goal to be in our global frame
+    if(tf::resolve(tf_prefix_, goal.header.frame_id) != tf::resolve(tf_prefix_, global_frame_)){
+      ROS_ERROR("The goal pose passed to this planner must be in the %s frame.  It is instead in the %s frame.", 
+                tf::resolve(tf_prefix_, global_frame_).c_str(), tf::resolve(tf_prefix_, goal.header.frame_id).c_str());
+      return false;
+    }
+
+    if(tf::resolve(tf_prefix_, start.header.frame_id) != tf::resolve(tf_prefix_, global_frame_)){
+      ROS_ERROR("The start pose passed to this planner must be in the %s frame.  It is instead in the %s frame.", 
+                tf::resolve(tf_prefix_, global_frame_).c_str(), tf::resolve(tf_prefix_, start.header.frame_id).c_str());
+      return false;
+    }
+
+    boost::shared_ptr<NavFn> planner = leasePlanner();
+    if(!planner){
+      ROS_ERROR("No planner became available for this request, giving up");
+      return false;
+    }
 
     double wx = start.pose.position.x;
     double wy = start.pose.position.y;
 
-    double wx_curr = start.pose.position.x;
-    double wy_curr = start.pose.position.y;
-    geometry_msgs::PoseArray test;
     geometry_msgs::PoseStamped subgoal = goal;  // This overriden by the vector's poses to get the correct header.
-    geometry_msgs::PoseStamped substart = start; // this will be the start for the next subgoal or the goal
+    std::vector<geometry_msgs::Pose> route; // subgoals still ahead of the robot, starting with the one planned to
 
-    std::vector<geometry_msgs::Pose>::iterator it;
-    for(it = v_subgoals_.poses.begin(); it != v_subgoals_.poses.end(); )
+    while(true)
     {
-      ROS_INFO_STREAM("pose x: " << (*it).position.x << " y: "<< (*it).position.y);
-
-      if(fabs(std::sqrt(pow((*it).position.x - wx,2)+pow((*it).position.y - wy,2))) < subgoal_tolerance_) // If within goal tolerance (meters).
-      {
-        it = v_subgoals_.poses.erase(it); // returns next element
-        subgoal_pub_.publish(v_subgoals_);
-        continue;
-      }
-      else
       {
-        subgoal.pose = *it; // set first reachable goal
-        if(makePlanSubgoal(substart, subgoal, 0, plan))
+        boost::mutex::scoped_lock subgoal_lock(subgoal_mutex_);
+        //drop the subgoals the robot has already reached
+        while(!v_subgoals_.poses.empty())
         {
-         substart.pose = *it; // set goal as new start position
-         ROS_INFO("Succesfully calculated path to subgoal, length %d", plan.size());
-         break; // done calculating
-        }
-        else
-        {
-         ROS_ERROR("Failed to compute plan for subgoal"); // will try to use previous point as reference for the next goal
-         // will try for next goal instead
-         it = v_subgoals_.poses.erase(it); // returns next element
-         subgoal_pub_.publish(v_subgoals_);
+          const geometry_msgs::Pose& next = v_subgoals_.poses.front();
+          ROS_INFO_STREAM("pose x: " << next.position.x << " y: "<< next.position.y);
+          if(std::sqrt(pow(next.position.x - wx,2)+pow(next.position.y - wy,2)) >= subgoal_tolerance_) // If within goal tolerance (meters).
+            break;
+          v_subgoals_.poses.erase(v_subgoals_.poses.begin());
+          publishSubgoals();
         }
+        if(v_subgoals_.poses.empty())
+          break;
+        subgoal.pose = v_subgoals_.poses.front(); // set first reachable goal
       }
 
-    }
+      if(planLeg(*planner, start, subgoal, 0, plan, stats))
+      {
+        ROS_INFO("Succesfully calculated path to subgoal, length %d", plan.size());
+        boost::mutex::scoped_lock subgoal_lock(subgoal_mutex_);
+        route.push_back(subgoal.pose);
+        for(unsigned int i = 1; i < v_subgoals_.poses.size(); ++i)
+          route.push_back(v_subgoals_.poses[i]);
+        break; // done calculating
+      }
 
-    //until tf can handle transforming things that are way in the past... we'll require the goal to be in our global frame
-    if(tf::resolve(tf_prefix_, goal.header.frame_id) != tf::resolve(tf_prefix_, global_frame_)){
-      ROS_ERROR("The goal pose passed to this planner must be in the %s frame.  It is instead in the %s frame.", 
-                tf::resolve(tf_prefix_, global_frame_).c_str(), tf::resolve(tf_prefix_, goal.header.frame_id).c_str());
-      return false;
+      ROS_ERROR("Failed to compute plan for subgoal"); // will try for next goal instead
+      boost::mutex::scoped_lock subgoal_lock(subgoal_mutex_);
+      if(!v_subgoals_.poses.empty() &&
+          v_subgoals_.poses.front().position.x == subgoal.pose.position.x &&
+          v_subgoals_.poses.front().position.y == subgoal.pose.position.y)
+      {
+        v_subgoals_.poses.erase(v_subgoals_.poses.begin());
+        publishSubgoals();
+      }
     }
 
-    if(tf::resolve(tf_prefix_, start.header.frame_id) != tf::resolve(tf_prefix_, global_frame_)){
-      ROS_ERROR("The start pose passed to this planner must be in the %s frame.  It is instead in the %s frame.", 
-                tf::resolve(tf_prefix_, global_frame_).c_str(), tf::resolve(tf_prefix_, start.header.frame_id).c_str());
-      return false;
+    //a leg to the next subgoal has been planned, the legs after it don't depend on the robot position
+    if(!route.empty()){
+      uint64_t t = Tracer::now();
+      if(segment_cache_){
+        route.push_back(goal.pose);
+        segment_cache_->request(route);
+        appendCachedSegments(route, plan);
+      }
+      stats.build += lap(t, "build");
+
+      //publish the plan for visualization purposes
+      publishPlan(plan, 0.0, 1.0, 0.0, 0.0);
+      stats.publish += lap(t, "publish");
+      return !plan.empty();
     }
 
-     wx = substart.pose.position.x;
-     wy = substart.pose.position.y;
+    if(planLeg(*planner, start, goal, tolerance, plan, stats))
+      ROS_INFO("Succesfully calculated path to goal, length %d", plan.size());
 
-    unsigned int mx, my;
-    if(!costmap_->worldToMap(wx, wy, mx, my)){
-      ROS_WARN("The robot's start position is off the global costmap. Planning will always fail, are you sure the robot has been properly localized?");
+    //publish the plan for visualization purposes
+    uint64_t t = Tracer::now();
+    publishPlan(plan, 0.0, 1.0, 0.0, 0.0);
+    stats.publish += lap(t, "publish");
+    return !plan.empty();
+  }
+
+  bool NavfnROS::makePlanSubgoal(const geometry_msgs::PoseStamped& start,
+      const geometry_msgs::PoseStamped& goal, double tolerance, std::vector<geometry_msgs::PoseStamped>& plan){
+    ROS_DEBUG("entering makePlanSubgoal");
+
+    //without a pool this plans on planner_, like makePlan
+    boost::mutex::scoped_lock lock(mutex_, boost::defer_lock);
+    if(!planner_pool_)
+      lock.lock();
+
+    boost::shared_ptr<NavFn> planner = leasePlanner();
+    if(!planner){
+      ROS_ERROR("No planner became available for this request, giving up");
       return false;
     }
+    PlanStats stats;
+    return planLeg(*planner, start, goal, tolerance, plan, stats);
+  }
 
-    //clear the starting cell within the costmap because we know it can't be an obstacle
-    tf::Stamped<tf::Pose> start_pose;
-    tf::poseStampedMsgToTF(substart, start_pose);
-    clearRobotCell(start_pose, mx, my);
+  boost::shared_ptr<NavFn> NavfnROS::leasePlanner(){
+    if(planner_pool_)
+      return planner_pool_->acquire();
+    return planner_;
+  }
 
-    //make sure to resize the underlying array that Navfn uses
-    planner_->setNavArr(costmap_->getSizeInCellsX(), costmap_->getSizeInCellsY());
-    planner_->setCostmap(costmap_->getCharMap(), true, allow_unknown_);
+  boost::shared_ptr<const CostSnapshot> NavfnROS::getCostSnapshot(){
+    boost::mutex::scoped_lock lock(snapshot_mutex_);
+    //the costmap's own updates, and the robot cell other requests clear, write it meanwhile
+    boost::unique_lock<costmap_2d::Costmap2D::mutex_t> costmap_lock(*(costmap_->getMutex()));
+
+    int nx = costmap_->getSizeInCellsX();
+    int ny = costmap_->getSizeInCellsY();
+    ros::WallTime now = ros::WallTime::now();
+    if(cost_snapshot_ && cost_snapshot_->nx == nx && cost_snapshot_->ny == ny &&
+        (now - snapshot_time_).toSec() <= snapshot_max_age_)
+      return cost_snapshot_;
+
+    //translate once for all the planners of the pool, requests still using the old snapshot keep it alive
+    if(shared_costmap_cache_){
+      cost_snapshot_ = CostTranslationCache::instance().get(shared_costmap_id_, map_version_, costmap_->getCharMap(),
+          nx, ny, allow_unknown_);
+      snapshot_time_ = now;
+      return cost_snapshot_;
+    }
 
-    int map_start[2];
-    map_start[0] = mx;
-    map_start[1] = my;
+    boost::shared_ptr<CostSnapshot> snapshot(new CostSnapshot);
+    snapshot->nx = nx;
+    snapshot->ny = ny;
+    snapshot->costs.resize(nx * ny);
+    if(!snapshot->costs.empty()){
+      NavFn::translateCostmap(costmap_->getCharMap(), &snapshot->costs[0], nx, ny, true, allow_unknown_);
+      NavFn::setObsBorder(&snapshot->costs[0], nx, ny);
+    }
 
-    wx = goal.pose.position.x;
-    wy = goal.pose.position.y;
+    cost_snapshot_ = snapshot;
+    snapshot_time_ = now;
+    return cost_snapshot_;
+  }
 
-    if(!costmap_->worldToMap(wx, wy, mx, my)){
-      if(tolerance <= 0.0){
-        ROS_WARN_THROTTLE(1.0, "The goal sent to the navfn planner is off the global costmap. Planning will always fail to this goal.");
-        return false;
-      }
-      mx = 0;
-      my = 0;
+  void NavfnROS::costmapRegionUpdated(unsigned int x0, unsigned int y0, unsigned int width, unsigned int height){
+    if(!initialized_){
+      ROS_ERROR("This planner has not been initialized yet, but it is being used, please call initialize() before use");
+      return;
     }
 
-    int map_goal[2];
-    map_goal[0] = mx;
-    map_goal[1] = my;
+    //the pool and the costmap view read the costmap itself
+    if(planner_pool_ || costmap_view_)
+      return;
 
-    planner_->setStart(map_goal);
-    planner_->setGoal(map_start);
-    // No idea why they decide to flip goal and start but my guess is that Dijkstra solves from goal to current position.
+    boost::mutex::scoped_lock lock(mutex_);
+    boost::unique_lock<costmap_2d::Costmap2D::mutex_t> costmap_lock(*(costmap_->getMutex()));
+    int nx = costmap_->getSizeInCellsX(), ny = costmap_->getSizeInCellsY();
+    if(!streamed_costs_ || planner_->nx != nx || planner_->ny != ny){
+      if(planner_->nx != nx || planner_->ny != ny)
+        planner_->setNavArr(nx, ny);
+      planner_->setCostmap(costmap_->getCharMap(), true, allow_unknown_);
+      streamed_costs_ = true;
+      return;
+    }
+    planner_->translateRegion(costmap_->getCharMap(), x0, y0, x0 + width, y0 + height, allow_unknown_);
+  }
 
-    planner_->calcNavFnDijkstra(true);
+  void NavfnROS::stampDynamicObstacles(NavFn& planner){
+    planner.clearOverlay();
 
-    double resolution = costmap_->getResolution();
-    geometry_msgs::PoseStamped p, best_pose;
-    p = goal;
-
-    bool found_legal = false;
-    double best_sdist = DBL_MAX;
-
-    p.pose.position.y = goal.pose.position.y - tolerance;
-
-    while(p.pose.position.y <= goal.pose.position.y + tolerance){
-      p.pose.position.x = goal.pose.position.x - tolerance;
-      while(p.pose.position.x <= goal.pose.position.x + tolerance){
-        double potential = getPointPotential(p.pose.position);
-        double sdist = sq_distance(p, goal);
-        if(potential < POT_HIGH && sdist < best_sdist){
-          best_sdist = sdist;
-          best_pose = p;
-          found_legal = true;
-        }
-        p.pose.position.x += resolution;
-      }
-      p.pose.position.y += resolution;
-    }
-    if( it == v_subgoals_.poses.end()) // if subgoals are done
+    std::vector<int> cells;
     {
-      if(found_legal){
-        //extract the plan
-        std::vector<geometry_msgs::PoseStamped> plan_to_goal;
-        if(getPlanFromPotential(best_pose, plan_to_goal)){
-          //make sure the goal we push on has the same timestamp as the rest of the plan
-          geometry_msgs::PoseStamped goal_copy = best_pose;
-          goal_copy.header.stamp = ros::Time::now();
-          ROS_INFO("Succesfully calculated path to goal, length %d", plan_to_goal.size());
-          //plan.reserve( plan.size() + plan_to_goal.size() ); // preallocate memory
-          plan.insert( plan.end(), plan_to_goal.begin(), plan_to_goal.end() ); // combines plans
-          plan.push_back(goal_copy);
-        }
-        else{
-          ROS_ERROR("Failed to get a plan from potential when a legal potential was found. This shouldn't happen.");
-        }
-      }
-
-      if (visualize_potential_){
-        //publish potential array
-        pcl::PointCloud<PotarrPoint> pot_area;
-        pot_area.header.frame_id = global_frame_;
-        pot_area.points.clear();
-        std_msgs::Header header;
-        pcl_conversions::fromPCL(pot_area.header, header);
-        header.stamp = ros::Time::now();
-        pot_area.header = pcl_conversions::toPCL(header);
-
-        PotarrPoint pt;
-        float *pp = planner_->potarr;
-        double pot_x, pot_y;
-        for (unsigned int i = 0; i < (unsigned int)planner_->ny*planner_->nx ; i++)
-        {
-          if (pp[i] < 10e7)
-          {
-            mapToWorld(i%planner_->nx, i/planner_->nx, pot_x, pot_y);
-            pt.x = pot_x;
-            pt.y = pot_y;
-            pt.z = pp[i]/pp[planner_->start[1]*planner_->nx + planner_->start[0]]*20;
-            pt.pot_value = pp[i];
-            pot_area.push_back(pt);
+      boost::mutex::scoped_lock lock(dynamic_mutex_);
+      if(dynamic_obstacles_.empty())
+        return;
+
+      double resolution = costmap_->getResolution();
+      int r = (int)ceil(dynamic_obstacle_radius_ / resolution);
+      double r2 = dynamic_obstacle_radius_ * dynamic_obstacle_radius_;
+      for(unsigned int i = 0; i < dynamic_obstacles_.size(); ++i){
+        int cx, cy;
+        costmap_->worldToMapNoBounds(dynamic_obstacles_[i].position.x, dynamic_obstacles_[i].position.y, cx, cy);
+        for(int y = std::max(cy - r, 0); y <= std::min(cy + r, planner.ny - 1); ++y){
+          for(int x = std::max(cx - r, 0); x <= std::min(cx + r, planner.nx - 1); ++x){
+            double dx = (x - cx) * resolution, dy = (y - cy) * resolution;
+            if(dx * dx + dy * dy <= r2)
+              cells.push_back(y * planner.nx + x);
           }
         }
-        potarr_pub_.publish(pot_area);
       }
+    }
 
-      //publish the plan for visualization purposes
-      publishPlan(plan, 0.0, 1.0, 0.0, 0.0);
-      return !plan.empty();
+    if(!cells.empty()){
+      std::vector<COSTTYPE> costs(cells.size(), COST_OBS);
+      planner.stampOverlay(&cells[0], &costs[0], cells.size());
     }
-    return !plan.empty();
   }
-  bool NavfnROS::makePlanSubgoal(const geometry_msgs::PoseStamped& start,
-      const geometry_msgs::PoseStamped& goal, double tolerance, std::vector<geometry_msgs::PoseStamped>& plan){
 
-    ROS_DEBUG("entering makePlanSubgoal");
+  void NavfnROS::dynamicObstaclesCallback(const geometry_msgs::PoseArray::ConstPtr& obstacles){
+    if(!initialized_)
+      return;
 
-    //clear the plan, just in case
-    plan.clear();
+    if(tf::resolve(tf_prefix_, obstacles->header.frame_id) != tf::resolve(tf_prefix_, global_frame_)){
+      ROS_WARN_THROTTLE(1.0, "Dynamic obstacles must be in the %s frame, not %s, ignoring them",
+          tf::resolve(tf_prefix_, global_frame_).c_str(), tf::resolve(tf_prefix_, obstacles->header.frame_id).c_str());
+      return;
+    }
 
-    ros::NodeHandle n; // probably remove this
-    double wx = start.pose.position.x;
-    double wy = start.pose.position.y;
+    boost::mutex::scoped_lock lock(dynamic_mutex_);
+    dynamic_obstacles_ = obstacles->poses;
+  }
 
-    /* we let the normal makePlan loop handle the frame issues as these header names are passed over from there
-     //until tf can handle transforming things that are way in the past... we'll require the goal to be in our global frame
-    if(tf::resolve(tf_prefix_, goal.header.frame_id) != tf::resolve(tf_prefix_, global_frame_)){
-      ROS_ERROR("The goal pose passed to this planner must be in the %s frame.  It is instead in the %s frame.",
-                tf::resolve(tf_prefix_, global_frame_).c_str(), tf::resolve(tf_prefix_, goal.header.frame_id).c_str());
+  void NavfnROS::mapMetaDataCallback(const nav_msgs::MapMetaData::ConstPtr& info){
+    map_version_ = info->map_load_time.toNSec();
+  }
+
+  bool NavfnROS::loadCostmap(NavFn& planner, boost::shared_ptr<const CostSnapshot>& snapshot,
+      boost::unique_lock<costmap_2d::Costmap2D::mutex_t>& costmap_lock){
+    planner.denseGrad = dense_gradient_;
+
+    if(!planner_pool_ && costmap_view_){
+      //the view reads the costmap while planning, so it can't be updated until we're done
+      costmap_lock.lock();
+      int nx = costmap_->getSizeInCellsX(), ny = costmap_->getSizeInCellsY();
+      if(planner.nx != nx || planner.ny != ny)
+        planner.setNavArr(nx, ny);
+      planner.setCostmapView(costmap_->getCharMap(), allow_unknown_);
       return false;
     }
 
-    if(tf::resolve(tf_prefix_, start.header.frame_id) != tf::resolve(tf_prefix_, global_frame_)){
-      ROS_ERROR("The start pose passed to this planner must be in the %s frame.  It is instead in the %s frame.",
-                tf::resolve(tf_prefix_, global_frame_).c_str(), tf::resolve(tf_prefix_, start.header.frame_id).c_str());
+    if(!planner_pool_ && streamed_costs_ && planner.nx == (int)costmap_->getSizeInCellsX() &&
+        planner.ny == (int)costmap_->getSizeInCellsY())
+      return true; //already up to date, see costmapRegionUpdated()
+
+    if(!planner_pool_ && shared_costmap_cache_){
+      int nx = costmap_->getSizeInCellsX(), ny = costmap_->getSizeInCellsY();
+      snapshot = CostTranslationCache::instance().get(shared_costmap_id_, map_version_, costmap_->getCharMap(),
+          nx, ny, allow_unknown_);
+      if(planner.nx != nx || planner.ny != ny)
+        planner.setNavArr(nx, ny);
+      if(!snapshot->costs.empty())
+        planner.setCostArr(&snapshot->costs[0]);
+      //planner_ is read after this leg too, by extractPlan, the potential queries and savemap
+      planner_costs_ = snapshot;
       return false;
-    }*/
+    }
 
+    if(!planner_pool_ && static_costmap_){
+      int nx = costmap_->getSizeInCellsX(), ny = costmap_->getSizeInCellsY();
+      if(planner.nx != nx || planner.ny != ny || !static_loaded_){
+        if(planner.nx != nx || planner.ny != ny)
+          planner.setNavArr(nx, ny);
+        planner.setCostmap(costmap_->getCharMap(), true, allow_unknown_);
+        static_loaded_ = true;
+        return false;
+      }
+      return true;
+    }
 
+    if(!planner_pool_ && incremental_costmap_){
+      int nx = costmap_->getSizeInCellsX(), ny = costmap_->getSizeInCellsY();
+      if(planner.nx != nx || planner.ny != ny)
+        planner.setNavArr(nx, ny);
+      int dirty = planner.updateCostmap(costmap_->getCharMap(), allow_unknown_);
+      ROS_DEBUG("Translated %d of %d costmap tiles", dirty, planner.tilesX * planner.tilesY);
+      return false;
+    }
+
+    if(!planner_pool_){
+      //make sure to resize the underlying array that Navfn uses
+      planner.setNavArr(costmap_->getSizeInCellsX(), costmap_->getSizeInCellsY());
+      planner.setCostmap(costmap_->getCharMap(), true, allow_unknown_);
+      return false;
+    }
+
+    snapshot = getCostSnapshot();
+    if(planner.nx != snapshot->nx || planner.ny != snapshot->ny)
+      planner.setNavArr(snapshot->nx, snapshot->ny);
+    if(!snapshot->costs.empty())
+      planner.setCostArr(&snapshot->costs[0]);
+    return false;
+  }
+
+  bool NavfnROS::planLeg(NavFn& planner, const geometry_msgs::PoseStamped& start,
+      const geometry_msgs::PoseStamped& goal, double tolerance, std::vector<geometry_msgs::PoseStamped>& plan,
+      PlanStats& stats){
+    TraceScope trace("planLeg");
+    uint64_t leg_begin = Tracer::now();
+    //clear the plan, just in case
+    plan.clear();
+
+    double wx = start.pose.position.x;
+    double wy = start.pose.position.y;
 
     unsigned int mx, my;
     if(!costmap_->worldToMap(wx, wy, mx, my)){
-      ROS_WARN("The robot's sub_goal start position is off the global costmap. Planning will always fail, are you sure the robot has been properly localized?");
+      ROS_WARN("The robot's start position is off the global costmap. Planning will always fail, are you sure the robot has been properly localized?");
       return false;
     }
 
-    //clear the starting cell within the costmap because we know it can't be an obstacle
+    //clear the starting cell within the costmap because we know it can't be an obstacle, a shared translation
+    //would keep it cleared for every other robot, so it gets the cell cleared on top instead
     tf::Stamped<tf::Pose> start_pose;
     tf::poseStampedMsgToTF(start, start_pose);
-    clearRobotCell(start_pose, mx, my);
-
-    //make sure to resize the underlying array that Navfn uses
-    planner_->setNavArr(costmap_->getSizeInCellsX(), costmap_->getSizeInCellsY());
-    planner_->setCostmap(costmap_->getCharMap(), true, allow_unknown_);
+    if(!shared_costmap_cache_)
+      clearRobotCell(start_pose, mx, my);
+
+    //a shared snapshot has to stay alive for as long as the planner uses it, and a viewed costmap locked
+    boost::shared_ptr<const CostSnapshot> snapshot;
+    boost::unique_lock<costmap_2d::Costmap2D::mutex_t> costmap_lock(*(costmap_->getMutex()), boost::defer_lock);
+    uint64_t t = Tracer::now();
+    //costs kept from earlier plans haven't seen the cleared robot cell yet
+    if(loadCostmap(planner, snapshot, costmap_lock))
+      planner.translateRegion(costmap_->getCharMap(), mx, my, mx + 1, my + 1, allow_unknown_);
+    stampDynamicObstacles(planner);
+    if(shared_costmap_cache_)
+      planner.stampFree(my * planner.nx + mx);
+    stats.translate += lap(t, "translate");
 
     int map_start[2];
     map_start[0] = mx;
@@ -478,38 +999,57 @@ namespace navfn {
     map_goal[0] = mx;
     map_goal[1] = my;
 
-    planner_->setStart(map_goal);
-    planner_->setGoal(map_start);
-
-    planner_->calcNavFnDijkstra(true);
+    planner.setStart(map_goal);
+    planner.setGoal(map_start);
+    // No idea why they decide to flip goal and start but my guess is that Dijkstra solves from goal to current position.
 
+    //setup and propagation in timed phases, without a path from the goal cell, extractPlan follows the potential from best_pose
+    boost::shared_ptr<const PlannerEngine> engine = boost::atomic_load(&engine_);
+    lap(t, NULL);
+    planner.setupNavFn(true);
+    stats.setup += lap(t, "setupNavFn");
+    engine->propagate(planner);
+    if(&planner == planner_.get())
+      planner_potential_ = true;
+    stats.propagate += lap(t, NULL);
+    stats.engine = engine->name();
+    stats.cycles += planner.propCycles;
+    stats.cells += planner.propCells;
+    stats.max_buffer = std::max(stats.max_buffer, planner.propMaxBuf);
+
+    //the closest point to the goal within tolerance that the wavefront reached
     double resolution = costmap_->getResolution();
-    geometry_msgs::PoseStamped p, best_pose;
-    p = goal;
-
-    bool found_legal = false;
-    double best_sdist = DBL_MAX;
-
-    p.pose.position.y = goal.pose.position.y - tolerance;
-
-    while(p.pose.position.y <= goal.pose.position.y + tolerance){
-      p.pose.position.x = goal.pose.position.x - tolerance;
-      while(p.pose.position.x <= goal.pose.position.x + tolerance){
-        double potential = getPointPotential(p.pose.position);
-        double sdist = sq_distance(p, goal);
-        if(potential < POT_HIGH && sdist < best_sdist){
-          best_sdist = sdist;
-          best_pose = p;
-          found_legal = true;
-        }
-        p.pose.position.x += resolution;
-      }
-      p.pose.position.y += resolution;
+    geometry_msgs::PoseStamped best_pose = goal;
+    int goal_cell[2], best[2];
+    costmap_->worldToMapNoBounds(goal.pose.position.x, goal.pose.position.y, goal_cell[0], goal_cell[1]);
+    bool found_legal = planner.nearestReachable(goal_cell[0], goal_cell[1],
+        std::max(0, (int)(tolerance / resolution)), best);
+    if(found_legal){
+      best_pose.pose.position.x += (best[0] - goal_cell[0]) * resolution;
+      best_pose.pose.position.y += (best[1] - goal_cell[1]) * resolution;
+    }
+    stats.tolerance += lap(t, "tolerance");
+
+    if(potential_shm_){
+      PotentialInfo info;
+      info.nx = planner.nx;
+      info.ny = planner.ny;
+      info.resolution = resolution;
+      info.origin_x = costmap_->getOriginX();
+      info.origin_y = costmap_->getOriginY();
+      info.start[0] = planner.start[0];
+      info.start[1] = planner.start[1];
+      info.goal[0] = planner.goal[0];
+      info.goal[1] = planner.goal[1];
+      info.stamp = ros::Time::now().toNSec();
+      strncpy(info.frame_id, global_frame_.c_str(), sizeof(info.frame_id) - 1);
+      potential_shm_->publish(info, planner.potarr);
+      lap(t, "export");
     }
 
     if(found_legal){
       //extract the plan
-      if(getPlanFromPotential(best_pose, plan)){
+      if(extractPlan(planner, best_pose, plan, &stats)){
         //make sure the goal we push on has the same timestamp as the rest of the plan
         geometry_msgs::PoseStamped goal_copy = best_pose;
         goal_copy.header.stamp = ros::Time::now();
@@ -520,45 +1060,75 @@ namespace navfn {
       }
     }
 
-    if (visualize_potential_){
-      //publish potential array
-      pcl::PointCloud<PotarrPoint> pot_area;
-      pot_area.header.frame_id = global_frame_;
-      pot_area.points.clear();
-      std_msgs::Header header;
-      pcl_conversions::fromPCL(pot_area.header, header);
-      header.stamp = ros::Time::now();
-      pot_area.header = pcl_conversions::toPCL(header);
-
-      PotarrPoint pt;
-      float *pp = planner_->potarr;
-      double pot_x, pot_y;
-      for (unsigned int i = 0; i < (unsigned int)planner_->ny*planner_->nx ; i++)
-      {
-        if (pp[i] < 10e7)
-        {
-          mapToWorld(i%planner_->nx, i/planner_->nx, pot_x, pot_y);
-          pt.x = pot_x;
-          pt.y = pot_y;
-          pt.z = pp[i]/pp[planner_->start[1]*planner_->nx + planner_->start[0]]*20;
-          pt.pot_value = pp[i];
-          pot_area.push_back(pt);
-        }
-      }
-      potarr_pub_.publish(pot_area);
+    if(recorder_ && recorder_->wants((Tracer::now() - leg_begin) * 1e-9)){
+      SnapshotInfo info;
+      info.tolerance = tolerance;
+      info.resolution = resolution;
+      info.origin_x = costmap_->getOriginX();
+      info.origin_y = costmap_->getOriginY();
+      info.allow_unknown = allow_unknown_;
+      info.astar = strcmp(engine->name(), "astar") == 0;
+      recorder_->record(planner, info, publish_queue_.get());
+      lap(t, "record");
     }
 
-    //publish the plan for visualization purposes
-    //publishPlan(plan, 0.0, 1.0, 0.0, 0.0);
+    if(visualize_potential_){
+      lap(t, NULL);
+      publishPotential(planner);
+      stats.publish += lap(t, "publish");
+    }
 
     return !plan.empty();
   }
+
+  void NavfnROS::appendPose(double mx, double my, const ros::Time& stamp, std::vector<geometry_msgs::PoseStamped>& plan){
+    //convert the point to world coordinates
+    double world_x, world_y;
+    mapToWorld(mx, my, world_x, world_y);
+
+    geometry_msgs::PoseStamped pose;
+    pose.header.stamp = stamp;
+    pose.header.frame_id = global_frame_;
+    pose.pose.position.x = world_x;
+    pose.pose.position.y = world_y;
+    pose.pose.position.z = 0.0;
+    pose.pose.orientation.x = 0.0;
+    pose.pose.orientation.y = 0.0;
+    pose.pose.orientation.z = 0.0;
+    pose.pose.orientation.w = 1.0;
+    plan.push_back(pose);
+  }
+
+  void NavfnROS::appendCachedSegments(const std::vector<geometry_msgs::Pose>& route, std::vector<geometry_msgs::PoseStamped>& plan){
+    std::vector<float> x, y;
+    ros::Time plan_time = ros::Time::now();
+
+    for(unsigned int i = 0; i + 1 < route.size(); ++i){
+      if(!segment_cache_->lookup(route[i], route[i + 1], x, y)){
+        ROS_DEBUG("Leg %u of the subgoal route is not planned yet, plan ends at subgoal %u", i + 1, i);
+        return;
+      }
+
+      //the first point of a segment is the subgoal the plan already ends at
+      for(unsigned int j = 1; j < x.size(); ++j)
+        appendPose(x[j], y[j], plan_time, plan);
+
+      geometry_msgs::PoseStamped waypoint;
+      waypoint.header.stamp = plan_time;
+      waypoint.header.frame_id = global_frame_;
+      waypoint.pose = route[i + 1];
+      plan.push_back(waypoint);
+    }
+  }
+
   void NavfnROS::subgoalCallback(const geometry_msgs::PoseWithCovarianceStamped::ConstPtr &subgoal)
   {
-    boost::mutex::scoped_lock lock(mutex_);
+    boost::mutex::scoped_lock lock(subgoal_mutex_);
     v_subgoals_.poses.push_back(subgoal->pose.pose);
     ROS_INFO("Current number of subgoals %d", v_subgoals_.poses.size());
-    subgoal_pub_.publish(v_subgoals_);
+    if(segment_cache_)
+      segment_cache_->request(v_subgoals_.poses);
+    publishSubgoals();
   }
 
   void NavfnROS::publishPlan(const std::vector<geometry_msgs::PoseStamped>& path, double r, double g, double b, double a){
@@ -582,7 +1152,7 @@ namespace navfn {
       gui_path.poses[i] = path[i];
     }
 
-    plan_pub_.publish(gui_path);
+    publish_queue_->publish(plan_pub_, gui_path, false);
   }
 
   bool NavfnROS::getPlanFromPotential(const geometry_msgs::PoseStamped& goal, std::vector<geometry_msgs::PoseStamped>& plan){
@@ -591,6 +1161,40 @@ namespace navfn {
       return false;
     }
 
+    if(!hasPotential())
+      return false;
+
+    //a viewed costmap may have been reallocated since the potential was computed
+    boost::unique_lock<costmap_2d::Costmap2D::mutex_t> costmap_lock(*(costmap_->getMutex()), boost::defer_lock);
+    if(planner_->costview){
+      costmap_lock.lock();
+      if(planner_->nx != (int)costmap_->getSizeInCellsX() || planner_->ny != (int)costmap_->getSizeInCellsY()){
+        ROS_ERROR("The costmap was resized since the potential was computed, can't get a plan from it");
+        return false;
+      }
+      if(planner_->costarr != costmap_->getCharMap()){
+        //the dynamic obstacles the potential was computed with sit next to the view, the path keeps clear of them too
+        std::vector<int> cells(planner_->ovlCells, planner_->ovlCells + planner_->novl);
+        std::vector<COSTTYPE> costs(cells.size());
+        for(size_t i = 0; i < cells.size(); ++i)
+          costs[i] = planner_->ovlCosts[cells[i]];
+        planner_->setCostmapView(costmap_->getCharMap(), allow_unknown_);
+        if(!cells.empty())
+          planner_->stampOverlay(&cells[0], &costs[0], cells.size());
+      }
+    }
+
+    bool found = extractPlan(*planner_, goal, plan);
+    if(costmap_lock.owns_lock())
+      costmap_lock.unlock();
+
+    //publish the plan for visualization purposes
+    publishPlan(plan, 0.0, 1.0, 0.0, 0.0);
+    return found;
+  }
+
+  bool NavfnROS::extractPlan(NavFn& planner, const geometry_msgs::PoseStamped& goal, std::vector<geometry_msgs::PoseStamped>& plan,
+      PlanStats* stats){
     //clear the plan, just in case
     plan.clear();
 
@@ -615,36 +1219,28 @@ namespace navfn {
     map_goal[0] = mx;
     map_goal[1] = my;
 
-    planner_->setStart(map_goal);
+    planner.setStart(map_goal);
+
+    uint64_t t = Tracer::now();
+    planner.calcPath(costmap_->getSizeInCellsX() * 4);
 
-    planner_->calcPath(costmap_->getSizeInCellsX() * 4);
+    //shortcut and thin out the half-cell gradient steps before building poses from them
+    if(simplify_path_)
+      planner.simplifyPath(path_spacing_ / costmap_->getResolution());
+    if(stats)
+      stats->path += lap(t, "calcPath");
 
     //extract the plan
-    float *x = planner_->getPathX();
-    float *y = planner_->getPathY();
-    int len = planner_->getPathLen();
+    float *x = planner.getPathX();
+    float *y = planner.getPathY();
+    int len = planner.getPathLen();
     ros::Time plan_time = ros::Time::now();
 
-    for(int i = len - 1; i >= 0; --i){
-      //convert the plan to world coordinates
-      double world_x, world_y;
-      mapToWorld(x[i], y[i], world_x, world_y);
+    for(int i = len - 1; i >= 0; --i)
+      appendPose(x[i], y[i], plan_time, plan);
+    if(stats)
+      stats->build += lap(t, "build");
 
-      geometry_msgs::PoseStamped pose;
-      pose.header.stamp = plan_time;
-      pose.header.frame_id = global_frame_;
-      pose.pose.position.x = world_x;
-      pose.pose.position.y = world_y;
-      pose.pose.position.z = 0.0;
-      pose.pose.orientation.x = 0.0;
-      pose.pose.orientation.y = 0.0;
-      pose.pose.orientation.z = 0.0;
-      pose.pose.orientation.w = 1.0;
-      plan.push_back(pose);
-    }
-
-    //publish the plan for visualization purposes
-    publishPlan(plan, 0.0, 1.0, 0.0, 0.0);
     return !plan.empty();
   }
 };
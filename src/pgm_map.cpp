@@ -0,0 +1,168 @@
+/*********************************************************************
+*
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2008, Willow Garage, Inc.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*
+*********************************************************************/
+#include <navfn/pgm_map.h>
+#include <ctype.h>
+#include <algorithm>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace navfn {
+
+  namespace {
+    //skips whitespace and # comments, which may come between any two header fields
+    void skipSpace(const unsigned char* bytes, size_t size, size_t& pos){
+      while(pos < size){
+        if(bytes[pos] == '#'){
+          while(pos < size && bytes[pos] != '\n')
+            ++pos;
+        }
+        else if(isspace(bytes[pos]))
+          ++pos;
+        else
+          break;
+      }
+    }
+
+    bool readNumber(const unsigned char* bytes, size_t size, size_t& pos, int& value){
+      skipSpace(bytes, size, pos);
+      if(pos >= size || !isdigit(bytes[pos]))
+        return false;
+      long v = 0;
+      while(pos < size && isdigit(bytes[pos]) && v <= 0x7fffffff)
+        v = v * 10 + (bytes[pos++] - '0');
+      if(v > 0x7fffffff)
+        return false;
+      value = v;
+      return true;
+    }
+  }
+
+  PgmMap::PgmMap() : map_(NULL), map_size_(0), data_(NULL), width_(0), height_(0), maxval_(0) {}
+
+  PgmMap::~PgmMap(){
+    close();
+  }
+
+  bool PgmMap::open(const std::string& path){
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if(fd < 0)
+      return false;
+    struct stat st;
+    if(fstat(fd, &st) != 0 || st.st_size == 0){
+      ::close(fd);
+      return false;
+    }
+    void* map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if(map == MAP_FAILED)
+      return false;
+    map_ = map;
+    map_size_ = st.st_size;
+    if(!parse((const unsigned char*)map_, map_size_)){
+      close();
+      return false;
+    }
+    //a converted image doesn't need the file any more
+    if(!pixels_.empty()){
+      munmap(map_, map_size_);
+      map_ = NULL;
+      map_size_ = 0;
+    }
+    return true;
+  }
+
+  void PgmMap::close(){
+    if(map_)
+      munmap(map_, map_size_);
+    map_ = NULL;
+    map_size_ = 0;
+    data_ = NULL;
+    std::vector<unsigned char>().swap(pixels_);
+    width_ = height_ = maxval_ = 0;
+  }
+
+  bool PgmMap::parse(const unsigned char* bytes, size_t size){
+    if(size < 2 || bytes[0] != 'P' || (bytes[1] != '5' && bytes[1] != '2'))
+      return false;
+    bool binary = bytes[1] == '5';
+    size_t pos = 2;
+    int width, height, maxval;
+    if(!readNumber(bytes, size, pos, width) || !readNumber(bytes, size, pos, height) ||
+        !readNumber(bytes, size, pos, maxval) || width <= 0 || height <= 0 || maxval <= 0 || maxval > 65535)
+      return false;
+    size_t n = (size_t)width * height;
+
+    if(binary){
+      //exactly one whitespace character separates the header from the pixels
+      if(pos >= size || !isspace(bytes[pos]))
+        return false;
+      ++pos;
+      size_t depth = maxval < 256 ? 1 : 2;
+      if(size - pos < n * depth)
+        return false;
+      if(depth == 1)
+        data_ = bytes + pos;
+      else{
+        pixels_.resize(n);
+        for(size_t i = 0; i < n; ++i){
+          //wider samples are big endian
+          unsigned int v = (bytes[pos + 2*i] << 8) | bytes[pos + 2*i + 1];
+          pixels_[i] = (std::min(v, (unsigned int)maxval) * 255 + maxval / 2) / maxval;
+        }
+      }
+    }
+    else{
+      pixels_.resize(n);
+      for(size_t i = 0; i < n; ++i){
+        int v;
+        if(!readNumber(bytes, size, pos, v))
+          return false;
+        v = std::min(v, maxval);
+        pixels_[i] = maxval < 256 ? v : (v * 255 + maxval / 2) / maxval;
+      }
+    }
+    if(!pixels_.empty())
+      data_ = &pixels_[0];
+    width_ = width;
+    height_ = height;
+    maxval_ = maxval;
+    return true;
+  }
+
+};
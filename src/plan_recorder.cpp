@@ -0,0 +1,130 @@
+/*********************************************************************
+*
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2008, Willow Garage, Inc.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*
+*********************************************************************/
+#include <navfn/plan_recorder.h>
+#include <ros/console.h>
+#include <boost/bind.hpp>
+#include <algorithm>
+#include <dirent.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <vector>
+
+namespace navfn {
+
+  struct PlanRecorder::Recording {
+    SnapshotInfo info;
+    std::vector<unsigned char> raw_costs;
+    std::vector<COSTTYPE> costs;
+    std::vector<float> potential, pathx, pathy;
+  };
+
+  PlanRecorder::PlanRecorder(const std::string& directory, int ring, int every, double latency, int flags)
+    : directory_(directory), ring_(std::max(1, ring)), every_(std::max(0, every)), latency_(latency), flags_(flags),
+    plans_(0), slot_(0), recorded_(0) {
+      if(mkdir(directory_.c_str(), 0755) != 0 && errno != EEXIST)
+        ROS_ERROR("Could not create the plan recording directory %s: %s", directory_.c_str(), strerror(errno));
+
+      //carry on after the newest recording, so a restart doesn't overwrite what led up to it
+      DIR* dir = opendir(directory_.c_str());
+      if(!dir)
+        return;
+      time_t newest = 0;
+      struct dirent* entry;
+      while((entry = readdir(dir)) != NULL){
+        unsigned int slot;
+        struct stat st;
+        if(sscanf(entry->d_name, "plan_%u.navfn", &slot) != 1 || slot >= ring_)
+          continue;
+        if(stat((directory_ + "/" + entry->d_name).c_str(), &st) == 0 && st.st_mtime >= newest){
+          newest = st.st_mtime;
+          slot_ = slot + 1;
+        }
+      }
+      closedir(dir);
+  }
+
+  bool PlanRecorder::wants(double latency){
+    unsigned long n = ++plans_;
+    return (every_ > 0 && n % every_ == 0) || (latency_ > 0.0 && latency > latency_);
+  }
+
+  void PlanRecorder::record(const NavFn& planner, const SnapshotInfo& info, PublishQueue* queue){
+    boost::shared_ptr<Recording> rec(new Recording);
+    rec->info = info;
+    rec->info.nx = planner.nx;
+    rec->info.ny = planner.ny;
+    rec->info.start[0] = planner.start[0];
+    rec->info.start[1] = planner.start[1];
+    rec->info.goal[0] = planner.goal[0];
+    rec->info.goal[1] = planner.goal[1];
+    rec->info.pri_inc = planner.priInc;
+    rec->info.path_len = (flags_ & SNAPSHOT_PATH) ? planner.npath : 0;
+
+    //the planner is reused as soon as we return, so everything is copied; a view is the raw costmap itself, and
+    //its translated copy needs the obstacle border a replay can't add to borrowed costs
+    rec->costs.resize(planner.ns);
+    for(int i = 0; i < planner.ns; ++i)
+      rec->costs[i] = planner.cellCost(i);
+    NavFn::setObsBorder(&rec->costs[0], planner.nx, planner.ny);
+    if(planner.costview)
+      rec->raw_costs.assign(planner.costarr, planner.costarr + planner.ns);
+    if(flags_ & SNAPSHOT_POTENTIAL)
+      rec->potential.assign(planner.potarr, planner.potarr + planner.ns);
+    if(rec->info.path_len > 0){
+      rec->pathx.assign(planner.pathx, planner.pathx + planner.npath);
+      rec->pathy.assign(planner.pathy, planner.pathy + planner.npath);
+    }
+
+    if(queue)
+      queue->post(boost::bind(&PlanRecorder::write, this, rec), true);
+    else
+      write(rec);
+  }
+
+  void PlanRecorder::write(const boost::shared_ptr<Recording>& rec){
+    char name[32];
+    snprintf(name, sizeof(name), "plan_%04lu.navfn", slot_++ % ring_);
+    bool ok = PlanningSnapshot::save(directory_ + "/" + name, rec->info,
+        rec->raw_costs.empty() ? NULL : &rec->raw_costs[0], &rec->costs[0],
+        rec->potential.empty() ? NULL : &rec->potential[0],
+        rec->pathx.empty() ? NULL : &rec->pathx[0], rec->pathy.empty() ? NULL : &rec->pathy[0], flags_);
+    if(ok)
+      ++recorded_;
+  }
+
+};
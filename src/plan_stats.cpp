@@ -0,0 +1,168 @@
+/*********************************************************************
+*
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2008, Willow Garage, Inc.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*
+*********************************************************************/
+#include <navfn/plan_stats.h>
+#include <algorithm>
+#include <cmath>
+#include <stdio.h>
+
+// sub-buckets per power of two are 2^HIST_SUB_BITS, which bounds the relative error to 2^-HIST_SUB_BITS
+#define HIST_SUB_BITS 5
+#define HIST_SUB_COUNT (1 << HIST_SUB_BITS)
+// durations are recorded in microseconds and clamped below 2^HIST_MAX_BITS, about 12 days
+#define HIST_MAX_BITS 40
+
+namespace navfn {
+
+  LatencyHistogram::LatencyHistogram()
+    : counts_((HIST_MAX_BITS - HIST_SUB_BITS + 1) * HIST_SUB_COUNT, 0), count_(0), max_(0), sum_(0.0) {}
+
+  int LatencyHistogram::bucket(uint64_t usec){
+    if(usec < HIST_SUB_COUNT)
+      return (int)usec;
+    int msb = 63 - __builtin_clzll(usec);
+    int shift = msb - HIST_SUB_BITS;
+    return ((shift + 1) << HIST_SUB_BITS) + (int)((usec >> shift) - HIST_SUB_COUNT);
+  }
+
+  uint64_t LatencyHistogram::upperBound(int bucket){
+    if(bucket < HIST_SUB_COUNT)
+      return bucket;
+    int shift = (bucket >> HIST_SUB_BITS) - 1;
+    uint64_t base = HIST_SUB_COUNT + (bucket & (HIST_SUB_COUNT - 1));
+    return ((base + 1) << shift) - 1;
+  }
+
+  void LatencyHistogram::record(double seconds){
+    uint64_t usec = seconds > 0.0 ? (uint64_t)(seconds * 1e6 + 0.5) : 0;
+    usec = std::min(usec, ((uint64_t)1 << HIST_MAX_BITS) - 1);
+    counts_[bucket(usec)]++;
+    count_++;
+    max_ = std::max(max_, usec);
+    sum_ += usec;
+  }
+
+  double LatencyHistogram::percentile(double q) const {
+    if(count_ == 0)
+      return 0.0;
+    uint64_t rank = std::max((uint64_t)1, (uint64_t)std::ceil(std::min(1.0, std::max(0.0, q)) * count_));
+    uint64_t seen = 0;
+    for(unsigned int i = 0; i < counts_.size(); ++i){
+      seen += counts_[i];
+      //the bucket bound can lie above anything recorded, never report more than the maximum
+      if(seen >= rank)
+        return std::min(upperBound(i), max_) * 1e-6;
+    }
+    return max();
+  }
+
+  void LatencyHistogram::reset(){
+    std::fill(counts_.begin(), counts_.end(), 0);
+    count_ = 0;
+    max_ = 0;
+    sum_ = 0.0;
+  }
+
+  PlanStatsAggregator::PlanStatsAggregator(){
+    reset();
+  }
+
+  void PlanStatsAggregator::record(const PlanStats& stats){
+    phases_[TRANSLATE].record(stats.translate);
+    phases_[SETUP].record(stats.setup);
+    phases_[PROPAGATE].record(stats.propagate);
+    phases_[PATH].record(stats.path);
+    phases_[TOLERANCE].record(stats.tolerance);
+    phases_[BUILD].record(stats.build);
+    phases_[PUBLISH].record(stats.publish);
+    phases_[TOTAL].record(stats.total);
+    plans_++;
+    if(!stats.found)
+      failed_++;
+    cycles_ += stats.cycles;
+    cells_ += stats.cells;
+    max_buffer_ = std::max(max_buffer_, stats.max_buffer);
+  }
+
+  void PlanStatsAggregator::summarize(diagnostic_msgs::DiagnosticStatus& status) const {
+    static const char* names[NUM_PHASES] = { "translate", "setup", "propagate", "path", "tolerance", "build", "publish", "total" };
+    char buf[128];
+
+    status.values.clear();
+    diagnostic_msgs::KeyValue kv;
+    kv.key = "plans";
+    snprintf(buf, sizeof(buf), "%llu", (unsigned long long)plans_);
+    kv.value = buf;
+    status.values.push_back(kv);
+    kv.key = "failed plans";
+    snprintf(buf, sizeof(buf), "%llu", (unsigned long long)failed_);
+    kv.value = buf;
+    status.values.push_back(kv);
+
+    for(int i = 0; i < NUM_PHASES; ++i){
+      const LatencyHistogram& h = phases_[i];
+      kv.key = std::string(names[i]) + " p50/p90/p99/max (ms)";
+      snprintf(buf, sizeof(buf), "%.3f / %.3f / %.3f / %.3f", h.percentile(0.5) * 1e3, h.percentile(0.9) * 1e3,
+          h.percentile(0.99) * 1e3, h.max() * 1e3);
+      kv.value = buf;
+      status.values.push_back(kv);
+    }
+
+    double n = plans_ ? plans_ : 1;
+    kv.key = "propagation cycles (mean)";
+    snprintf(buf, sizeof(buf), "%.0f", cycles_ / n);
+    kv.value = buf;
+    status.values.push_back(kv);
+    kv.key = "cells visited (mean)";
+    snprintf(buf, sizeof(buf), "%.0f", cells_ / n);
+    kv.value = buf;
+    status.values.push_back(kv);
+    kv.key = "priority buffer (max)";
+    snprintf(buf, sizeof(buf), "%d", max_buffer_);
+    kv.value = buf;
+    status.values.push_back(kv);
+  }
+
+  void PlanStatsAggregator::reset(){
+    for(int i = 0; i < NUM_PHASES; ++i)
+      phases_[i].reset();
+    plans_ = 0;
+    failed_ = 0;
+    cycles_ = 0.0;
+    cells_ = 0.0;
+    max_buffer_ = 0;
+  }
+
+};
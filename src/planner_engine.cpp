@@ -0,0 +1,93 @@
+/*********************************************************************
+*
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2008, Willow Garage, Inc.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*
+*********************************************************************/
+#include <navfn/planner_engine.h>
+#include <navfn/trace.h>
+
+namespace navfn {
+
+  namespace {
+    class DijkstraEngine : public PlannerEngine {
+      public:
+        const char* name() const { return "dijkstra"; }
+
+        bool step(NavFn& planner, int cycles, bool resume) const {
+          TraceScope trace("propNavFnDijkstra");
+          return planner.propNavFnDijkstra(cycles, true);
+        }
+    };
+
+    class AstarEngine : public PlannerEngine {
+      public:
+        const char* name() const { return "astar"; }
+
+        bool step(NavFn& planner, int cycles, bool resume) const {
+          TraceScope trace("propNavFnAstar");
+          return planner.propNavFnAstar(cycles, resume);
+        }
+    };
+  }
+
+  EngineRegistry& EngineRegistry::instance(){
+    static EngineRegistry registry;
+    return registry;
+  }
+
+  EngineRegistry::EngineRegistry(){
+    add(boost::shared_ptr<const PlannerEngine>(new DijkstraEngine));
+    add(boost::shared_ptr<const PlannerEngine>(new AstarEngine));
+  }
+
+  void EngineRegistry::add(const boost::shared_ptr<const PlannerEngine>& engine){
+    boost::mutex::scoped_lock lock(mutex_);
+    engines_[engine->name()] = engine;
+  }
+
+  boost::shared_ptr<const PlannerEngine> EngineRegistry::get(const std::string& name) const {
+    boost::mutex::scoped_lock lock(mutex_);
+    std::map<std::string, boost::shared_ptr<const PlannerEngine> >::const_iterator it = engines_.find(name);
+    return it == engines_.end() ? boost::shared_ptr<const PlannerEngine>() : it->second;
+  }
+
+  std::vector<std::string> EngineRegistry::names() const {
+    boost::mutex::scoped_lock lock(mutex_);
+    std::vector<std::string> names;
+    for(std::map<std::string, boost::shared_ptr<const PlannerEngine> >::const_iterator it = engines_.begin();
+        it != engines_.end(); ++it)
+      names.push_back(it->first);
+    return names;
+  }
+
+};
@@ -0,0 +1,169 @@
+/*********************************************************************
+*
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2008, Willow Garage, Inc.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*
+*********************************************************************/
+#include <navfn/planning_session.h>
+#include <navfn/trace.h>
+#include <algorithm>
+#include <limits>
+
+// cycles in the first step of a plan, before any have been timed
+#define SESSION_FIRST_STEP 8
+// rows in the first chunk of setup, before any have been timed
+#define SESSION_FIRST_ROWS 16
+
+namespace navfn {
+
+  PlanningSession::PlanningSession(NavFn& planner, const boost::shared_ptr<const PlannerEngine>& engine)
+    : planner_(planner), engine_(engine ? engine : EngineRegistry::instance().get("dijkstra")), begun_(false),
+    propagated_(false), steps_(0), cycles_(0), cells_(0), max_buffer_(0), setup_row_(0), row_time_(0.0),
+    cycle_time_(0.0) {}
+
+  void PlanningSession::begin(){
+    planner_.setupNavFnBegin(true);
+    begun_ = true;
+    propagated_ = false;
+    steps_ = cycles_ = cells_ = max_buffer_ = 0;
+    setup_row_ = 0;
+  }
+
+  bool PlanningSession::setup(uint64_t deadline){
+    if(setup_row_ >= planner_.ny)
+      return true;
+
+    //chunks of rows, each sized to use half of what is left of the budget at the rate of the last one
+    TraceScope trace("setupNavFn");
+    for(bool ran = false; setup_row_ < planner_.ny; ran = true){
+      uint64_t now = Tracer::now();
+      if(ran && now >= deadline)
+        return false;
+      int rows = SESSION_FIRST_ROWS;
+      if(row_time_ > 0.0){
+        double left = (deadline > now ? deadline - now : 0) * 1e-9;
+        rows = (int)std::max(1.0, std::min(0.5 * left / row_time_, (double)planner_.ny));
+      }
+      rows = std::min(rows, planner_.ny - setup_row_);
+      planner_.setupNavFnRows(setup_row_, setup_row_ + rows);
+      setup_row_ += rows;
+      uint64_t after = Tracer::now();
+      row_time_ = std::max((after - now) * 1e-9 / rows, 1e-9);
+      if(after >= deadline && setup_row_ < planner_.ny)
+        return false;
+    }
+    planner_.setupNavFnEnd();
+    return true;
+  }
+
+  bool PlanningSession::startReached() const {
+    return planner_.potarr[planner_.start[1] * planner_.nx + planner_.start[0]] < POT_HIGH;
+  }
+
+  void PlanningSession::run(int cycles){
+    //the whole propagation gets the cycles it would get in one go
+    int left = PlannerEngine::maxCycles(planner_) - cycles_;
+    if(startReached() || left <= 0){
+      propagated_ = true;
+      return;
+    }
+    cycles = std::min(cycles, left);
+    propagated_ = engine_->step(planner_, cycles, cycles_ > 0);
+    cycles_ += planner_.propCycles;
+    cells_ += planner_.propCells;
+    max_buffer_ = std::max(max_buffer_, planner_.propMaxBuf);
+    if(planner_.propCycles == 0 || cycles_ >= PlannerEngine::maxCycles(planner_))
+      propagated_ = true;
+  }
+
+  bool PlanningSession::step(double budget){
+    if(!begun_)
+      begin();
+    if(propagated_)
+      return true;
+    ++steps_;
+
+    uint64_t begin = Tracer::now();
+    uint64_t deadline = begin + (uint64_t)(std::max(0.0, budget) * 1e9);
+    //a step that set up rows needn't propagate as well
+    bool setting_up = setup_row_ < planner_.ny;
+    if(!setup(deadline))
+      return false;
+
+    //run cycles in batches, each sized to use half of what is left of the budget at the rate seen so far, and at
+    //most twice the one before, as cycles grow more expensive while the wavefront widens
+    int batch = cycle_time_ > 0.0 ? 0 : SESSION_FIRST_STEP;
+    int last = SESSION_FIRST_STEP;
+    for(bool ran = setting_up; !propagated_; ran = true){
+      uint64_t now = Tracer::now();
+      if(ran && now >= deadline)
+        break;
+      if(batch == 0){
+        double left = (deadline > now ? deadline - now : 0) * 1e-9;
+        batch = std::max(1, std::min(2 * last, (int)std::min(0.5 * left / cycle_time_, 1e6)));
+      }
+      last = batch;
+      int before = cycles_;
+      run(batch);
+      uint64_t after = Tracer::now();
+      //a moving estimate, weighted towards the latest cycles
+      if(cycles_ > before){
+        double t = (after - now) * 1e-9 / (cycles_ - before);
+        cycle_time_ = cycle_time_ > 0.0 ? 0.5 * (cycle_time_ + t) : t;
+      }
+      batch = 0;
+      if(after >= deadline)
+        break;
+    }
+
+    planner_.propCycles = cycles_;
+    planner_.propCells = cells_;
+    planner_.propMaxBuf = max_buffer_;
+    return propagated_;
+  }
+
+  bool PlanningSession::finish(){
+    if(!begun_)
+      begin();
+    setup(std::numeric_limits<uint64_t>::max());
+    while(!propagated_)
+      run(PlannerEngine::maxCycles(planner_));
+    planner_.propCycles = cycles_;
+    planner_.propCells = cells_;
+    planner_.propMaxBuf = max_buffer_;
+
+    TraceScope trace("calcPath");
+    begun_ = false;
+    return planner_.calcPath(planner_.nx * planner_.ny / 2) > 0;
+  }
+
+};
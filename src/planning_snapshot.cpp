@@ -0,0 +1,365 @@
+/*********************************************************************
+*
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2008, Willow Garage, Inc.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*
+*********************************************************************/
+#include <navfn/planning_snapshot.h>
+#include <ros/console.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <lz4.h>
+
+// sections start on this boundary, so mapped arrays are aligned for any use
+#define SNAPSHOT_ALIGN 64
+#define SNAPSHOT_CODEC_RAW 0
+#define SNAPSHOT_CODEC_LZ4 1
+
+namespace navfn {
+
+  namespace {
+    const char snapshot_magic[8] = { 'N', 'A', 'V', 'F', 'N', 'S', 'N', 'P' };
+
+    struct FileHeader {
+      char magic[8];
+      uint32_t byte_order;   /**< 0x01020304 as written by the machine that wrote the file */
+      uint16_t major, minor;
+      uint32_t header_size;  /**< sizeof(FileHeader) when written, the section table follows */
+      uint32_t nsections;
+      SnapshotInfo info;
+    };
+
+    struct SectionData {
+      uint32_t type;
+      const void* data;
+      uint64_t size;
+    };
+
+    uint64_t align(uint64_t offset){
+      return (offset + SNAPSHOT_ALIGN - 1) & ~(uint64_t)(SNAPSHOT_ALIGN - 1);
+    }
+
+    bool pad(FILE* f, uint64_t& offset){
+      static const char zeros[SNAPSHOT_ALIGN] = { 0 };
+      uint64_t next = align(offset);
+      if(next != offset && fwrite(zeros, 1, next - offset, f) != next - offset)
+        return false;
+      offset = next;
+      return true;
+    }
+
+    //propagation never looks past the border, so without one it reads outside the arrays
+    bool hasObsBorder(const COSTTYPE* costs, int nx, int ny){
+      for(int i = 0; i < nx; ++i)
+        if(costs[i] < COST_OBS || costs[(ny - 1) * nx + i] < COST_OBS)
+          return false;
+      for(int i = 0; i < ny; ++i)
+        if(costs[i * nx] < COST_OBS || costs[i * nx + nx - 1] < COST_OBS)
+          return false;
+      return true;
+    }
+  }
+
+  PlanningSnapshot::PlanningSnapshot() : map_(NULL), map_size_(0), sections_(NULL), nsections_(0) {}
+
+  PlanningSnapshot::~PlanningSnapshot(){
+    close();
+  }
+
+  bool PlanningSnapshot::save(const std::string& path, const SnapshotInfo& info, const unsigned char* raw_costs,
+      const NavFn& planner, int flags){
+    SnapshotInfo problem = info;
+    problem.nx = planner.nx;
+    problem.ny = planner.ny;
+    problem.start[0] = planner.start[0];
+    problem.start[1] = planner.start[1];
+    problem.goal[0] = planner.goal[0];
+    problem.goal[1] = planner.goal[1];
+    problem.pri_inc = planner.priInc;
+    problem.path_len = (flags & SNAPSHOT_PATH) ? planner.npath : 0;
+
+    //a viewed costmap is stored translated, as the planner reads it, with any overlay on top of the borrowed costs,
+    //and with the obstacle border setupNavFn only gives the planner's own costs; the restored costs are borrowed,
+    //so they never get one
+    std::vector<COSTTYPE> translated;
+    const COSTTYPE* costs = planner.costarr;
+    if(planner.costview || planner.ovlSparse || !hasObsBorder(costs, planner.nx, planner.ny)){
+      translated.resize(planner.ns);
+      for(int i = 0; i < planner.ns; ++i)
+        translated[i] = planner.cellCost(i);
+      NavFn::setObsBorder(&translated[0], planner.nx, planner.ny);
+      costs = &translated[0];
+    }
+    return save(path, problem, raw_costs, costs, (flags & SNAPSHOT_POTENTIAL) ? planner.potarr : NULL,
+        planner.pathx, planner.pathy, flags);
+  }
+
+  bool PlanningSnapshot::save(const std::string& path, const SnapshotInfo& info, const unsigned char* raw_costs,
+      const COSTTYPE* costs, const float* potential, const float* pathx, const float* pathy, int flags){
+    FileHeader header = FileHeader(); //value initialised, so the padding written is zero too
+    memcpy(header.magic, snapshot_magic, sizeof(header.magic));
+    header.byte_order = 0x01020304;
+    header.major = SNAPSHOT_VERSION_MAJOR;
+    header.minor = SNAPSHOT_VERSION_MINOR;
+    header.header_size = sizeof(FileHeader);
+    header.info = info;
+    header.info.reserved[0] = header.info.reserved[1] = 0;
+    if(!pathx || !pathy)
+      header.info.path_len = 0;
+    uint64_t ns = (uint64_t)info.nx * info.ny;
+
+    std::vector<float> points;
+    if(header.info.path_len > 0){
+      points.assign(pathx, pathx + header.info.path_len);
+      points.insert(points.end(), pathy, pathy + header.info.path_len);
+    }
+
+    std::vector<SectionData> data;
+    SectionData d;
+    if(raw_costs){
+      d.type = RAW_COSTS; d.data = raw_costs; d.size = ns;
+      data.push_back(d);
+    }
+    d.type = COSTS; d.data = costs; d.size = ns * sizeof(COSTTYPE);
+    data.push_back(d);
+    if(potential){
+      d.type = POTENTIAL; d.data = potential; d.size = ns * sizeof(float);
+      data.push_back(d);
+    }
+    if(!points.empty()){
+      d.type = PATH; d.data = &points[0]; d.size = points.size() * sizeof(float);
+      data.push_back(d);
+    }
+    header.nsections = data.size();
+
+    //compress first, the section table needs the stored sizes
+    std::vector<Section> table(data.size());
+    std::vector<std::vector<char> > packed(data.size());
+    for(size_t i = 0; i < data.size(); ++i){
+      table[i].type = data[i].type;
+      table[i].codec = SNAPSHOT_CODEC_RAW;
+      table[i].size = table[i].raw_size = data[i].size;
+      //sections LZ4 can't address, or that don't get smaller, are stored as they are
+      if((flags & SNAPSHOT_LZ4) && data[i].size > 0 && data[i].size <= (uint64_t)LZ4_MAX_INPUT_SIZE){
+        packed[i].resize(LZ4_compressBound(data[i].size));
+        int n = LZ4_compress_default((const char*)data[i].data, &packed[i][0], data[i].size, packed[i].size());
+        if(n > 0 && (uint64_t)n < data[i].size){
+          packed[i].resize(n);
+          table[i].codec = SNAPSHOT_CODEC_LZ4;
+          table[i].size = n;
+        }
+        else
+          std::vector<char>().swap(packed[i]);
+      }
+    }
+
+    uint64_t offset = align(sizeof(FileHeader) + table.size() * sizeof(Section));
+    for(size_t i = 0; i < table.size(); ++i){
+      table[i].offset = offset;
+      offset = align(offset + table[i].size);
+    }
+
+    FILE* f = fopen(path.c_str(), "wb");
+    if(!f){
+      ROS_ERROR("Could not write the planning snapshot %s", path.c_str());
+      return false;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1
+      && (table.empty() || fwrite(&table[0], sizeof(Section), table.size(), f) == table.size());
+    offset = sizeof(FileHeader) + table.size() * sizeof(Section);
+    for(size_t i = 0; ok && i < table.size(); ++i){
+      const void* bytes = table[i].codec == SNAPSHOT_CODEC_LZ4 ? (const void*)&packed[i][0] : data[i].data;
+      ok = pad(f, offset) && fwrite(bytes, 1, table[i].size, f) == table[i].size;
+      offset += table[i].size;
+    }
+    ok = pad(f, offset) && ok;
+    if(fclose(f) != 0 || !ok){
+      ROS_ERROR("Could not write the planning snapshot %s", path.c_str());
+      return false;
+    }
+    return true;
+  }
+
+  bool PlanningSnapshot::open(const std::string& path){
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if(fd < 0)
+      return false;
+    struct stat st;
+    if(fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(FileHeader)){
+      ::close(fd);
+      return false;
+    }
+    void* map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if(map == MAP_FAILED)
+      return false;
+    map_ = map;
+    map_size_ = st.st_size;
+
+    const FileHeader* header = (const FileHeader*)map_;
+    if(memcmp(header->magic, snapshot_magic, sizeof(snapshot_magic)) != 0 || header->byte_order != 0x01020304){
+      ROS_ERROR("%s is not a planning snapshot written on a machine of this byte order", path.c_str());
+      close();
+      return false;
+    }
+    if(header->major > SNAPSHOT_VERSION_MAJOR || header->header_size < sizeof(FileHeader)){
+      ROS_ERROR("%s is a planning snapshot of version %u.%u, which is newer than this reader", path.c_str(),
+          header->major, header->minor);
+      close();
+      return false;
+    }
+
+    //the table and every section have to lie within the file
+    uint64_t table_end = header->header_size + (uint64_t)header->nsections * sizeof(Section);
+    if(table_end > map_size_){
+      close();
+      return false;
+    }
+    sections_ = (const Section*)((const char*)map_ + header->header_size);
+    nsections_ = header->nsections;
+    for(uint32_t i = 0; i < nsections_; ++i){
+      if(sections_[i].offset > map_size_ || sections_[i].size > map_size_ - sections_[i].offset){
+        ROS_ERROR("The planning snapshot %s is truncated", path.c_str());
+        close();
+        return false;
+      }
+    }
+
+    //and hold the arrays the header promises, the accessors hand them out without sizes
+    const SnapshotInfo& info = header->info;
+    bool sane = info.nx > 0 && info.ny > 0 && info.path_len >= 0;
+    uint64_t ns = sane ? (uint64_t)info.nx * info.ny : 0;
+    for(uint32_t i = 0; sane && i < nsections_; ++i){
+      const Section& s = sections_[i];
+      uint64_t expected = s.raw_size;
+      switch(s.type){
+        case RAW_COSTS: expected = ns; break;
+        case COSTS: expected = ns * sizeof(COSTTYPE); break;
+        case POTENTIAL: expected = ns * sizeof(float); break;
+        case PATH: expected = 2 * (uint64_t)info.path_len * sizeof(float); break;
+      }
+      sane = s.raw_size == expected && (s.codec != SNAPSHOT_CODEC_RAW || s.size == s.raw_size);
+    }
+    if(!sane){
+      ROS_ERROR("The sections of the planning snapshot %s don't match its %dx%d map", path.c_str(), info.nx, info.ny);
+      close();
+      return false;
+    }
+    info_ = info;
+    return true;
+  }
+
+  void PlanningSnapshot::close(){
+    if(map_)
+      munmap(map_, map_size_);
+    map_ = NULL;
+    map_size_ = 0;
+    sections_ = NULL;
+    nsections_ = 0;
+    for(int i = 0; i < NUM_SECTIONS; ++i)
+      std::vector<char>().swap(inflated_[i]);
+    info_ = SnapshotInfo();
+  }
+
+  const void* PlanningSnapshot::section(uint32_t type){
+    for(uint32_t i = 0; i < nsections_; ++i){
+      const Section& s = sections_[i];
+      if(s.type != type)
+        continue;
+      const char* stored = (const char*)map_ + s.offset;
+      if(s.codec == SNAPSHOT_CODEC_RAW)
+        return stored;
+      if(type >= NUM_SECTIONS || s.codec != SNAPSHOT_CODEC_LZ4)
+        return NULL;
+
+      std::vector<char>& out = inflated_[type];
+      if(out.empty() && s.raw_size > 0){
+        if(s.size > (uint64_t)LZ4_MAX_INPUT_SIZE || s.raw_size > (uint64_t)LZ4_MAX_INPUT_SIZE){
+          ROS_ERROR("A compressed section of the planning snapshot is larger than LZ4 can hold");
+          return NULL;
+        }
+        out.resize(s.raw_size);
+        if(LZ4_decompress_safe(stored, &out[0], s.size, s.raw_size) != (int)s.raw_size){
+          ROS_ERROR("A compressed section of the planning snapshot is corrupt");
+          std::vector<char>().swap(out);
+          return NULL;
+        }
+      }
+      return out.empty() ? NULL : &out[0];
+    }
+    return NULL;
+  }
+
+  const unsigned char* PlanningSnapshot::rawCosts(){
+    return (const unsigned char*)section(RAW_COSTS);
+  }
+
+  const COSTTYPE* PlanningSnapshot::costs(){
+    return (const COSTTYPE*)section(COSTS);
+  }
+
+  const float* PlanningSnapshot::potential(){
+    return (const float*)section(POTENTIAL);
+  }
+
+  const float* PlanningSnapshot::pathX(){
+    return info_.path_len > 0 ? (const float*)section(PATH) : NULL;
+  }
+
+  const float* PlanningSnapshot::pathY(){
+    const float* x = pathX();
+    return x ? x + info_.path_len : NULL;
+  }
+
+  bool PlanningSnapshot::restore(NavFn& planner){
+    const COSTTYPE* c = costs();
+    if(!c || planner.nx != info_.nx || planner.ny != info_.ny)
+      return false;
+    if(!hasObsBorder(c, info_.nx, info_.ny)){
+      ROS_ERROR("The costs of the planning snapshot have no obstacle border, they can't be planned on");
+      return false;
+    }
+    planner.setCostArr(c);
+    planner.priInc = info_.pri_inc;
+    int start[2] = { info_.start[0], info_.start[1] };
+    int goal[2] = { info_.goal[0], info_.goal[1] };
+    planner.setStart(start);
+    planner.setGoal(goal);
+    return true;
+  }
+
+};
@@ -0,0 +1,155 @@
+/*********************************************************************
+*
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2008, Willow Garage, Inc.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*
+*********************************************************************/
+#include <navfn/potential_field.h>
+#include <math.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace navfn {
+
+  void PotentialField::copyFrom(const NavFn& planner, double ox, double oy, double res){
+    nx = planner.nx;
+    ny = planner.ny;
+    origin_x = ox;
+    origin_y = oy;
+    resolution = res;
+    pot.assign(planner.potarr, planner.potarr + planner.ns);
+  }
+
+  void PotentialField::bilinear(int ix, int iy, float tx, float ty, bool interpolate, float* p, float* gx, float* gy) const {
+    float c00 = at(ix, iy), c10 = at(ix + 1, iy), c01 = at(ix, iy + 1), c11 = at(ix + 1, iy + 1);
+    bool valid = c00 < POT_HIGH && c10 < POT_HIGH && c01 < POT_HIGH && c11 < POT_HIGH;
+    if(valid && interpolate)
+      *p = (c00 * (1 - tx) + c10 * tx) * (1 - ty) + (c01 * (1 - tx) + c11 * tx) * ty;
+    else
+      *p = at(ix + (tx >= 0.5f), iy + (ty >= 0.5f)); //the cell the point is in
+    if(gx){
+      float inv = 1.0 / resolution;
+      *gx = valid ? ((c10 - c00) * (1 - ty) + (c11 - c01) * ty) * inv : 0.0f;
+      *gy = valid ? ((c01 - c00) * (1 - tx) + (c11 - c10) * tx) * inv : 0.0f;
+    }
+  }
+
+  void PotentialField::sample(const float* wx, const float* wy, unsigned int n, float* p,
+      bool interpolate, float* gradx, float* grady) const {
+    if(!gradx || !grady)
+      gradx = grady = NULL;
+    const float ox = origin_x, oy = origin_y, inv = 1.0 / resolution;
+    unsigned int i = 0;
+
+    //without interpolation or gradients a point only needs the cell it is in
+    if(!interpolate && !gradx){
+#ifdef __SSE2__
+      const __m128 vox = _mm_set1_ps(ox), voy = _mm_set1_ps(oy), vinv = _mm_set1_ps(inv);
+      const __m128i one = _mm_set1_epi32(1);
+      for(; i + 4 <= n; i += 4){
+        __m128 fx = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(wx + i), vox), vinv);
+        __m128 fy = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(wy + i), voy), vinv);
+        //floor: truncate, then step down where that rounded up
+        __m128i ix = _mm_cvttps_epi32(fx), iy = _mm_cvttps_epi32(fy);
+        ix = _mm_sub_epi32(ix, _mm_and_si128(_mm_castps_si128(_mm_cmpgt_ps(_mm_cvtepi32_ps(ix), fx)), one));
+        iy = _mm_sub_epi32(iy, _mm_and_si128(_mm_castps_si128(_mm_cmpgt_ps(_mm_cvtepi32_ps(iy), fy)), one));
+        int cx[4], cy[4];
+        _mm_storeu_si128((__m128i*)cx, ix);
+        _mm_storeu_si128((__m128i*)cy, iy);
+        for(int l = 0; l < 4; ++l)
+          p[i + l] = at(cx[l], cy[l]);
+      }
+#endif
+      for(; i < n; ++i)
+        p[i] = at((int)floorf((wx[i] - ox) * inv), (int)floorf((wy[i] - oy) * inv));
+      return;
+    }
+
+    //bilinear between the four cell centers around each point
+#ifdef __SSE2__
+    const __m128 vox = _mm_set1_ps(ox), voy = _mm_set1_ps(oy), vinv = _mm_set1_ps(inv);
+    const __m128 half = _mm_set1_ps(0.5f), vone = _mm_set1_ps(1.0f), high = _mm_set1_ps(POT_HIGH);
+    const __m128i one = _mm_set1_epi32(1);
+    for(; i + 4 <= n; i += 4){
+      __m128 fx = _mm_sub_ps(_mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(wx + i), vox), vinv), half);
+      __m128 fy = _mm_sub_ps(_mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(wy + i), voy), vinv), half);
+      __m128i ix = _mm_cvttps_epi32(fx), iy = _mm_cvttps_epi32(fy);
+      ix = _mm_sub_epi32(ix, _mm_and_si128(_mm_castps_si128(_mm_cmpgt_ps(_mm_cvtepi32_ps(ix), fx)), one));
+      iy = _mm_sub_epi32(iy, _mm_and_si128(_mm_castps_si128(_mm_cmpgt_ps(_mm_cvtepi32_ps(iy), fy)), one));
+      __m128 tx = _mm_sub_ps(fx, _mm_cvtepi32_ps(ix));
+      __m128 ty = _mm_sub_ps(fy, _mm_cvtepi32_ps(iy));
+
+      int cx[4], cy[4];
+      float c00[4], c10[4], c01[4], c11[4];
+      _mm_storeu_si128((__m128i*)cx, ix);
+      _mm_storeu_si128((__m128i*)cy, iy);
+      for(int l = 0; l < 4; ++l){
+        c00[l] = at(cx[l], cy[l]);
+        c10[l] = at(cx[l] + 1, cy[l]);
+        c01[l] = at(cx[l], cy[l] + 1);
+        c11[l] = at(cx[l] + 1, cy[l] + 1);
+      }
+      __m128 v00 = _mm_loadu_ps(c00), v10 = _mm_loadu_ps(c10), v01 = _mm_loadu_ps(c01), v11 = _mm_loadu_ps(c11);
+      __m128 valid = _mm_and_ps(_mm_and_ps(_mm_cmplt_ps(v00, high), _mm_cmplt_ps(v10, high)),
+          _mm_and_ps(_mm_cmplt_ps(v01, high), _mm_cmplt_ps(v11, high)));
+      __m128 sx = _mm_sub_ps(vone, tx), sy = _mm_sub_ps(vone, ty);
+
+      __m128 top = _mm_add_ps(_mm_mul_ps(v00, sx), _mm_mul_ps(v10, tx));
+      __m128 bottom = _mm_add_ps(_mm_mul_ps(v01, sx), _mm_mul_ps(v11, tx));
+      _mm_storeu_ps(p + i, _mm_add_ps(_mm_mul_ps(top, sy), _mm_mul_ps(bottom, ty)));
+      if(gradx){
+        __m128 gx = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(v10, v00), sy), _mm_mul_ps(_mm_sub_ps(v11, v01), ty));
+        __m128 gy = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(v01, v00), sx), _mm_mul_ps(_mm_sub_ps(v11, v10), tx));
+        _mm_storeu_ps(gradx + i, _mm_and_ps(valid, _mm_mul_ps(gx, vinv)));
+        _mm_storeu_ps(grady + i, _mm_and_ps(valid, _mm_mul_ps(gy, vinv)));
+      }
+
+      //points next to unreached cells, or when only the gradient was asked for, take their cell's value
+      int mask = interpolate ? _mm_movemask_ps(valid) : 0;
+      if(mask != 0xf){
+        float ftx[4], fty[4];
+        _mm_storeu_ps(ftx, tx);
+        _mm_storeu_ps(fty, ty);
+        for(int l = 0; l < 4; ++l)
+          if(!(mask & (1 << l)))
+            p[i + l] = at(cx[l] + (ftx[l] >= 0.5f), cy[l] + (fty[l] >= 0.5f));
+      }
+    }
+#endif
+    for(; i < n; ++i){
+      float fx = (wx[i] - ox) * inv - 0.5f, fy = (wy[i] - oy) * inv - 0.5f;
+      int ix = (int)floorf(fx), iy = (int)floorf(fy);
+      bilinear(ix, iy, fx - ix, fy - iy, interpolate, p + i, gradx ? gradx + i : NULL, grady ? grady + i : NULL);
+    }
+  }
+};
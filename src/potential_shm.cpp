@@ -0,0 +1,242 @@
+/*********************************************************************
+*
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2008, Willow Garage, Inc.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*
+*********************************************************************/
+#include <navfn/potential_shm.h>
+#include <ros/console.h>
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define POTENTIAL_SHM_VERSION 1
+// buffers start on this boundary
+#define POTENTIAL_SHM_ALIGN 64
+// attempts at a consistent copy before giving up on a writer that keeps overtaking the reader
+#define POTENTIAL_SHM_RETRIES 1000
+
+// readers and the writer share the atomics across processes, which only works if they are lock-free
+#if BOOST_ATOMIC_INT64_LOCK_FREE != 2 || BOOST_ATOMIC_INT32_LOCK_FREE != 2
+#error "The potential export needs lock-free 32 and 64 bit atomics"
+#endif
+
+namespace navfn {
+
+  namespace {
+    const char potential_magic[8] = { 'N', 'A', 'V', 'F', 'N', 'P', 'O', 'T' };
+
+    size_t align(size_t n){
+      return (n + POTENTIAL_SHM_ALIGN - 1) & ~(size_t)(POTENTIAL_SHM_ALIGN - 1);
+    }
+  }
+
+  PotentialShmWriter::PotentialShmWriter() : map_(NULL), map_size_(0), plans_(0) {}
+
+  PotentialShmWriter::~PotentialShmWriter(){
+    close();
+  }
+
+  bool PotentialShmWriter::open(const std::string& name, size_t capacity){
+    boost::mutex::scoped_lock lock(mutex_);
+    name_ = name;
+    return create(capacity);
+  }
+
+  void PotentialShmWriter::close(){
+    boost::mutex::scoped_lock lock(mutex_);
+    if(map_){
+      ((PotentialShm*)map_)->stale.store(1, boost::memory_order_release);
+      munmap(map_, map_size_);
+      shm_unlink(name_.c_str());
+    }
+    map_ = NULL;
+    map_size_ = 0;
+  }
+
+  bool PotentialShmWriter::create(size_t capacity){
+    //readers of a segment being replaced keep their mapping until they notice it is stale and reopen
+    if(map_){
+      ((PotentialShm*)map_)->stale.store(1, boost::memory_order_release);
+      munmap(map_, map_size_);
+      map_ = NULL;
+      map_size_ = 0;
+    }
+    shm_unlink(name_.c_str());
+
+    capacity = std::max(capacity, (size_t)1);
+    size_t size = align(sizeof(PotentialShm)) + 2 * align(capacity * sizeof(float));
+    int fd = shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if(fd < 0){
+      ROS_ERROR("Could not create the shared memory segment %s: %s", name_.c_str(), strerror(errno));
+      return false;
+    }
+    void* map = MAP_FAILED;
+    if(ftruncate(fd, size) == 0)
+      map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if(map == MAP_FAILED){
+      ROS_ERROR("Could not map the shared memory segment %s: %s", name_.c_str(), strerror(errno));
+      shm_unlink(name_.c_str());
+      return false;
+    }
+
+    //a new segment is zero filled, which is also what the atomics start from
+    PotentialShm* shm = (PotentialShm*)map;
+    memcpy(shm->magic, potential_magic, sizeof(shm->magic));
+    shm->version = POTENTIAL_SHM_VERSION;
+    shm->header_size = sizeof(PotentialShm);
+    shm->capacity = capacity;
+    for(int i = 0; i < 2; ++i)
+      shm->buffers[i].offset = align(sizeof(PotentialShm)) + i * align(capacity * sizeof(float));
+    shm->front.store(0, boost::memory_order_release);
+    map_ = map;
+    map_size_ = size;
+    return true;
+  }
+
+  bool PotentialShmWriter::publish(const PotentialInfo& info, const float* potential){
+    boost::mutex::scoped_lock lock(mutex_);
+    if(!map_ || info.nx <= 0 || info.ny <= 0)
+      return false;
+    size_t ns = (size_t)info.nx * info.ny;
+    if(ns > ((PotentialShm*)map_)->capacity && !create(ns))
+      return false;
+
+    //fill the buffer readers are not pointed at, then point them at it
+    PotentialShm* shm = (PotentialShm*)map_;
+    uint32_t back = 1 - shm->front.load(boost::memory_order_relaxed);
+    PotentialShm::Buffer& buffer = shm->buffers[back];
+    uint64_t seq = buffer.seq.load(boost::memory_order_relaxed);
+    buffer.seq.store(seq + 1, boost::memory_order_relaxed);
+    boost::atomic_thread_fence(boost::memory_order_release);
+    buffer.info = info;
+    buffer.info.plan = ++plans_;
+    buffer.info.frame_id[sizeof(buffer.info.frame_id) - 1] = '\0';
+    memcpy((char*)map_ + buffer.offset, potential, ns * sizeof(float));
+    buffer.seq.store(seq + 2, boost::memory_order_release);
+    shm->front.store(back, boost::memory_order_release);
+    return true;
+  }
+
+  PotentialShmReader::PotentialShmReader() : map_(NULL), map_size_(0) {}
+
+  PotentialShmReader::~PotentialShmReader(){
+    close();
+  }
+
+  bool PotentialShmReader::open(const std::string& name){
+    close();
+    name_ = name;
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if(fd < 0)
+      return false;
+    struct stat st;
+    void* map = MAP_FAILED;
+    if(fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(PotentialShm))
+      map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if(map == MAP_FAILED)
+      return false;
+    map_ = map;
+    map_size_ = st.st_size;
+
+    const PotentialShm* shm = (const PotentialShm*)map_;
+    bool ok = memcmp(shm->magic, potential_magic, sizeof(potential_magic)) == 0 &&
+      shm->version == POTENTIAL_SHM_VERSION && shm->header_size == sizeof(PotentialShm);
+    for(int i = 0; ok && i < 2; ++i)
+      ok = shm->buffers[i].offset <= map_size_ && shm->capacity * sizeof(float) <= map_size_ - shm->buffers[i].offset;
+    if(!ok)
+      close();
+    return ok;
+  }
+
+  void PotentialShmReader::close(){
+    if(map_)
+      munmap(map_, map_size_);
+    map_ = NULL;
+    map_size_ = 0;
+  }
+
+  bool PotentialShmReader::latest(View& view){
+    if((!map_ || ((const PotentialShm*)map_)->stale.load(boost::memory_order_acquire)) && !open(name_))
+      return false;
+
+    const PotentialShm* shm = (const PotentialShm*)map_;
+    for(int i = 0; i < POTENTIAL_SHM_RETRIES; ++i){
+      uint32_t front = shm->front.load(boost::memory_order_acquire);
+      const PotentialShm::Buffer& buffer = shm->buffers[front];
+      uint64_t seq = buffer.seq.load(boost::memory_order_acquire);
+      if(seq == 0)
+        return false;
+      if(seq & 1)
+        continue;
+      view.info = buffer.info;
+      boost::atomic_thread_fence(boost::memory_order_acquire);
+      if(buffer.seq.load(boost::memory_order_relaxed) != seq)
+        continue;
+      if((uint64_t)view.info.nx * view.info.ny > shm->capacity)
+        return false;
+      view.potential = (const float*)((const char*)map_ + buffer.offset);
+      view.seq = seq;
+      view.buffer = front;
+      return true;
+    }
+    return false;
+  }
+
+  bool PotentialShmReader::valid(const View& view) const {
+    if(!map_)
+      return false;
+    boost::atomic_thread_fence(boost::memory_order_acquire);
+    return ((const PotentialShm*)map_)->buffers[view.buffer].seq.load(boost::memory_order_relaxed) == view.seq;
+  }
+
+  bool PotentialShmReader::copy(PotentialInfo& info, std::vector<float>& potential){
+    for(int i = 0; i < POTENTIAL_SHM_RETRIES; ++i){
+      View view;
+      if(!latest(view))
+        return false;
+      potential.assign(view.potential, view.potential + (size_t)view.info.nx * view.info.ny);
+      if(valid(view)){
+        info = view.info;
+        return true;
+      }
+    }
+    return false;
+  }
+
+};
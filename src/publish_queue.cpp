@@ -0,0 +1,118 @@
+/*********************************************************************
+*
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2008, Willow Garage, Inc.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*
+*********************************************************************/
+#include <navfn/publish_queue.h>
+
+namespace navfn {
+
+  PublishQueue::PublishQueue(unsigned int capacity)
+    : queue_(capacity), running_(true), sleeping_(false), blocked_(0), pushed_(0), popped_(0), dropped_(0) {
+    thread_ = boost::thread(boost::bind(&PublishQueue::worker, this));
+  }
+
+  PublishQueue::~PublishQueue(){
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      running_ = false;
+    }
+    cond_.notify_all();
+    space_.notify_all();
+    thread_.join();
+
+    Job* job;
+    while(queue_.pop(job))
+      delete job;
+  }
+
+  bool PublishQueue::post(Job* job, bool droppable){
+    //bounded_push never allocates, a full queue means the publisher thread is behind
+    unsigned long popped = popped_;
+    while(!queue_.bounded_push(job)){
+      if(droppable || !running_){
+        delete job;
+        ++dropped_;
+        return false;
+      }
+      //the publisher thread can't wait for itself
+      if(boost::this_thread::get_id() == thread_.get_id()){
+        job->run();
+        delete job;
+        return true;
+      }
+
+      //messages that must not be lost wait for the publisher thread to take a job, so they stay in order
+      boost::mutex::scoped_lock lock(mutex_);
+      ++blocked_;
+      while(running_ && popped_ == popped)
+        space_.wait(lock);
+      --blocked_;
+      popped = popped_;
+    }
+
+    //counted after the push, so a worker that finds pushed_ == popped_ under the mutex has seen sleeping_ be read
+    ++pushed_;
+    if(sleeping_){
+      boost::mutex::scoped_lock lock(mutex_);
+      cond_.notify_one();
+    }
+    return true;
+  }
+
+  void PublishQueue::worker(){
+    Job* job;
+    while(true){
+      while(queue_.pop(job)){
+        ++popped_;
+        if(blocked_){
+          boost::mutex::scoped_lock lock(mutex_);
+          space_.notify_all();
+        }
+        job->run();
+        delete job;
+      }
+
+      boost::mutex::scoped_lock lock(mutex_);
+      //announce the wait before counting again: a producer either counted its job before we look, or sees the flag
+      //afterwards and has to take the mutex, which it only gets once we wait
+      sleeping_ = true;
+      while(running_ && pushed_ == popped_)
+        cond_.wait(lock);
+      sleeping_ = false;
+      if(!running_)
+        return;
+    }
+  }
+
+};
@@ -28,20 +28,12 @@
  */
 
 #include <navfn/navfn.h>
+#include <navfn/pgm_map.h>
+#include <navfn/read_pgm_costmap.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
-
-#ifdef __APPLE__
-# include <netpbm/pgm.h>
-#else
-extern "C" {
-#include <stdio.h>
-// pgm.h is not very friendly with system headers... need to undef max() and min() afterwards
-#include <pgm.h>
-#undef max
-#undef min
-}
-#endif
+#include <string.h>
 
 void
 setcostobs(COSTTYPE *cmap, int n, int w)
@@ -72,50 +64,41 @@ void setcostunk(COSTTYPE *cmap, int n, int w)
 COSTTYPE *
 readPGM(const char *fname, int *width, int *height, bool raw)
 {
-  pm_init("navfn_tests",0);
-
-  FILE *pgmfile;
-  pgmfile = fopen(fname,"r");
-  if (!pgmfile)
+  navfn::PgmMap pgm;
+  if (!pgm.open(fname))
   {
-    printf("readPGM() Can't find file %s\n", fname);
+    printf("readPGM() Can't read file %s\n", fname);
     return NULL;
   }
 
   printf("readPGM() Reading costmap file %s\n", fname);
-  int ncols, nrows;
-  gray maxval;
-  int format;
-  pgm_readpgminit(pgmfile, &ncols, &nrows, &maxval, &format);
+  int ncols = pgm.width(), nrows = pgm.height();
   printf("readPGM() Size: %d x %d\n", ncols, nrows);
 
   // set up cost map
   COSTTYPE *cmap = (COSTTYPE *)malloc(ncols*nrows*sizeof(COSTTYPE));
-  if (!raw)
-    for (int i=0; i<ncols*nrows; i++)
-      cmap[i] = COST_NEUTRAL;
-
-  gray * row(pgm_allocrow(ncols));
+  const unsigned char *pix = pgm.data();
   int otot = 0;
   int utot = 0;
   int ftot = 0;
-  for (int ii = 0; ii < nrows; ii++) {
-    pgm_readpgmrow(pgmfile, row, ncols, maxval, format);
-    if (raw)			// raw costmap from ROS
+  if (raw)			// raw costmap from ROS, copied as is
+  {
+    memcpy(cmap, pix, ncols*nrows);
+    for (int i = 0; i < ncols*nrows; i++)
     {
-      for (int jj(ncols - 1); jj >= 0; --jj)
-      {
-        int v = row[jj];
-        cmap[ii*ncols+jj] = v;
-        if (v >= COST_OBS_ROS)
-          otot++;
-        if (v == 0)
-          ftot++;
-      }
+      otot += pix[i] >= COST_OBS_ROS;
+      ftot += pix[i] == 0;
     }
-    else
+  }
+  else
+  {
+    for (int i=0; i<ncols*nrows; i++)
+      cmap[i] = COST_NEUTRAL;
+    ftot = ncols*nrows;
+    for (int ii = 0; ii < nrows; ii++)
     {
-      ftot = ncols*nrows;
+      const unsigned char *row = pix + ii*ncols;
+      // the obstacle stamps overlap, right to left keeps the maps this has always produced
       for (int jj(ncols - 1); jj >= 0; --jj)
       {
         if (row[jj] < unknown_gray && ii < nrows-7 && ii > 7)
@@ -134,7 +117,6 @@ readPGM(const char *fname, int *width, int *height, bool raw)
     }
   }
   printf("readPGM() Found %d obstacle cells, %d free cells, %d unknown cells\n", otot, ftot, utot);
-  pgm_freerow(row);
   *width = ncols;
   *height = nrows;
   return cmap;
@@ -0,0 +1,259 @@
+/*********************************************************************
+*
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2008, Willow Garage, Inc.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*
+*********************************************************************/
+#include <navfn/subgoal_segment_cache.h>
+#include <ros/console.h>
+
+// cells around the bounding box of a segment whose costs are fingerprinted,
+// so that obstacles appearing right next to the path also invalidate it
+#define SEGMENT_WINDOW_MARGIN 5
+
+namespace navfn {
+
+  SubgoalSegmentCache::SubgoalSegmentCache(costmap_2d::Costmap2D* costmap, int num_workers, bool allow_unknown)
+    : costmap_(costmap), allow_unknown_(allow_unknown), nx_(0), ny_(0), running_(true) {
+    for(int i = 0; i < num_workers; ++i)
+      workers_.create_thread(boost::bind(&SubgoalSegmentCache::worker, this));
+  }
+
+  SubgoalSegmentCache::~SubgoalSegmentCache(){
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      running_ = false;
+      queue_.clear();
+    }
+    cond_.notify_all();
+    workers_.join_all();
+  }
+
+  uint64_t SubgoalSegmentCache::key(unsigned int fx, unsigned int fy, unsigned int tx, unsigned int ty) const {
+    uint64_t from = fy * (uint64_t)nx_ + fx;
+    uint64_t to = ty * (uint64_t)nx_ + tx;
+    return (from << 32) | to;
+  }
+
+  bool SubgoalSegmentCache::toCell(const geometry_msgs::Pose& pose, unsigned int* cell) const {
+    return costmap_->worldToMap(pose.position.x, pose.position.y, cell[0], cell[1]);
+  }
+
+  void SubgoalSegmentCache::request(const std::vector<geometry_msgs::Pose>& route){
+    boost::mutex::scoped_lock lock(mutex_);
+
+    //segments planned on a map of a different size can't be matched by cell anymore
+    if(nx_ != costmap_->getSizeInCellsX() || ny_ != costmap_->getSizeInCellsY()){
+      nx_ = costmap_->getSizeInCellsX();
+      ny_ = costmap_->getSizeInCellsY();
+      segments_.clear();
+      queue_.clear();
+      pending_.clear();
+    }
+
+    std::set<uint64_t> wanted;
+    bool queued = false;
+    for(unsigned int i = 0; i + 1 < route.size(); ++i){
+      Job job;
+      if(!toCell(route[i], job.from) || !toCell(route[i + 1], job.to))
+        continue;
+      job.key = key(job.from[0], job.from[1], job.to[0], job.to[1]);
+      wanted.insert(job.key);
+
+      if(segments_.count(job.key) || pending_.count(job.key))
+        continue;
+      pending_.insert(job.key);
+      queue_.push_back(job);
+      queued = true;
+    }
+
+    //forget about legs that are no longer part of the route
+    std::map<uint64_t, boost::shared_ptr<Segment> >::iterator it = segments_.begin();
+    while(it != segments_.end()){
+      if(wanted.count(it->first))
+        ++it;
+      else
+        segments_.erase(it++);
+    }
+
+    if(queued)
+      cond_.notify_all();
+  }
+
+  bool SubgoalSegmentCache::lookup(const geometry_msgs::Pose& from, const geometry_msgs::Pose& to,
+      std::vector<float>& path_x, std::vector<float>& path_y){
+    unsigned int fc[2], tc[2];
+    if(!toCell(from, fc) || !toCell(to, tc))
+      return false;
+
+    boost::shared_ptr<Segment> segment;
+    {
+      //the costmap lock is always taken before our own, the workers never hold both
+      boost::unique_lock<costmap_2d::Costmap2D::mutex_t> cm_lock(*(costmap_->getMutex()));
+      boost::mutex::scoped_lock lock(mutex_);
+      if(nx_ != costmap_->getSizeInCellsX() || ny_ != costmap_->getSizeInCellsY())
+        return false;
+
+      uint64_t k = key(fc[0], fc[1], tc[0], tc[1]);
+      std::map<uint64_t, boost::shared_ptr<Segment> >::iterator it = segments_.find(k);
+      if(it == segments_.end())
+        return false;
+      segment = it->second;
+
+      //replan the segment if the costs around it changed since it was planned, compared as the planner saw them
+      int w = segment->max_x + 1 - segment->min_x, h = segment->max_y + 1 - segment->min_y;
+      window_.resize(w * h);
+      const unsigned char* cmap = costmap_->getCharMap();
+      for(int j = 0; j < h; ++j)
+        NavFn::translateCostmap(cmap + (segment->min_y + j) * nx_ + segment->min_x, &window_[j * w], w, 1, true,
+            allow_unknown_);
+      if(NavFn::hashCostmap(&window_[0], w, 0, 0, w, h) != segment->fingerprint){
+        ROS_DEBUG("[SubgoalSegmentCache] Costmap changed under a cached segment, replanning it");
+        segments_.erase(it);
+        Job job;
+        job.key = k;
+        job.from[0] = fc[0]; job.from[1] = fc[1];
+        job.to[0] = tc[0]; job.to[1] = tc[1];
+        pending_.insert(k);
+        queue_.push_front(job);
+        cond_.notify_one();
+        return false;
+      }
+
+      if(!segment->valid)
+        return false;
+    }
+
+    path_x = segment->path_x;
+    path_y = segment->path_y;
+    return true;
+  }
+
+  void SubgoalSegmentCache::clear(){
+    boost::mutex::scoped_lock lock(mutex_);
+    segments_.clear();
+    queue_.clear();
+    pending_.clear();
+  }
+
+  void SubgoalSegmentCache::worker(){
+    boost::shared_ptr<NavFn> planner(new NavFn(0, 0));
+
+    while(true){
+      Job job;
+      {
+        boost::mutex::scoped_lock lock(mutex_);
+        while(running_ && queue_.empty())
+          cond_.wait(lock);
+        if(!running_)
+          return;
+        job = queue_.front();
+        queue_.pop_front();
+      }
+      planSegment(*planner, job);
+    }
+  }
+
+  void SubgoalSegmentCache::planSegment(NavFn& planner, const Job& job){
+    unsigned int nx, ny;
+    {
+      //translate into the planner's own costs so we don't hold the costmap's lock while planning
+      boost::unique_lock<costmap_2d::Costmap2D::mutex_t> cm_lock(*(costmap_->getMutex()));
+      nx = costmap_->getSizeInCellsX();
+      ny = costmap_->getSizeInCellsY();
+      if(nx > 2 && ny > 2){
+        if(planner.nx != (int)nx || planner.ny != (int)ny)
+          planner.setNavArr(nx, ny);
+        planner.setCostmap(costmap_->getCharMap(), true, allow_unknown_);
+      }
+    }
+
+    if(nx <= 2 || ny <= 2){
+      boost::mutex::scoped_lock lock(mutex_);
+      pending_.erase(job.key);
+      return;
+    }
+
+    //propagate from the start of the segment and follow the gradient back from its end, like makePlan
+    int map_start[2], map_goal[2];
+    map_start[0] = job.from[0];
+    map_start[1] = job.from[1];
+    map_goal[0] = job.to[0];
+    map_goal[1] = job.to[1];
+    planner.setStart(map_goal);
+    planner.setGoal(map_start);
+
+    boost::shared_ptr<Segment> segment(new Segment);
+    segment->valid = false;
+
+    //a failed segment is retried once the costs around its end points change
+    float min_x = std::min(job.from[0], job.to[0]), max_x = std::max(job.from[0], job.to[0]);
+    float min_y = std::min(job.from[1], job.to[1]), max_y = std::max(job.from[1], job.to[1]);
+
+    //propagate until the end of the segment is reached and trace the path once
+    planner.setupNavFn(true);
+    planner.propNavFnDijkstra(std::max(nx * ny / 20, nx + ny), true);
+    if(planner.potarr[job.to[1] * nx + job.to[0]] < POT_HIGH){
+      int len = planner.calcPath(nx * ny / 2);
+      float* x = planner.getPathX();
+      float* y = planner.getPathY();
+
+      segment->path_x.reserve(len);
+      segment->path_y.reserve(len);
+      for(int i = len - 1; i >= 0; --i){
+        segment->path_x.push_back(x[i]);
+        segment->path_y.push_back(y[i]);
+        min_x = std::min(min_x, x[i]); max_x = std::max(max_x, x[i]);
+        min_y = std::min(min_y, y[i]); max_y = std::max(max_y, y[i]);
+      }
+      segment->valid = len > 0;
+    }
+
+    //the border the planner gives its costs is left out, so the window matches a fresh translation
+    segment->min_x = std::max(1, std::min((int)nx - 2, (int)min_x - SEGMENT_WINDOW_MARGIN));
+    segment->min_y = std::max(1, std::min((int)ny - 2, (int)min_y - SEGMENT_WINDOW_MARGIN));
+    segment->max_x = std::max((int)segment->min_x, std::min((int)nx - 2, (int)max_x + 1 + SEGMENT_WINDOW_MARGIN));
+    segment->max_y = std::max((int)segment->min_y, std::min((int)ny - 2, (int)max_y + 1 + SEGMENT_WINDOW_MARGIN));
+    segment->fingerprint = NavFn::hashCostmap(planner.costarr, nx, segment->min_x, segment->min_y,
+        segment->max_x + 1, segment->max_y + 1);
+
+    if(!segment->valid)
+      ROS_DEBUG("[SubgoalSegmentCache] No path between subgoals (%u,%u) and (%u,%u)",
+          job.from[0], job.from[1], job.to[0], job.to[1]);
+
+    boost::mutex::scoped_lock lock(mutex_);
+    //the job was dropped or the map resized while we were planning
+    if(!pending_.erase(job.key) || nx != nx_ || ny != ny_)
+      return;
+    segments_[job.key] = segment;
+  }
+};
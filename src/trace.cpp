@@ -0,0 +1,169 @@
+/*********************************************************************
+*
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2008, Willow Garage, Inc.
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of the Willow Garage nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*
+*********************************************************************/
+#include <navfn/trace.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+namespace navfn {
+
+  Tracer& Tracer::instance(){
+    static Tracer tracer;
+    return tracer;
+  }
+
+  Tracer::Tracer() : enabled_(false), ring_(NULL) {}
+
+  Tracer::~Tracer(){
+    delete ring_.load(boost::memory_order_relaxed);
+    for(size_t i = 0; i < retired_.size(); ++i)
+      delete retired_[i];
+  }
+
+  void Tracer::enable(unsigned int capacity){
+    unsigned int size = 1;
+    while(size < capacity)
+      size <<= 1;
+
+    //a recorder that saw tracing enabled may still be writing into the old ring, so it is kept, never reused
+    boost::mutex::scoped_lock lock(mutex_);
+    Ring* old = ring_.exchange(new Ring(size), boost::memory_order_acq_rel);
+    if(old)
+      retired_.push_back(old);
+    enabled_.store(true, boost::memory_order_release);
+  }
+
+  void Tracer::disable(){
+    enabled_.store(false, boost::memory_order_release);
+  }
+
+  uint64_t Tracer::now(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+  }
+
+  uint32_t Tracer::threadId(){
+    static __thread uint32_t tid = 0;
+    if(tid == 0)
+      tid = syscall(SYS_gettid);
+    return tid;
+  }
+
+  Tracer::Event* Tracer::claim(Ring* ring, uint64_t& index){
+    index = ring->head.fetch_add(1, boost::memory_order_relaxed);
+    Slot& slot = ring->slots[index & ring->mask];
+    slot.seq.store(2 * index + 1, boost::memory_order_relaxed);
+    boost::atomic_thread_fence(boost::memory_order_release);
+    return &slot.event;
+  }
+
+  void Tracer::publish(Ring* ring, uint64_t index){
+    ring->slots[index & ring->mask].seq.store(2 * (index + 1), boost::memory_order_release);
+  }
+
+  void Tracer::complete(const char* name, uint64_t start, uint64_t dur){
+    Ring* ring = enabled() ? ring_.load(boost::memory_order_acquire) : NULL;
+    if(!ring)
+      return;
+    uint64_t index;
+    Event* e = claim(ring, index);
+    e->ts = start;
+    e->dur = dur;
+    e->name = name;
+    e->tid = threadId();
+    e->phase = 'X';
+    e->nargs = 0;
+    publish(ring, index);
+  }
+
+  void Tracer::counter(const char* name, int n, const char* const* keys, const double* values){
+    Ring* ring = enabled() ? ring_.load(boost::memory_order_acquire) : NULL;
+    if(!ring)
+      return;
+    uint64_t index;
+    Event* e = claim(ring, index);
+    e->ts = now();
+    e->dur = 0;
+    e->name = name;
+    e->tid = threadId();
+    e->phase = 'C';
+    e->nargs = n < TRACE_MAX_ARGS ? n : TRACE_MAX_ARGS;
+    for(int i = 0; i < e->nargs; ++i){
+      e->keys[i] = keys[i];
+      e->values[i] = values[i];
+    }
+    publish(ring, index);
+  }
+
+  bool Tracer::dump(const std::string& path) const {
+    FILE* f = fopen(path.c_str(), "w");
+    if(!f)
+      return false;
+
+    Ring* ring = ring_.load(boost::memory_order_acquire);
+    uint64_t head = ring ? ring->head.load(boost::memory_order_acquire) : 0;
+    uint64_t first = ring && head > ring->slots.size() ? head - ring->slots.size() : 0;
+    int pid = getpid();
+    bool comma = false;
+    fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    for(uint64_t i = first; i < head; ++i){
+      //copy the slot and keep it only if no writer touched it meanwhile, events still being written are skipped
+      const Slot& slot = ring->slots[i & ring->mask];
+      uint64_t seq = slot.seq.load(boost::memory_order_acquire);
+      Event e = slot.event;
+      boost::atomic_thread_fence(boost::memory_order_acquire);
+      if(seq != 2 * (i + 1) || slot.seq.load(boost::memory_order_relaxed) != seq)
+        continue;
+
+      fprintf(f, "%s{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":%d,\"tid\":%u",
+          comma ? ",\n" : "", e.name, e.phase, e.ts * 1e-3, pid, e.tid);
+      if(e.phase == 'X')
+        fprintf(f, ",\"dur\":%.3f}", e.dur * 1e-3);
+      else{
+        fprintf(f, ",\"id\":%u,\"args\":{", e.tid);
+        for(int a = 0; a < e.nargs; ++a)
+          fprintf(f, "%s\"%s\":%.17g", a ? "," : "", e.keys[a], e.values[a]);
+        fprintf(f, "}}");
+      }
+      comma = true;
+    }
+    fprintf(f, "\n]}\n");
+    return fclose(f) == 0;
+  }
+
+};
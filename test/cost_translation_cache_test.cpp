@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2012, Willow Garage, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Willow Garage, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <gtest/gtest.h>
+#include <navfn/cost_translation_cache.h>
+
+TEST(CostTranslationCache, translation_cache_shares_equal_maps)
+{
+  navfn::CostTranslationCache& cache = navfn::CostTranslationCache::instance();
+  cache.setCapacity( 0 );
+  cache.setCapacity( 4 );
+  unsigned int translations = cache.translations();
+
+  // two robots with their own copy of the same map
+  std::vector<COSTTYPE> a( 200 * 100, 0 ), b( a );
+  a[ 50 * 200 + 50 ] = b[ 50 * 200 + 50 ] = COST_OBS;
+
+  boost::shared_ptr<const navfn::CostSnapshot> sa = cache.get( "map", 1, &a[0], 200, 100, true );
+  boost::shared_ptr<const navfn::CostSnapshot> sb = cache.get( "map", 1, &b[0], 200, 100, true );
+  EXPECT_EQ( sa, sb );
+  EXPECT_EQ( translations + 1, cache.translations() );
+  EXPECT_EQ( COST_OBS, sa->costs[ 50 * 200 + 50 ] );
+  EXPECT_EQ( COST_OBS, sa->costs[0] ); // border
+
+  // the costmap is only read when translating, a robot clearing its own cell doesn't change the key
+  b[ 60 * 200 + 60 ] = COST_OBS;
+  EXPECT_EQ( sa, cache.get( "map", 1, &b[0], 200, 100, true ));
+
+  // a new version of the map, another map, or the same one translated differently gets its own translation
+  boost::shared_ptr<const navfn::CostSnapshot> sv = cache.get( "map", 2, &b[0], 200, 100, true );
+  EXPECT_NE( sa, sv );
+  EXPECT_EQ( COST_OBS, sv->costs[ 60 * 200 + 60 ] );
+  EXPECT_NE( sa, cache.get( "other", 1, &a[0], 200, 100, true ));
+  EXPECT_NE( sa, cache.get( "map", 1, &a[0], 200, 100, false ));
+  EXPECT_EQ( translations + 4, cache.translations() );
+
+  // a planner planning later still finds the translation
+  EXPECT_EQ( 4u, cache.size() );
+  const navfn::CostSnapshot* first = sa.get();
+  sa.reset();
+  sb.reset();
+  EXPECT_EQ( first, cache.get( "map", 1, &a[0], 200, 100, true ).get() );
+  EXPECT_EQ( translations + 4, cache.translations() );
+
+  // until newer ones push it out, least recently used first
+  cache.setCapacity( 2 );
+  EXPECT_EQ( 2u, cache.size() );
+  cache.get( "map", 2, &b[0], 200, 100, true );
+  EXPECT_EQ( translations + 5, cache.translations() );
+  cache.get( "map", 1, &a[0], 200, 100, true );
+  EXPECT_EQ( translations + 5, cache.translations() );
+  cache.get( "map", 1, &a[0], 200, 100, false );
+  EXPECT_EQ( translations + 6, cache.translations() );
+  cache.setCapacity( 0 );
+  EXPECT_EQ( 0u, cache.size() );
+}
+
+TEST(CostTranslationCache, robot_cell_is_cleared_on_top_of_a_shared_translation)
+{
+  std::vector<COSTTYPE> ros( 200 * 100, 0 );
+  ros[ 50 * 200 + 50 ] = 200;
+  boost::shared_ptr<const navfn::CostSnapshot> shared =
+      navfn::CostTranslationCache::instance().get( "robot_cell", 1, &ros[0], 200, 100, true );
+  COSTTYPE under = shared->costs[ 50 * 200 + 50 ];
+  ASSERT_GT( under, COST_NEUTRAL );
+
+  navfn::NavFn planner( 200, 100 );
+  planner.setCostArr( &shared->costs[0] );
+  planner.stampFree( 50 * 200 + 50 );
+  EXPECT_EQ( COST_NEUTRAL, planner.cellCost( 50 * 200 + 50 ));
+  EXPECT_EQ( under, shared->costs[ 50 * 200 + 50 ] );
+
+  // dynamic obstacles are stamped over the same overlay, and all of it goes when it is cleared
+  int cell = 40 * 200 + 40;
+  COSTTYPE obs = COST_OBS;
+  planner.stampOverlay( &cell, &obs, 1 );
+  EXPECT_EQ( COST_OBS, planner.cellCost( cell ));
+  planner.clearOverlay();
+  EXPECT_EQ( under, planner.cellCost( 50 * 200 + 50 ));
+  EXPECT_EQ( shared->costs[ cell ], planner.cellCost( cell ));
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2012, Willow Garage, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Willow Garage, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <gtest/gtest.h>
+#include <navfn/navfn_c.h>
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include "willow_fixture.h"
+
+namespace
+{
+  void plan_pooled( navfn_pool* pool, const std::vector<COSTTYPE>* costs, int nx, int ny, int* len )
+  {
+    int goal[2] = { 350, 450 };
+    int start[2] = { 428, 746 };
+    std::vector<float> plan( 2 * nx * ny );
+    for( int i = 0; i < 3; i++ )
+    {
+      navfn_context* ctx = navfn_pool_acquire( pool );
+      if( ctx == NULL )
+        return;
+      *len = navfn_plan( ctx, &(*costs)[0], nx, ny, 0, goal, start, &plan[0], nx * ny );
+      navfn_destroy( ctx );
+    }
+  }
+}
+
+TEST_F(WillowNav, c_api_plans_concurrently_without_touching_costs)
+{
+  std::vector<COSTTYPE> costs( nav->costarr, nav->costarr + nav->ns );
+  // no border, the planner must add its own
+  for( int x = 0; x < nav->nx; x++ )
+    costs[ x ] = COST_NEUTRAL;
+  const std::vector<COSTTYPE> original = costs;
+
+  navfn_context* ctx = navfn_create();
+  ASSERT_TRUE( ctx != NULL );
+  EXPECT_EQ( NAVFN_INVALID, navfn_set_engine( ctx, "bellman-ford" ));
+  std::vector<float> plan( 2 * nav->ns );
+  int len = navfn_plan( ctx, &costs[0], nav->nx, nav->ny, 0, goal, start, &plan[0], nav->ns );
+  EXPECT_GT( len, 0 );
+  EXPECT_TRUE( costs == original );
+  int off[2] = { -1, 0 };
+  EXPECT_EQ( NAVFN_INVALID, navfn_plan( ctx, &costs[0], nav->nx, nav->ny, 0, off, start, &plan[0], nav->ns ));
+  EXPECT_EQ( len, navfn::create_nav_plan_astar( &costs[0], nav->nx, nav->ny, goal, start, &plan[0], nav->ns ));
+
+  // a wall between start and goal
+  std::vector<COSTTYPE> walled( 10 * 10, COST_NEUTRAL );
+  for( int y = 0; y < 10; y++ )
+    walled[ y * 10 + 5 ] = COST_OBS;
+  int wgoal[2] = { 2, 5 }, wstart[2] = { 8, 5 };
+  EXPECT_EQ( NAVFN_NO_PATH, navfn_plan( ctx, &walled[0], 10, 10, 0, wgoal, wstart, &plan[0], 100 ));
+  EXPECT_NE( NAVFN_OK, NAVFN_NO_PATH );
+  navfn_destroy( ctx );
+
+  // threads sharing a pool of two all get the same plan
+  navfn_pool* pool = navfn_pool_create( 2, 8, 10.0 );
+  ASSERT_TRUE( pool != NULL );
+  std::vector<int> lens( 4, 0 );
+  boost::thread_group threads;
+  for( int t = 0; t < 4; t++ )
+    threads.create_thread( boost::bind( &plan_pooled, pool, &costs, nav->nx, nav->ny, &lens[ t ] ));
+  threads.join_all();
+  for( int t = 0; t < 4; t++ )
+    EXPECT_EQ( len, lens[ t ] );
+  navfn_pool_destroy( pool );
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
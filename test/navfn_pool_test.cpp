@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2012, Willow Garage, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Willow Garage, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <gtest/gtest.h>
+#include <ros/ros.h>
+#include <navfn/navfn_ros.h>
+#include <costmap_2d/cost_values.h>
+#include <boost/atomic.hpp>
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include <float.h>
+
+namespace
+{
+  geometry_msgs::PoseStamped pose( double x, double y )
+  {
+    geometry_msgs::PoseStamped p;
+    p.header.frame_id = "map";
+    p.pose.position.x = x;
+    p.pose.position.y = y;
+    p.pose.orientation.w = 1.0;
+    return p;
+  }
+
+  // plans from the left half of the map to the right half, around the wall
+  void plan_many( navfn::NavfnROS* planner, int seed, int* found )
+  {
+    for( int i = 0; i < 10; i++ )
+    {
+      std::vector<geometry_msgs::PoseStamped> plan;
+      if( planner->makePlan( pose( 1.0 + seed, 1.0 + i * 0.5 ), pose( 8.0, 8.0 - seed ), plan ) && !plan.empty() )
+        ++*found;
+    }
+  }
+
+  // a wall at x = 5m that comes and goes, like a costmap update thread would
+  void update_costmap( costmap_2d::Costmap2D* costmap, boost::atomic<bool>* stop )
+  {
+    for( int i = 0; !*stop; i++ )
+    {
+      {
+        boost::unique_lock<costmap_2d::Costmap2D::mutex_t> lock( *costmap->getMutex() );
+        for( unsigned int y = 0; y < 150; y++ )
+          costmap->setCost( 100, y, i % 2 ? costmap_2d::LETHAL_OBSTACLE : costmap_2d::FREE_SPACE );
+      }
+      boost::this_thread::sleep( boost::posix_time::milliseconds( 1 ));
+    }
+  }
+}
+
+// ~navfn/planner_pool_size comes from navfn_pool.test
+TEST(NavfnROSPool, concurrent_plans_while_the_costmap_changes)
+{
+  costmap_2d::Costmap2D costmap( 200, 200, 0.05, 0.0, 0.0 );
+  navfn::NavfnROS planner( "navfn", &costmap, "map" );
+
+  boost::atomic<bool> stop( false );
+  boost::thread updater( boost::bind( &update_costmap, &costmap, &stop ));
+  std::vector<int> found( 4, 0 );
+  boost::thread_group threads;
+  for( int t = 0; t < 4; t++ )
+    threads.create_thread( boost::bind( &plan_many, &planner, t, &found[ t ] ));
+  threads.join_all();
+  stop = true;
+  updater.join();
+
+  for( int t = 0; t < 4; t++ )
+    EXPECT_EQ( 10, found[ t ] ) << "thread " << t;
+}
+
+TEST(NavfnROSPool, potential_queries_need_compute_potential)
+{
+  costmap_2d::Costmap2D costmap( 200, 200, 0.05, 0.0, 0.0 );
+  navfn::NavfnROS planner( "navfn", &costmap, "map" );
+  geometry_msgs::Point p;
+  p.x = 5.0;
+  p.y = 5.0;
+
+  // makePlan() propagates on a leased planner, so it leaves nothing to query
+  std::vector<geometry_msgs::PoseStamped> plan;
+  ASSERT_TRUE( planner.makePlan( pose( 1.0, 1.0 ), pose( 8.0, 8.0 ), plan ));
+  EXPECT_FALSE( planner.validPointPotential( p ));
+  EXPECT_EQ( DBL_MAX, planner.getPointPotential( p ));
+
+  // propagates over the whole map, the corner cell it aims for is part of the border
+  planner.computePotential( p );
+  EXPECT_TRUE( planner.validPointPotential( p ));
+  EXPECT_LT( planner.getPointPotential( p ), DBL_MAX );
+}
+
+int main( int argc, char** argv )
+{
+  testing::InitGoogleTest( &argc, argv );
+  ros::init( argc, argv, "navfn_pool_test" );
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2012, Willow Garage, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Willow Garage, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string>
+#include <fstream>
+#include <ros/package.h>
+#include <gtest/gtest.h>
+#include <navfn/navfn.h>
+#include <navfn/map_generator.h>
+#include <navfn/pgm_map.h>
+#include <navfn/read_pgm_costmap.h>
+
+TEST(NavfnTools, generated_maps_are_seeded_and_solvable)
+{
+  navfn::MapGenerator::Options opts;
+  opts.width = 300;
+  opts.height = 200;
+  opts.density = 0.5;
+  opts.layout = navfn::MapGenerator::MAZE;
+
+  std::vector<unsigned char> a, b;
+  std::vector<int> pa, pb;
+  navfn::MapGenerator( 7 ).generate( opts, a );
+  navfn::MapGenerator gen( 7 );
+  gen.generate( opts, b );
+  EXPECT_TRUE( a == b );
+  EXPECT_EQ( 4, gen.sampleProblems( b, opts.width, opts.height, 4, 50.0, pb ));
+  opts.density = 0.2;
+  navfn::MapGenerator( 8 ).generate( opts, a );
+  EXPECT_FALSE( a == b );
+
+  // every sampled pair can be planned
+  navfn::NavFn nav( opts.width, opts.height );
+  nav.setCostmap( &b[0], true, true );
+  for( unsigned int i = 0; i < pb.size(); i += 4 )
+  {
+    EXPECT_LT( b[ pb[ i+1 ] * opts.width + pb[ i ]], COST_OBS_ROS );
+    int start[2] = { pb[ i ], pb[ i+1 ] };
+    int goal[2] = { pb[ i+2 ], pb[ i+3 ] };
+    nav.setStart( start );
+    nav.setGoal( goal );
+    EXPECT_TRUE( nav.calcNavFnDijkstra( true )) << "pair " << i / 4;
+  }
+}
+
+TEST(NavfnTools, pgm_map_reads_without_netpbm)
+{
+  // the willow map is 8-bit binary, used in place and read the same by readPGM
+  navfn::PgmMap pgm;
+  std::string willow = ros::package::getPath( ROS_PACKAGE_NAME ) + "/test/willow_costmap.pgm";
+  ASSERT_TRUE( pgm.open( willow ));
+  EXPECT_TRUE( pgm.mapped() );
+  int sx, sy;
+  COSTTYPE *cmap = readPGM( willow.c_str(), &sx, &sy, true );
+  ASSERT_TRUE( cmap != NULL );
+  EXPECT_EQ( pgm.width(), sx );
+  EXPECT_EQ( pgm.height(), sy );
+  EXPECT_EQ( 0, memcmp( cmap, pgm.data(), sx*sy ));
+  free( cmap );
+
+  // comments in the header, plain images and 16-bit samples
+  std::string path = testing::TempDir() + "navfn_pgm_map.pgm";
+  std::ofstream( path.c_str() ) << "P2\n# a comment\n3 2 # another\n255\n0 1 2\n253 254 255\n";
+  ASSERT_TRUE( pgm.open( path ));
+  EXPECT_FALSE( pgm.mapped() );
+  EXPECT_EQ( 3, pgm.width() );
+  EXPECT_EQ( 254, pgm.data()[ 4 ] );
+  std::ofstream( path.c_str(), std::ios::binary ) << "P5 2 1 65535\n" << std::string( "\xff\xff\x80\x00", 4 );
+  ASSERT_TRUE( pgm.open( path ));
+  EXPECT_EQ( 255, pgm.data()[ 0 ] );
+  EXPECT_EQ( 128, pgm.data()[ 1 ] );
+
+  // truncated
+  std::ofstream( path.c_str(), std::ios::binary ) << "P5 4 4 255\n" << std::string( 15, '\0' );
+  EXPECT_FALSE( pgm.open( path ));
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -27,32 +27,10 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
-#include <string>
-#include <ros/package.h>
 #include <gtest/gtest.h>
 #include <navfn/navfn.h>
-#include <navfn/read_pgm_costmap.h>
-
-// Load a willow garage costmap and return a NavFn instance using it.
-// If the costmap file fails to load, returns NULL.
-navfn::NavFn* make_willow_nav()
-{
-  int sx,sy;
-  std::string path = ros::package::getPath( ROS_PACKAGE_NAME ) + "/test/willow_costmap.pgm";
-
-  COSTTYPE *cmap = readPGM( path.c_str(), &sx, &sy, true );
-  if( cmap == NULL )
-  {
-    return NULL;
-  }
-  navfn::NavFn* nav = new navfn::NavFn(sx,sy);
-
-  nav->priInc = 2*COST_NEUTRAL;	// thin wavefront
-
-  memcpy( nav->costarr, cmap, sx*sy );
-
-  return nav;
-}
+#include <navfn/navfn_pool.h>
+#include "willow_fixture.h"
 
 void print_neighborhood_of_last_path_entry( navfn::NavFn* nav )  
 {
@@ -108,23 +86,8 @@ void print_neighborhood_of_last_path_entry( navfn::NavFn* nav )
   }
 }
 
-TEST(PathCalc, oscillate_in_pinch_point)
+TEST_F(WillowNav, oscillate_in_pinch_point)
 {
-  navfn::NavFn* nav = make_willow_nav();
-  ASSERT_TRUE( nav != NULL );
-
-  int goal[2];
-  int start[2];
-
-  start[0] = 428;
-  start[1] = 746;
-  
-  goal[0] = 350;
-  goal[1] = 450;
-
-  nav->setGoal( goal );
-  nav->setStart( start );
-
   bool plan_success = nav->calcNavFnDijkstra( true );
   EXPECT_TRUE( plan_success );
   if( !plan_success )
@@ -133,26 +96,257 @@ TEST(PathCalc, oscillate_in_pinch_point)
   }
 }
 
-TEST(PathCalc, easy_nav_should_always_work)
+TEST_F(WillowNav, easy_nav_should_always_work)
 {
-  navfn::NavFn* nav = make_willow_nav();
-  ASSERT_TRUE( nav != NULL );
-
-  int goal[2];
-  int start[2];
-
   start[0] = 350;
   start[1] = 400;
-
-  goal[0] = 350;
-  goal[1] = 450;
-
-  nav->setGoal( goal );
   nav->setStart( start );
 
   EXPECT_TRUE( nav->calcNavFnDijkstra( true ));
 }
 
+TEST_F(WillowPlan, pooled_planners_share_cost_array)
+{
+  // the shared array must already carry the border setupNavFn would have written
+  std::vector<COSTTYPE> shared( nav->costarr, nav->costarr + nav->ns );
+  navfn::NavFn::setObsBorder( &shared[0], nav->nx, nav->ny );
+
+  navfn::NavFnPool pool( 2, 0, 0.0 );
+  boost::shared_ptr<navfn::NavFn> a = pool.acquire();
+  boost::shared_ptr<navfn::NavFn> b = pool.acquire();
+  ASSERT_TRUE( a && b );
+  EXPECT_FALSE( pool.acquire() ); // no queue, so a third request is turned away
+  EXPECT_EQ( 1u, pool.rejected() );
+
+  navfn::NavFn* leased[2] = { a.get(), b.get() };
+  for( int i = 0; i < 2; i++ )
+  {
+    leased[ i ]->setNavArr( nav->nx, nav->ny );
+    leased[ i ]->setCostArr( &shared[0] );
+    leased[ i ]->priInc = nav->priInc;
+    leased[ i ]->setGoal( goal );
+    leased[ i ]->setStart( start );
+    ASSERT_TRUE( leased[ i ]->calcNavFnDijkstra( true ));
+    ASSERT_EQ( nav->npath, leased[ i ]->npath );
+    EXPECT_EQ( 0, memcmp( nav->pathx, leased[ i ]->pathx, nav->npath * sizeof(float) ));
+    EXPECT_EQ( 0, memcmp( nav->pathy, leased[ i ]->pathy, nav->npath * sizeof(float) ));
+  }
+
+  a.reset();
+  EXPECT_EQ( 1, pool.busy() );
+  b.reset();
+}
+
+TEST_F(WillowPlan, simplified_path_keeps_clearance)
+{
+  int len = nav->npath;
+  float first[2] = { nav->pathx[0], nav->pathy[0] };
+  float last[2] = { nav->pathx[len-1], nav->pathy[len-1] };
+  int maxcost = 0;
+  for( int i = 0; i < len; i++ )
+  {
+    int k = (int)(nav->pathy[ i ] + 0.5) * nav->nx + (int)(nav->pathx[ i ] + 0.5);
+    maxcost = std::max( maxcost, (int)nav->costarr[ k ]);
+  }
+
+  // one point every two cells
+  EXPECT_GT( len, nav->simplifyPath( 2.0 ));
+  EXPECT_EQ( first[0], nav->pathx[0] );
+  EXPECT_EQ( first[1], nav->pathy[0] );
+  EXPECT_EQ( last[0], nav->pathx[ nav->npath-1 ] );
+  EXPECT_EQ( last[1], nav->pathy[ nav->npath-1 ] );
+  for( int i = 1; i < nav->npath; i++ )
+  {
+    float step = hypot( nav->pathx[ i ] - nav->pathx[ i-1 ], nav->pathy[ i ] - nav->pathy[ i-1 ]);
+    EXPECT_LE( step, 2.0 + 1e-3 );
+    EXPECT_TRUE( nav->lineOfSight( nav->pathx[ i-1 ], nav->pathy[ i-1 ], nav->pathx[ i ], nav->pathy[ i ], maxcost ));
+  }
+}
+
+TEST_F(WillowPlan, dense_gradient_matches_lazy_gradient)
+{
+  navfn::NavFn* lazy = nav;
+  navfn::NavFn* dense = make_willow_nav();
+  ASSERT_TRUE( dense != NULL );
+  dense->denseGrad = true;
+  dense->setGoal( goal );
+  dense->setStart( start );
+  ASSERT_TRUE( dense->calcNavFnDijkstra( true ));
+  EXPECT_TRUE( dense->gradField );
+
+  // every gradient the lazy planner needed is in the dense field, up to rounding
+  for( int k = dense->gradLo * dense->nx; k < ( dense->gradHi + 1 ) * dense->nx; k++ )
+  {
+    if( lazy->gradx[ k ] == 0.0 && lazy->grady[ k ] == 0.0 )
+      continue;
+    EXPECT_NEAR( lazy->gradx[ k ], dense->gradx[ k ], 1e-5 );
+    EXPECT_NEAR( lazy->grady[ k ], dense->grady[ k ], 1e-5 );
+  }
+
+  ASSERT_NEAR( lazy->npath, dense->npath, 2 );
+  int n = std::min( lazy->npath, dense->npath );
+  EXPECT_NEAR( lazy->pathx[ n-1 ], dense->pathx[ n-1 ], 1.0 );
+  EXPECT_NEAR( lazy->pathy[ n-1 ], dense->pathy[ n-1 ], 1.0 );
+  delete dense;
+}
+
+TEST_F(WillowNav, costmap_view_matches_copied_costmap)
+{
+  navfn::NavFn* copy = nav;
+
+  // turn the planner costs back into a ROS costmap, with unknown space
+  std::vector<COSTTYPE> ros( copy->ns );
+  for( int i = 0; i < copy->ns; i++ )
+  {
+    int c = copy->costarr[ i ];
+    ros[ i ] = c >= COST_OBS ? COST_OBS : c == COST_OBS-1 ? COST_UNKNOWN_ROS : ( c - COST_NEUTRAL ) / COST_FACTOR;
+  }
+  std::vector<COSTTYPE> untouched = ros;
+
+  navfn::NavFn view( copy->nx, copy->ny );
+  view.priInc = copy->priInc;
+  copy->setCostmap( &ros[0], true, true );
+  view.setCostmapView( &ros[0], true );
+
+  view.setGoal( goal );
+  view.setStart( start );
+  ASSERT_TRUE( copy->calcNavFnDijkstra( true ));
+  ASSERT_TRUE( view.calcNavFnDijkstra( true ));
+
+  EXPECT_TRUE( ros == untouched );
+  EXPECT_EQ( copy->nobs, view.nobs );
+  EXPECT_EQ( 0, memcmp( copy->potarr, view.potarr, copy->ns * sizeof(float) ));
+  ASSERT_EQ( copy->npath, view.npath );
+  EXPECT_EQ( 0, memcmp( copy->pathx, view.pathx, copy->npath * sizeof(float) ));
+  EXPECT_EQ( 0, memcmp( copy->pathy, view.pathy, copy->npath * sizeof(float) ));
+}
+
+TEST_F(WillowNav, costmap_update_translates_dirty_tiles)
+{
+  std::vector<COSTTYPE> ros( nav->ns );
+  for( int i = 0; i < nav->ns; i++ )
+  {
+    int c = nav->costarr[ i ];
+    ros[ i ] = c >= COST_OBS ? COST_OBS : c == COST_OBS-1 ? COST_UNKNOWN_ROS : ( c - COST_NEUTRAL ) / COST_FACTOR;
+  }
+
+  int ntiles = ( nav->nx + COST_TILE-1 ) / COST_TILE * (( nav->ny + COST_TILE-1 ) / COST_TILE );
+  EXPECT_EQ( ntiles, nav->updateCostmap( &ros[0] ));
+  EXPECT_EQ( 0, nav->updateCostmap( &ros[0] ));
+
+  // some inflation straddling two tiles of the same row
+  int x = 3 * COST_TILE - 2, y = 5 * COST_TILE + 10;
+  for( int i = 0; i < 4; i++ )
+    ros[ y * nav->nx + x + i ] = 100;
+  ASSERT_EQ( 2, nav->updateCostmap( &ros[0] ));
+  int tx = nav->tilesX;
+  EXPECT_EQ( 5 * tx + 2, nav->dirtyTiles[0] );
+  EXPECT_EQ( 5 * tx + 3, nav->dirtyTiles[1] );
+
+  navfn::NavFn full( nav->nx, nav->ny );
+  full.setCostmap( &ros[0] );
+  EXPECT_EQ( 0, memcmp( full.costarr, nav->costarr, nav->ns ));
+
+  // a streamed update only translates its own rectangle
+  for( int i = 0; i < 4; i++ )
+    ros[( y + i ) * nav->nx + x ] = 120;
+  nav->translateRegion( &ros[0], x, y, x + 1, y + 4 );
+  full.setCostmap( &ros[0] );
+  EXPECT_EQ( 0, memcmp( full.costarr, nav->costarr, nav->ns ));
+
+  // replacing the cost array forgets the fingerprints
+  nav->setCostmap( &ros[0] );
+  EXPECT_EQ( ntiles, nav->updateCostmap( &ros[0] ));
+}
+
+TEST_F(WillowNav, overlay_is_restored_and_never_written_through)
+{
+  navfn::NavFn::setObsBorder( nav->costarr, nav->nx, nav->ny );
+  std::vector<COSTTYPE> shared( nav->costarr, nav->costarr + nav->ns );
+
+  navfn::NavFn planner( nav->nx, nav->ny );
+  planner.priInc = nav->priInc;
+  planner.setCostArr( &shared[0] );
+
+  planner.setGoal( goal );
+  planner.setStart( start );
+  ASSERT_TRUE( planner.calcNavFnDijkstra( true ));
+  float free_cost = planner.potarr[ start[1] * planner.nx + start[0] ];
+
+  // a blob in the middle of the path
+  int mid = planner.npath / 2;
+  int cx = (int)planner.pathx[ mid ], cy = (int)planner.pathy[ mid ];
+  std::vector<int> cells;
+  for( int y = cy - 3; y <= cy + 3; y++ )
+    for( int x = cx - 3; x <= cx + 3; x++ )
+      cells.push_back( y * planner.nx + x );
+  std::vector<COSTTYPE> costs( cells.size(), COST_OBS );
+  planner.stampOverlay( &cells[0], &costs[0], cells.size() );
+  planner.stampOverlay( &cells[0], &costs[0], cells.size() );
+  EXPECT_TRUE( planner.costarr_shared );
+  EXPECT_EQ( &shared[0], planner.costarr );
+  EXPECT_EQ( (int)cells.size(), planner.novl );
+  EXPECT_EQ( COST_OBS, planner.cellCost( cy * planner.nx + cx ));
+  EXPECT_EQ( 0, memcmp( &shared[0], nav->costarr, nav->ns ));
+
+  ASSERT_TRUE( planner.calcNavFnDijkstra( true ));
+  EXPECT_GT( planner.potarr[ start[1] * planner.nx + start[0] ], free_cost );
+
+  planner.clearOverlay();
+  EXPECT_EQ( 0, planner.novl );
+  EXPECT_EQ( nav->costarr[ cy * planner.nx + cx ], planner.cellCost( cy * planner.nx + cx ));
+  ASSERT_TRUE( planner.calcNavFnDijkstra( true ));
+  EXPECT_FLOAT_EQ( free_cost, planner.potarr[ start[1] * planner.nx + start[0] ] );
+
+  // a view is not copied either
+  std::vector<COSTTYPE> ros( nav->ns, 0 );
+  navfn::NavFn viewer( nav->nx, nav->ny );
+  viewer.setCostmapView( &ros[0] );
+  viewer.stampOverlay( &cells[0], &costs[0], cells.size() );
+  EXPECT_TRUE( viewer.costview );
+  EXPECT_EQ( COST_OBS, viewer.cellCost( cy * planner.nx + cx ));
+  EXPECT_EQ( 0, ros[ cy * planner.nx + cx ] );
+}
+
+TEST_F(WillowPlan, ring_search_finds_closest_reachable_cell)
+{
+  // compare with scanning the whole square, in row order
+  int queries[][3] = { { 428, 746, 0 }, { 300, 300, 40 }, { 600, 900, 25 }, { 5, 5, 30 }, { -20, 460, 40 }, { 800, 200, 3 } };
+  for( unsigned int q = 0; q < sizeof( queries ) / sizeof( queries[0] ); q++ )
+  {
+    int x = queries[ q ][0], y = queries[ q ][1], r = queries[ q ][2];
+    long bd2 = -1;
+    int expected[2] = { 0, 0 };
+    for( int j = std::max( y - r, 0 ); j <= std::min( y + r, nav->ny - 1 ); j++ )
+      for( int i = std::max( x - r, 0 ); i <= std::min( x + r, nav->nx - 1 ); i++ )
+      {
+        long d2 = (long)( i - x ) * ( i - x ) + (long)( j - y ) * ( j - y );
+        if( nav->potarr[ j * nav->nx + i ] < POT_HIGH && ( bd2 < 0 || d2 < bd2 ))
+        {
+          bd2 = d2;
+          expected[0] = i;
+          expected[1] = j;
+        }
+      }
+
+    int best[2];
+    ASSERT_EQ( bd2 >= 0, nav->nearestReachable( x, y, r, best )) << "query " << q;
+    if( bd2 >= 0 )
+    {
+      EXPECT_EQ( expected[0], best[0] ) << "query " << q;
+      EXPECT_EQ( expected[1], best[1] ) << "query " << q;
+    }
+  }
+}
+
+TEST_F(WillowPlan, propagation_counters_are_filled_in)
+{
+  EXPECT_GT( nav->propCycles, 0 );
+  EXPECT_GT( nav->propCells, nav->propCycles );
+  EXPECT_GT( nav->propMaxBuf, 0 );
+  EXPECT_LE( nav->propMaxBuf, nav->propCells );
+}
+
 int main(int argc, char **argv)
 {
   testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2012, Willow Garage, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Willow Garage, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <dirent.h>
+#include <gtest/gtest.h>
+#include <navfn/plan_recorder.h>
+#include "willow_fixture.h"
+
+TEST_F(WillowPlan, plan_recorder_keeps_a_ring)
+{
+  std::string dir = testing::TempDir() + "navfn_recordings";
+  navfn::PlanRecorder every_third( dir, 2, 3, 0.0, navfn::SNAPSHOT_PATH );
+  navfn::PlanRecorder slow( dir, 2, 0, 0.5, navfn::SNAPSHOT_PATH );
+  int wanted = 0;
+  for( int i = 0; i < 9; i++ )
+    wanted += every_third.wants( 0.0 );
+  EXPECT_EQ( 3, wanted );
+  EXPECT_FALSE( slow.wants( 0.4 ));
+  EXPECT_TRUE( slow.wants( 0.6 ));
+
+  // three recordings into a ring of two
+  navfn::SnapshotInfo info;
+  for( int i = 0; i < 3; i++ )
+    every_third.record( *nav, info, NULL );
+  EXPECT_EQ( 3u, every_third.recorded() );
+  int files = 0;
+  DIR* d = opendir( dir.c_str() );
+  ASSERT_TRUE( d != NULL );
+  for( struct dirent* entry; ( entry = readdir( d )) != NULL; )
+    files += std::string( entry->d_name ).find( ".navfn" ) != std::string::npos;
+  closedir( d );
+  EXPECT_EQ( 2, files );
+
+  navfn::PlanningSnapshot snap;
+  ASSERT_TRUE( snap.open( dir + "/plan_0000.navfn" ));
+  EXPECT_EQ( nav->npath, snap.info().path_len );
+  EXPECT_TRUE( snap.potential() == NULL );
+
+  // a recording of a planner viewing a ROS costmap replays too
+  std::vector<COSTTYPE> ros( 40 * 30, 0 );
+  navfn::NavFn view( 40, 30 );
+  view.setCostmapView( &ros[0], true );
+  int near[2] = { 5, 5 };
+  int far[2] = { 30, 20 };
+  view.setGoal( near );
+  view.setStart( far );
+  ASSERT_TRUE( view.calcNavFnDijkstra( true ));
+  navfn::PlanRecorder single( dir, 1, 1, 0.0, 0 );
+  single.record( view, info, NULL );
+  ASSERT_TRUE( snap.open( dir + "/plan_0000.navfn" ));
+  ASSERT_TRUE( snap.rawCosts() != NULL );
+  navfn::NavFn replay( 40, 30 );
+  ASSERT_TRUE( snap.restore( replay ));
+  EXPECT_TRUE( replay.calcNavFnDijkstra( true ));
+  EXPECT_EQ( view.npath, replay.npath );
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) 2012, Willow Garage, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Willow Garage, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <gtest/gtest.h>
+#include <navfn/plan_stats.h>
+
+TEST(PlanStats, latency_histogram_percentiles)
+{
+  navfn::LatencyHistogram hist;
+  EXPECT_EQ( 0.0, hist.percentile( 0.99 ));
+
+  // 1 to 10000 microseconds, every value once
+  for( int us = 1; us <= 10000; us++ )
+    hist.record( us * 1e-6 );
+  EXPECT_EQ( 10000u, hist.count() );
+  EXPECT_DOUBLE_EQ( 0.01, hist.max() );
+  EXPECT_NEAR( 5000.5e-6, hist.mean(), 1e-9 );
+  EXPECT_NEAR( 0.005, hist.percentile( 0.5 ), 0.005 / 32 );
+  EXPECT_NEAR( 0.0099, hist.percentile( 0.99 ), 0.0099 / 32 );
+  EXPECT_GE( hist.percentile( 0.99 ), 0.0099 );
+  EXPECT_DOUBLE_EQ( 0.01, hist.percentile( 1.0 ));
+  EXPECT_DOUBLE_EQ( 1e-6, hist.percentile( 0.0 ));
+
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2012, Willow Garage, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Willow Garage, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <gtest/gtest.h>
+#include <navfn/planner_engine.h>
+#include <navfn/planning_session.h>
+#include "willow_fixture.h"
+
+TEST_F(WillowNav, engines_are_selected_by_name)
+{
+  navfn::EngineRegistry& registry = navfn::EngineRegistry::instance();
+  EXPECT_TRUE( registry.get( "bellman-ford" ) == NULL );
+  boost::shared_ptr<const navfn::PlannerEngine> dijkstra = registry.get( "dijkstra" );
+  boost::shared_ptr<const navfn::PlannerEngine> astar = registry.get( "astar" );
+  ASSERT_TRUE( dijkstra && astar );
+  EXPECT_STREQ( "astar", astar->name() );
+
+  // both reach the start, A* through fewer cells
+  int cells[2];
+  for( int i = 0; i < 2; i++ )
+  {
+    nav->setupNavFn( true );
+    EXPECT_TRUE(( i == 0 ? dijkstra : astar )->propagate( *nav ));
+    EXPECT_LT( nav->potarr[ start[1] * nav->nx + start[0] ], POT_HIGH );
+    EXPECT_GT( nav->calcPath( nav->nx * 4 ), 0 );
+    cells[ i ] = nav->propCells;
+  }
+  EXPECT_LT( cells[1], cells[0] );
+}
+
+TEST_F(WillowNav, planning_session_resumes_across_slices)
+{
+  navfn::NavFn whole( nav->nx, nav->ny );
+  whole.setCostArr( nav->costarr );
+  whole.setGoal( goal );
+  whole.setStart( start );
+
+  const char* engines[] = { "dijkstra", "astar" };
+  for( int e = 0; e < 2; e++ )
+  {
+    // many tiny slices end up where one uninterrupted propagation does
+    ASSERT_TRUE( e == 0 ? whole.calcNavFnDijkstra( true ) : whole.calcNavFnAstar() );
+    navfn::PlanningSession session( *nav, navfn::EngineRegistry::instance().get( engines[ e ] ));
+    session.begin();
+    int slices = 0;
+    while( !session.step( 0.0001 ))
+      slices++;
+    EXPECT_GT( slices, 2 ) << engines[ e ];
+    EXPECT_TRUE( session.step( 0.0001 ));
+    EXPECT_EQ( whole.propCycles, session.cycles() ) << engines[ e ];
+    EXPECT_EQ( 0, memcmp( whole.potarr, nav->potarr, nav->ns * sizeof(float) )) << engines[ e ];
+    ASSERT_TRUE( session.finish() );
+    EXPECT_EQ( whole.npath, nav->npath ) << engines[ e ];
+  }
+
+  // the setup is spread over the steps as well, one without a budget resets a chunk of rows and propagates nothing
+  navfn::PlanningSession chunked( *nav );
+  chunked.begin();
+  nav->potarr[ nav->ns - 1 ] = 0.0;
+  EXPECT_FALSE( chunked.step( 0.0 ));
+  EXPECT_EQ( 0.0, nav->potarr[ nav->ns - 1 ] );
+  EXPECT_EQ( 0, chunked.cycles() );
+  EXPECT_TRUE( chunked.finish() );
+  EXPECT_EQ( whole.nobs, nav->nobs );
+
+  // finish() completes a propagation that was never stepped
+  navfn::PlanningSession session( *nav );
+  session.begin();
+  EXPECT_TRUE( session.finish() );
+  EXPECT_TRUE( session.propagated() );
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2012, Willow Garage, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Willow Garage, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <fstream>
+#include <gtest/gtest.h>
+#include <navfn/planning_snapshot.h>
+#include "willow_fixture.h"
+
+TEST_F(WillowPlan, planning_snapshot_roundtrip)
+{
+  navfn::SnapshotInfo info;
+  info.tolerance = 0.5;
+  info.resolution = 0.05;
+  std::string path = testing::TempDir() + "navfn_snapshot.bin";
+  for( int lz4 = 0; lz4 <= navfn::SNAPSHOT_LZ4; lz4 += navfn::SNAPSHOT_LZ4 )
+  {
+    ASSERT_TRUE( navfn::PlanningSnapshot::save( path, info, NULL, *nav,
+                                                navfn::SNAPSHOT_POTENTIAL | navfn::SNAPSHOT_PATH | lz4 ));
+    navfn::PlanningSnapshot snap;
+    ASSERT_TRUE( snap.open( path ));
+    EXPECT_EQ( nav->nx, snap.info().nx );
+    EXPECT_EQ( 350, snap.info().goal[0] );
+    EXPECT_EQ( 0.5, snap.info().tolerance );
+    EXPECT_TRUE( snap.rawCosts() == NULL );
+    ASSERT_TRUE( snap.costs() != NULL && snap.potential() != NULL && snap.pathY() != NULL );
+    EXPECT_EQ( 0, memcmp( nav->costarr, snap.costs(), nav->ns * sizeof(COSTTYPE) ));
+    EXPECT_EQ( 0, memcmp( nav->potarr, snap.potential(), nav->ns * sizeof(float) ));
+    EXPECT_EQ( nav->npath, snap.info().path_len );
+    EXPECT_EQ( nav->pathy[ nav->npath - 1 ], snap.pathY()[ nav->npath - 1 ] );
+
+    // the restored problem plans the same path
+    navfn::NavFn replay( snap.info().nx, snap.info().ny );
+    ASSERT_TRUE( snap.restore( replay ));
+    ASSERT_TRUE( replay.calcNavFnDijkstra( true ));
+    EXPECT_EQ( nav->npath, replay.npath );
+    EXPECT_EQ( 0, memcmp( nav->potarr, replay.potarr, nav->ns * sizeof(float) ));
+  }
+
+  // a planner viewing a ROS costmap has no border in its costs, the snapshot gets one all the same
+  std::vector<COSTTYPE> ros( 40 * 30, 0 );
+  navfn::NavFn view( 40, 30 );
+  view.setCostmapView( &ros[0], true );
+  int near[2] = { 5, 5 };
+  int far[2] = { 30, 20 };
+  view.setGoal( near );
+  view.setStart( far );
+  ASSERT_TRUE( view.calcNavFnDijkstra( true ));
+  ASSERT_TRUE( navfn::PlanningSnapshot::save( path, info, &ros[0], view, 0 ));
+  navfn::PlanningSnapshot snap;
+  ASSERT_TRUE( snap.open( path ));
+  EXPECT_EQ( COST_OBS, snap.costs()[ 39 ] );
+  navfn::NavFn replay( 40, 30 );
+  ASSERT_TRUE( snap.restore( replay ));
+  EXPECT_TRUE( replay.calcNavFnDijkstra( true ));
+  EXPECT_EQ( view.npath, replay.npath );
+  snap.close();
+
+  // sections that don't match the header, and anything else, are refused
+  std::fstream header( path.c_str(), std::ios::in | std::ios::out | std::ios::binary );
+  int32_t wider = 80;
+  header.seekp( 24 ); // nx, after the magic, byte order, version and table layout
+  header.write( (const char*)&wider, sizeof( wider ));
+  header.close();
+  EXPECT_FALSE( snap.open( path ));
+  std::ofstream( path.c_str() ) << "P5 not a snapshot";
+  EXPECT_FALSE( snap.open( path ));
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
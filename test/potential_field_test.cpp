@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2012, Willow Garage, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Willow Garage, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <gtest/gtest.h>
+#include <navfn/potential_field.h>
+#include "willow_fixture.h"
+
+TEST_F(WillowPlan, potential_field_batch_sampling)
+{
+  navfn::PotentialField field;
+  field.copyFrom( *nav, -10.0, 5.0, 0.05 );
+
+  // cell centers along the path, a point off the map and one in an unreached cell
+  std::vector<float> wx, wy;
+  std::vector<int> cells;
+  for( int i = 0; i < nav->npath; i += nav->npath / 8 )
+  {
+    int x = (int)nav->pathx[ i ], y = (int)nav->pathy[ i ];
+    cells.push_back( y * nav->nx + x );
+    wx.push_back( -10.0 + ( x + 0.5 ) * 0.05 );
+    wy.push_back( 5.0 + ( y + 0.5 ) * 0.05 );
+  }
+  wx.push_back( -20.0 ); wy.push_back( 0.0 ); cells.push_back( -1 );
+  wx.push_back( -10.0 + 0.5 * 0.05 ); wy.push_back( 5.0 + 0.5 * 0.05 ); cells.push_back( 0 );
+  unsigned int n = wx.size();
+
+  std::vector<float> nearest( n ), smooth( n ), gx( n ), gy( n );
+  field.sample( &wx[0], &wy[0], n, &nearest[0] );
+  field.sample( &wx[0], &wy[0], n, &smooth[0], true, &gx[0], &gy[0] );
+  for( unsigned int i = 0; i < n; i++ )
+  {
+    float expected = cells[ i ] < 0 ? POT_HIGH : nav->potarr[ cells[ i ]];
+    EXPECT_EQ( expected, nearest[ i ] ) << "point " << i;
+    EXPECT_NEAR( expected, smooth[ i ], 1e-2 * std::max( 1.0f, expected )) << "point " << i;
+  }
+  EXPECT_EQ( 0.0f, gx[ n-2 ] );
+  EXPECT_EQ( 0.0f, gy[ n-2 ] );
+
+  // halfway between two reached cell centers, with the gradient between them
+  int k = cells[1];
+  ASSERT_LT( nav->potarr[ k+1 ], POT_HIGH );
+  ASSERT_LT( nav->potarr[ k+nav->nx ], POT_HIGH );
+  ASSERT_LT( nav->potarr[ k+nav->nx+1 ], POT_HIGH );
+  float mx = wx[1] + 0.025f, my = wy[1];
+  float p, dx, dy;
+  field.sample( &mx, &my, 1, &p, true, &dx, &dy );
+  EXPECT_NEAR(( nav->potarr[ k ] + nav->potarr[ k+1 ] ) / 2, p, 1e-2 );
+  EXPECT_NEAR(( nav->potarr[ k+1 ] - nav->potarr[ k ] ) / 0.05, dx, 1.0 );
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
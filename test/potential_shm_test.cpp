@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2012, Willow Garage, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Willow Garage, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <gtest/gtest.h>
+#include <navfn/navfn.h>
+#include <navfn/potential_shm.h>
+
+TEST(PotentialShm, potential_shm_double_buffers_the_latest_potential)
+{
+  std::string name = "/navfn_test_potential";
+  navfn::PotentialShmWriter writer;
+  ASSERT_TRUE( writer.open( name, 4 ));
+  navfn::PotentialShmReader reader;
+  ASSERT_TRUE( reader.open( name ));
+  navfn::PotentialShmReader::View view;
+  EXPECT_FALSE( reader.latest( view ));
+
+  navfn::PotentialInfo info;
+  info.nx = 2;
+  info.ny = 2;
+  info.resolution = 0.05;
+  memset( info.frame_id, 'm', sizeof( info.frame_id )); // a frame name too long to fit
+  float first[4] = { 0, 1, 2, POT_HIGH };
+  ASSERT_TRUE( writer.publish( info, first ));
+  ASSERT_TRUE( reader.latest( view ));
+  EXPECT_EQ( 1u, view.info.plan );
+  EXPECT_EQ( 0.05, view.info.resolution );
+  EXPECT_EQ( sizeof( info.frame_id ) - 1, strlen( view.info.frame_id ));
+  EXPECT_EQ( 2.0f, view.potential[ 2 ] );
+
+  // the next potential goes into the other buffer, the one after it overwrites the view
+  float second[4] = { 0, 3, 4, 5 };
+  ASSERT_TRUE( writer.publish( info, second ));
+  EXPECT_TRUE( reader.valid( view ));
+  EXPECT_EQ( 2.0f, view.potential[ 2 ] );
+  ASSERT_TRUE( writer.publish( info, second ));
+  EXPECT_FALSE( reader.valid( view ));
+
+  // a larger map replaces the segment, readers follow
+  std::vector<float> big( 100, 7.0f ), copy;
+  info.nx = 10;
+  info.ny = 10;
+  ASSERT_TRUE( writer.publish( info, &big[0] ));
+  navfn::PotentialInfo got;
+  ASSERT_TRUE( reader.copy( got, copy ));
+  EXPECT_EQ( 4u, got.plan );
+  EXPECT_TRUE( copy == big );
+
+  writer.close();
+  EXPECT_FALSE( reader.open( name ));
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2012, Willow Garage, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Willow Garage, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <gtest/gtest.h>
+#include <navfn/publish_queue.h>
+#include <boost/atomic.hpp>
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
+namespace
+{
+  void count_job( boost::atomic<int>* runs, boost::thread::id* ran_on )
+  {
+    ++*runs;
+    *ran_on = boost::this_thread::get_id();
+  }
+
+  void blocking_job( boost::atomic<bool>* started, boost::mutex* gate )
+  {
+    *started = true;
+    boost::mutex::scoped_lock lock( *gate );
+  }
+
+  void order_job( boost::atomic<int>* runs, boost::atomic<int>* position )
+  {
+    *position = ++*runs;
+  }
+
+  void post_kept_job( navfn::PublishQueue* queue, boost::atomic<int>* runs, boost::atomic<int>* position,
+                      boost::atomic<bool>* posted )
+  {
+    queue->post( boost::bind( &order_job, runs, position ), false );
+    *posted = true;
+  }
+}
+
+TEST(PublishQueue, publish_queue_drops_visualization_when_full)
+{
+  boost::mutex gate;
+  boost::atomic<bool> started( false );
+  boost::atomic<int> runs( 0 );
+  boost::thread::id ran_on;
+  int accepted = 0;
+  {
+    navfn::PublishQueue queue( 4 );
+
+    // hold the publisher thread inside a job so the queue fills up
+    boost::mutex::scoped_lock lock( gate );
+    queue.post( boost::bind( &blocking_job, &started, &gate ), false );
+    while( !started )
+      boost::this_thread::yield();
+
+    while( queue.post( boost::bind( &count_job, &runs, &ran_on ), true ))
+      accepted++;
+    EXPECT_GE( accepted, 4 );
+    EXPECT_EQ( 1u, queue.dropped() );
+    EXPECT_EQ( 0, runs );
+
+    // a job that must not be dropped waits for room, and runs after the ones queued before it
+    boost::atomic<bool> posted( false );
+    boost::atomic<int> position( 0 );
+    boost::thread producer( boost::bind( &post_kept_job, &queue, &runs, &position, &posted ));
+    boost::this_thread::sleep( boost::posix_time::milliseconds( 20 ));
+    EXPECT_FALSE( posted );
+    EXPECT_EQ( 0, runs );
+
+    lock.unlock();
+    producer.join();
+    for( int i = 0; i < 1000 && runs < accepted + 1; i++ )
+      boost::this_thread::sleep( boost::posix_time::milliseconds( 1 ));
+    EXPECT_NE( boost::this_thread::get_id(), ran_on );
+    EXPECT_EQ( accepted + 1, position );
+  }
+  EXPECT_EQ( accepted + 1, runs );
+}
+
+namespace
+{
+  void post_many( navfn::PublishQueue* queue, boost::atomic<int>* runs, boost::thread::id* ran_on )
+  {
+    for( int i = 0; i < 10000; i++ )
+    {
+      queue->post( boost::bind( &count_job, runs, ran_on ), false );
+      if( i % 100 == 0 )
+        boost::this_thread::sleep( boost::posix_time::microseconds( 50 ));
+    }
+  }
+}
+
+TEST(PublishQueue, publish_queue_never_loses_a_wakeup)
+{
+  // producers that keep catching the publisher thread as it goes to sleep
+  boost::atomic<int> runs( 0 );
+  boost::thread::id ran_on;
+  navfn::PublishQueue queue( 4 );
+  boost::thread_group threads;
+  for( int t = 0; t < 4; t++ )
+    threads.create_thread( boost::bind( &post_many, &queue, &runs, &ran_on ));
+  threads.join_all();
+  for( int i = 0; i < 1000 && runs < 40000; i++ )
+    boost::this_thread::sleep( boost::posix_time::milliseconds( 1 ));
+  EXPECT_EQ( 40000, runs );
+  EXPECT_EQ( 0u, queue.dropped() );
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
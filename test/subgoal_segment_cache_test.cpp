@@ -0,0 +1,169 @@
+/*
+ * Copyright (c) 2012, Willow Garage, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Willow Garage, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <gtest/gtest.h>
+#include <navfn/subgoal_segment_cache.h>
+#include <costmap_2d/cost_values.h>
+#include <boost/thread.hpp>
+#include <math.h>
+
+namespace
+{
+  geometry_msgs::Pose pose( double x, double y )
+  {
+    geometry_msgs::Pose p;
+    p.position.x = x;
+    p.position.y = y;
+    p.orientation.w = 1.0;
+    return p;
+  }
+
+  // the workers plan in the background, give them a few seconds
+  bool wait_for_segment( navfn::SubgoalSegmentCache& cache, const geometry_msgs::Pose& from, const geometry_msgs::Pose& to,
+                         std::vector<float>& x, std::vector<float>& y )
+  {
+    for( int i = 0; i < 500; i++ )
+    {
+      if( cache.lookup( from, to, x, y ))
+        return true;
+      boost::this_thread::sleep( boost::posix_time::milliseconds( 10 ));
+    }
+    return false;
+  }
+
+  void set_cost( costmap_2d::Costmap2D& costmap, unsigned int x, unsigned int y, unsigned char cost )
+  {
+    boost::unique_lock<costmap_2d::Costmap2D::mutex_t> lock( *costmap.getMutex() );
+    costmap.setCost( x, y, cost );
+  }
+}
+
+TEST(SubgoalSegmentCache, cached_segments_are_hit)
+{
+  costmap_2d::Costmap2D costmap( 100, 100, 1.0, 0.0, 0.0 );
+  navfn::SubgoalSegmentCache cache( &costmap, 2, true );
+  std::vector<geometry_msgs::Pose> route;
+  route.push_back( pose( 10.5, 10.5 ));
+  route.push_back( pose( 80.5, 80.5 ));
+  route.push_back( pose( 80.5, 20.5 ));
+  cache.request( route );
+
+  std::vector<float> x, y;
+  ASSERT_TRUE( wait_for_segment( cache, route[ 0 ], route[ 1 ], x, y ));
+  ASSERT_GT( x.size(), 2u );
+  EXPECT_NEAR( 10.0, x.front(), 1.0 );
+  EXPECT_NEAR( 10.0, y.front(), 1.0 );
+  EXPECT_NEAR( 80.0, x.back(), 1.0 );
+  EXPECT_NEAR( 80.0, y.back(), 1.0 );
+  ASSERT_TRUE( wait_for_segment( cache, route[ 1 ], route[ 2 ], x, y ));
+
+  // lookups never plan, so an immediate answer is the cached segment
+  std::vector<float> hit_x, hit_y;
+  ASSERT_TRUE( wait_for_segment( cache, route[ 0 ], route[ 1 ], x, y ));
+  EXPECT_TRUE( cache.lookup( route[ 0 ], route[ 1 ], hit_x, hit_y ));
+  EXPECT_EQ( x, hit_x );
+  EXPECT_EQ( y, hit_y );
+
+  // requesting the same route again keeps what is cached
+  cache.request( route );
+  EXPECT_TRUE( cache.lookup( route[ 0 ], route[ 1 ], hit_x, hit_y ));
+  EXPECT_TRUE( cache.lookup( route[ 1 ], route[ 2 ], hit_x, hit_y ));
+
+  // nor does a change far away from both legs
+  set_cost( costmap, 5, 95, costmap_2d::LETHAL_OBSTACLE );
+  EXPECT_TRUE( cache.lookup( route[ 0 ], route[ 1 ], hit_x, hit_y ));
+  EXPECT_TRUE( cache.lookup( route[ 1 ], route[ 2 ], hit_x, hit_y ));
+}
+
+TEST(SubgoalSegmentCache, costmap_changes_invalidate_segments)
+{
+  costmap_2d::Costmap2D costmap( 100, 100, 1.0, 0.0, 0.0 );
+  navfn::SubgoalSegmentCache cache( &costmap, 1, true );
+  std::vector<geometry_msgs::Pose> route;
+  route.push_back( pose( 10.5, 50.5 ));
+  route.push_back( pose( 90.5, 50.5 ));
+  cache.request( route );
+
+  std::vector<float> x, y;
+  ASSERT_TRUE( wait_for_segment( cache, route[ 0 ], route[ 1 ], x, y ));
+  unsigned int cx = (unsigned int)x[ x.size() / 2 ];
+  unsigned int cy = (unsigned int)y[ y.size() / 2 ];
+
+  // a wall across the middle of the segment, with a way around it
+  for( unsigned int j = 20; j < 80; j++ )
+    set_cost( costmap, cx, j, costmap_2d::LETHAL_OBSTACLE );
+  EXPECT_FALSE( cache.lookup( route[ 0 ], route[ 1 ], x, y ));
+
+  // and it is replanned around one end of the wall
+  ASSERT_TRUE( wait_for_segment( cache, route[ 0 ], route[ 1 ], x, y ));
+  for( size_t i = 0; i < x.size(); i++ )
+  {
+    if( fabs( x[ i ] - cx ) < 1.0 )
+    {
+      EXPECT_TRUE( y[ i ] < 21.0 || y[ i ] > 79.0 ) << "point " << i << " at " << x[ i ] << "," << y[ i ] << " crosses the wall";
+    }
+  }
+  EXPECT_NE( cy, (unsigned int)y[ y.size() / 2 ] );
+}
+
+TEST(SubgoalSegmentCache, goal_changes_drop_old_segments)
+{
+  costmap_2d::Costmap2D costmap( 100, 100, 1.0, 0.0, 0.0 );
+  navfn::SubgoalSegmentCache cache( &costmap, 1, true );
+  std::vector<geometry_msgs::Pose> route;
+  route.push_back( pose( 10.5, 10.5 ));
+  route.push_back( pose( 50.5, 50.5 ));
+  route.push_back( pose( 90.5, 10.5 ));
+  cache.request( route );
+
+  std::vector<float> x, y;
+  ASSERT_TRUE( wait_for_segment( cache, route[ 0 ], route[ 1 ], x, y ));
+  ASSERT_TRUE( wait_for_segment( cache, route[ 1 ], route[ 2 ], x, y ));
+
+  // the last leg now goes somewhere else, the first one is still valid
+  geometry_msgs::Pose old_goal = route[ 2 ];
+  route[ 2 ] = pose( 10.5, 90.5 );
+  cache.request( route );
+  EXPECT_TRUE( cache.lookup( route[ 0 ], route[ 1 ], x, y ));
+  EXPECT_FALSE( cache.lookup( route[ 1 ], old_goal, x, y ));
+
+  ASSERT_TRUE( wait_for_segment( cache, route[ 1 ], route[ 2 ], x, y ));
+  EXPECT_NEAR( 10.0, x.back(), 1.0 );
+  EXPECT_NEAR( 90.0, y.back(), 1.0 );
+  EXPECT_FALSE( cache.lookup( route[ 1 ], old_goal, x, y ));
+
+  cache.clear();
+  EXPECT_FALSE( cache.lookup( route[ 0 ], route[ 1 ], x, y ));
+}
+
+int main( int argc, char** argv )
+{
+  testing::InitGoogleTest( &argc, argv );
+  return RUN_ALL_TESTS();
+}
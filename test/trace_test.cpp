@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2012, Willow Garage, Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Willow Garage, Inc. nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <fstream>
+#include <sstream>
+#include <gtest/gtest.h>
+#include <navfn/trace.h>
+#include <boost/atomic.hpp>
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include "willow_fixture.h"
+
+TEST_F(WillowNav, trace_records_phases_and_propagation)
+{
+  navfn::Tracer& tracer = navfn::Tracer::instance();
+  tracer.enable( 1000 );
+  ASSERT_TRUE( nav->calcNavFnDijkstra( true ));
+  tracer.disable();
+  ASSERT_TRUE( nav->calcNavFnDijkstra( true ));
+
+  std::string path = testing::TempDir() + "navfn_trace.json";
+  ASSERT_TRUE( tracer.dump( path ));
+  std::ifstream in( path.c_str() );
+  std::stringstream json;
+  json << in.rdbuf();
+  std::string text = json.str();
+
+  // one plan's phases, nested in the plan, and samples of the propagation in between
+  EXPECT_EQ( 0u, text.find( "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[" ));
+  EXPECT_NE( std::string::npos, text.find( "\"name\":\"calcNavFnDijkstra\",\"ph\":\"X\"" ));
+  EXPECT_NE( std::string::npos, text.find( "\"name\":\"propNavFnDijkstra\",\"ph\":\"X\"" ));
+  EXPECT_NE( std::string::npos, text.find( "\"name\":\"calcPath\",\"ph\":\"X\"" ));
+  EXPECT_NE( std::string::npos, text.find( "\"name\":\"propagation\",\"ph\":\"C\"" ));
+  EXPECT_EQ( text.find( "calcNavFnDijkstra" ), text.rfind( "calcNavFnDijkstra" ));
+  size_t events = 0;
+  for( size_t pos = text.find( "\"ph\":" ); pos != std::string::npos; pos = text.find( "\"ph\":", pos + 1 ))
+    events++;
+  // four phases, and samples from cycle 0 up to the one that reached the start
+  EXPECT_EQ( (size_t)( 4 + nav->propCycles / nav->traceInt + 1 ), events );
+}
+
+TEST(Tracer, trace_ring_keeps_the_newest_events)
+{
+  navfn::Tracer& tracer = navfn::Tracer::instance();
+  tracer.enable( 4 );
+  for( int i = 0; i < 10; i++ )
+    tracer.complete( i < 6 ? "old" : "new", navfn::Tracer::now(), 1000 );
+  tracer.disable();
+
+  std::string path = testing::TempDir() + "navfn_trace.json";
+  ASSERT_TRUE( tracer.dump( path ));
+  std::ifstream in( path.c_str() );
+  std::stringstream json;
+  json << in.rdbuf();
+  EXPECT_EQ( std::string::npos, json.str().find( "old" ));
+  EXPECT_NE( std::string::npos, json.str().find( "new" ));
+}
+
+namespace
+{
+  void trace_until( boost::atomic<bool>* stop, boost::atomic<int>* events )
+  {
+    while( !*stop )
+    {
+      navfn::Tracer::instance().complete( "busy", navfn::Tracer::now(), 1 );
+      ++*events;
+    }
+  }
+}
+
+TEST(Tracer, trace_rings_outlive_recorders_still_writing)
+{
+  // recorders that saw tracing enabled keep writing while it is switched off and on with other capacities
+  boost::atomic<bool> stop( false );
+  boost::atomic<int> events( 0 );
+  navfn::Tracer& tracer = navfn::Tracer::instance();
+  tracer.enable( 16 );
+  boost::thread_group threads;
+  for( int t = 0; t < 2; t++ )
+    threads.create_thread( boost::bind( &trace_until, &stop, &events ));
+  for( int i = 0; i < 50 || events < 1000; i++ )
+  {
+    tracer.disable();
+    tracer.enable( 16 << ( i % 4 ));
+  }
+  stop = true;
+  threads.join_all();
+  tracer.disable();
+
+  std::string path = testing::TempDir() + "navfn_trace.json";
+  EXPECT_TRUE( tracer.dump( path ));
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}